@@ -123,9 +123,33 @@ EMBEDJSON_STATIC const char* embedjson_strerror(embedjson_error_code code)
     case EMBEDJSON_INT_OVERFLOW:
       return "EMBEDJSON_INT_OVERFLOW: "
         "Too large integer value (35)";
+    case EMBEDJSON_BAD_PATH:
+      return "EMBEDJSON_BAD_PATH: "
+        "Malformed JSON path expression (36)";
+    case EMBEDJSON_PATH_OVERFLOW:
+      return "EMBEDJSON_PATH_OVERFLOW: "
+        "Too many paths in the filter, or too many steps in the path (37)";
+    case EMBEDJSON_CHECKPOINT_OVERFLOW:
+      return "EMBEDJSON_CHECKPOINT_OVERFLOW: "
+        "Buffer is too small to store the parser's checkpoint (38)";
+    case EMBEDJSON_BAD_CHECKPOINT:
+      return "EMBEDJSON_BAD_CHECKPOINT: "
+        "Malformed or incompatible parser's checkpoint (39)";
+    case EMBEDJSON_THREAD_ERROR:
+      return "EMBEDJSON_THREAD_ERROR: "
+        "Failed to start a worker thread or to allocate memory (40)";
+    case EMBEDJSON_BAD_ENCODING:
+      return "EMBEDJSON_BAD_ENCODING: "
+        "Malformed UTF-16 or UTF-32 input (41)";
+    case EMBEDJSON_READ_ERROR:
+      return "EMBEDJSON_READ_ERROR: "
+        "Failed to read input or to allocate input buffers (42)";
+    case EMBEDJSON_BAD_COMPRESSION:
+      return "EMBEDJSON_BAD_COMPRESSION: "
+        "Malformed or unsupported compressed input (43)";
     case EMBEDJSON_INTERNAL_ERROR:
       return "EMBEDJSON_INTERNAL_ERROR: "
-        "Unexpected internal error (36). " EMBEDJSON_BUG_REPORT;
+        "Unexpected internal error (44). " EMBEDJSON_BUG_REPORT;
     default:
       return "Unknown error. " EMBEDJSON_BUG_REPORT;
   }
@@ -135,6 +159,11 @@ EMBEDJSON_STATIC int embedjson_error_ex(struct embedjson_parser* parser,
     embedjson_error_code code, const char* position)
 {
   (void) code;
+#if EMBEDJSON_STREAM
+  int err = embedjson_error(parser, position);
+  return err ? err : embedjson_stream_error(parser, position);
+#else
   return embedjson_error(parser, position);
+#endif /* EMBEDJSON_STREAM */
 }
 
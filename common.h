@@ -12,6 +12,9 @@
 
 #ifndef EMBEDJSON_AMALGAMATE
 #define EMBEDJSON_STATIC
+#elif defined(__GNUC__)
+/* Application is not required to use every function of the library */
+#define EMBEDJSON_STATIC static __attribute__((unused))
 #else
 #define EMBEDJSON_STATIC static
 #endif /* EMBEDJSON_AMALGAMATE */
@@ -27,6 +30,14 @@
 #define EMBEDJSON_STATIC_STACK_SIZE 16
 #endif
 
+#ifndef EMBEDJSON_STRING_BUFFER_SIZE
+/**
+ * Size of the parser's buffer that coalesces string chunks, zero disables
+ * buffering
+ */
+#define EMBEDJSON_STRING_BUFFER_SIZE 0
+#endif
+
 #ifndef EMBEDJSON_VALIDATE_UTF8
 /**
  * Enable UTF-8 strings validation.
@@ -34,6 +45,20 @@
 #define EMBEDJSON_VALIDATE_UTF8 1
 #endif
 
+#ifndef EMBEDJSON_FILTER_MAX_PATHS
+/**
+ * Maximum number of paths in the embedjson_filter
+ */
+#define EMBEDJSON_FILTER_MAX_PATHS 8
+#endif
+
+#ifndef EMBEDJSON_FILTER_MAX_DEPTH
+/**
+ * Maximum number of steps in each path of the embedjson_filter
+ */
+#define EMBEDJSON_FILTER_MAX_DEPTH 8
+#endif
+
 #ifndef EMBEDJSON_SIZE_T
 #if defined(__i386__)
 typedef unsigned long embedjson_size_t;
@@ -50,12 +75,34 @@ typedef unsigned long long embedjson_size_t;
 typedef EMBEDJSON_SIZE_T embedjson_size_t;
 #endif
 
+/**
+ * A segment of input for embedjson_pushv. Layout is the same as of
+ * POSIX struct iovec, so an array of iovec can be passed as is.
+ */
+typedef struct embedjson_iovec {
+  const void* iov_base;
+  embedjson_size_t iov_len;
+} embedjson_iovec;
+
+/**
+ * Number of readable bytes that should follow the data passed
+ * to embedjson_push_padded
+ */
+#define EMBEDJSON_PADDING 64
+
 #ifndef EMBEDJSON_INT_T
 typedef long long embedjson_int_t;
 #else
 typedef EMBEDJSON_INT_T embedjson_int_t;
 #endif
 
+#if EMBEDJSON_UTF16_STRINGS
+/**
+ * UTF-16 code unit of string values, see EMBEDJSON_UTF16_STRINGS
+ */
+typedef unsigned short embedjson_char16_t;
+#endif /* EMBEDJSON_UTF16_STRINGS */
+
 #define EMBEDJSON_INT_MAX ((((embedjson_int_t) 1) << (sizeof(embedjson_int_t) * 8 - 2)) - 1 + (((embedjson_int_t) 1) << (sizeof(embedjson_int_t) * 8 - 2)))
 #define EMBEDJSON_INT_MIN (-(EMBEDJSON_INT_MAX - 1))
 
@@ -84,6 +131,47 @@ do { \
 
 #define EMBEDJSON_UNUSED(x) (void) (x)
 
+/**
+ * A special return value of the parsing callbacks to skip the value
+ * being parsed.
+ *
+ * The following callbacks support skipping:
+ * @li embedjson_object_begin - skip the rest of the object, including
+ * embedjson_object_end call;
+ * @li embedjson_array_begin - skip the rest of the array, including
+ * embedjson_array_end call;
+ * @li embedjson_string_end - if the string is an object key, skip the value
+ * that corresponds to the key.
+ *
+ * Skipped data is processed by a lightweight scanner, that only tracks
+ * quotes, escape sequences and brackets, so no callbacks are called
+ * and no validation is performed until the value ends, except that
+ * a missing value is reported as an error.
+ *
+ * @note User-defined callbacks should not use EMBEDJSON_SKIP as an error code
+ */
+#define EMBEDJSON_SKIP (-100)
+
+/**
+ * A special return value of embedjson_push, that indicates that all values
+ * requested by the filter are found and parsing is stopped.
+ *
+ * @see embedjson_parser.filter_stop
+ */
+#define EMBEDJSON_DONE (-101)
+
+/**
+ * A special return value of the parsing callbacks to pause parsing.
+ *
+ * The value being reported is processed completely, then
+ * embedjson_push_ex returns EMBEDJSON_PAUSE and reports the number of bytes
+ * consumed. Parsing is resumed by calling embedjson_push_ex with the rest
+ * of the data.
+ *
+ * @note User-defined callbacks should not use EMBEDJSON_PAUSE as an error code
+ */
+#define EMBEDJSON_PAUSE (-102)
+
 typedef enum {
   /**
    * No error
@@ -212,6 +300,57 @@ typedef enum {
    * values of any size.
    */
   EMBEDJSON_INT_OVERFLOW,
+  /**
+   * Malformed JSON path expression
+   *
+   * @see embedjson_filter_add
+   */
+  EMBEDJSON_BAD_PATH,
+  /**
+   * Too many paths in the filter, or too many steps in the path.
+   *
+   * Try to increase EMBEDJSON_FILTER_MAX_PATHS and EMBEDJSON_FILTER_MAX_DEPTH.
+   */
+  EMBEDJSON_PATH_OVERFLOW,
+  /**
+   * Buffer is too small to store the parser's checkpoint
+   *
+   * @see embedjson_checkpoint_size
+   */
+  EMBEDJSON_CHECKPOINT_OVERFLOW,
+  /**
+   * Malformed checkpoint, or checkpoint was created by an incompatible
+   * version or configuration of the library
+   */
+  EMBEDJSON_BAD_CHECKPOINT,
+  /**
+   * Failed to start a worker thread or to allocate memory for
+   * parallel parsing
+   */
+  EMBEDJSON_THREAD_ERROR,
+  /**
+   * Malformed UTF-16 or UTF-32 input: unpaired surrogate, code point
+   * beyond U+10FFFF, or truncated code point at the end of input.
+   * Also returned by embedjson_parallel_ndjson and embedjson_parallel_array
+   * for UTF-16 and UTF-32 input, which they do not support
+   *
+   * @see EMBEDJSON_TRANSCODE
+   */
+  EMBEDJSON_BAD_ENCODING,
+  /**
+   * Failed to read input, or to allocate memory for input buffers,
+   * errno is set
+   *
+   * @see embedjson_push_fd
+   */
+  EMBEDJSON_READ_ERROR,
+  /**
+   * Malformed or truncated compressed input, or compression format
+   * that is not supported by the build
+   *
+   * @see embedjson_push_compressed
+   */
+  EMBEDJSON_BAD_COMPRESSION,
   /**
    * Unexpected error.
    *
@@ -223,7 +362,9 @@ typedef enum {
    * Please report a bug at https://github.com/ivochkin/embedjson/issues/new
    * if you receive EMBEDJSON_INTERNAL_ERROR from the embedjson library.
    *
-   * @note EMBEDJSON_INTERNAL_ERROR should the last enum member
+   * @note EMBEDJSON_INTERNAL_ERROR should the last enum member, so new error
+   * codes are inserted before it, and its value changes when they are added
+   * (see Breaking changes in README.md)
    */
   EMBEDJSON_INTERNAL_ERROR
 } embedjson_error_code;
@@ -252,3 +393,15 @@ EMBEDJSON_STATIC int embedjson_error(struct embedjson_parser* parser,
 EMBEDJSON_STATIC int embedjson_error_ex(struct embedjson_parser* parser,
     embedjson_error_code code, const char* position);
 
+#if EMBEDJSON_STREAM
+/**
+ * Called from embedjson_error_ex when embedjson_error returns zero,
+ * i.e. when the application wants to continue parsing the stream
+ * with the next document.
+ *
+ * Returns non-zero value to stop tokenizing the failed document.
+ */
+EMBEDJSON_STATIC int embedjson_stream_error(struct embedjson_parser* parser,
+    const char* position);
+#endif /* EMBEDJSON_STREAM */
+
@@ -0,0 +1,418 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+/* read and POSIX threads */
+#define _POSIX_C_SOURCE 200809L
+#include "common.h"
+#include "decompress.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_DECOMPRESS
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if EMBEDJSON_ZLIB
+#include <zlib.h>
+#endif /* EMBEDJSON_ZLIB */
+
+#if EMBEDJSON_ZSTD
+#include <zstd.h>
+#endif /* EMBEDJSON_ZSTD */
+
+#define DECOMPRESS_BLOCK_SIZE (256 << 10)
+#define DECOMPRESS_INPUT_SIZE (64 << 10)
+
+/* Returned by source_read at the end of the decompressed stream */
+#define DECOMPRESS_END (-1)
+
+enum {
+  DECOMPRESS_PLAIN,
+  DECOMPRESS_GZIP,
+  DECOMPRESS_ZSTD
+};
+
+typedef struct {
+  int fd;
+  int format;
+  /* Compressed input, in[pos..end) is not consumed yet */
+  unsigned char* in;
+  size_t pos;
+  size_t end;
+  unsigned char eof;
+  /* Set when a gzip member or a zstd frame is complete */
+  unsigned char member_end;
+  /* Set when the output is full, the decoder may hold more data */
+  unsigned char pending;
+#if EMBEDJSON_ZLIB
+  unsigned char zlib_init;
+  z_stream zlib;
+#endif /* EMBEDJSON_ZLIB */
+#if EMBEDJSON_ZSTD
+  ZSTD_DStream* zstd;
+#endif /* EMBEDJSON_ZSTD */
+} decompress_source;
+
+/*
+ * Double-buffered blocks of decompressed data, filled by the decompression
+ * thread and parsed on the calling thread
+ */
+typedef struct {
+  decompress_source* source;
+  char* blocks[2];
+  size_t sizes[2];
+  int full[2];
+  /* Error of the decompression thread, reported with the last block */
+  int err;
+  int error_errno;
+  size_t block_size;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} decompress_pipeline;
+
+EMBEDJSON_STATIC int embedjson_is_compressed(const char* data,
+    embedjson_size_t size)
+{
+  const unsigned char* d = (const unsigned char*) data;
+  if (size >= 2 && d[0] == 0x1f && d[1] == 0x8b) {
+    return 1;
+  }
+  return size >= 4 && d[0] == 0x28 && d[1] == 0xb5 && d[2] == 0x2f
+    && d[3] == 0xfd;
+}
+
+/*
+ * Appends the next portion of compressed input. Returns -1 with errno set
+ * if input can not be read.
+ */
+static int source_fill(decompress_source* s)
+{
+  if (s->pos == s->end) {
+    s->pos = s->end = 0;
+  }
+  ssize_t n;
+  do {
+    n = read(s->fd, s->in + s->end, DECOMPRESS_INPUT_SIZE - s->end);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    return -1;
+  }
+  s->eof = !n;
+  s->end += (size_t) n;
+  return 0;
+}
+
+/*
+ * Reads the magic number and initializes the decoder
+ */
+static int source_open(decompress_source* s)
+{
+  s->in = malloc(DECOMPRESS_INPUT_SIZE);
+  if (!s->in) {
+    return EMBEDJSON_READ_ERROR;
+  }
+  /* Pipes may return less than the magic number at once */
+  while (s->end < 4 && !s->eof) {
+    if (source_fill(s)) {
+      return EMBEDJSON_READ_ERROR;
+    }
+  }
+  if (!embedjson_is_compressed((const char*) s->in, s->end)) {
+    s->format = DECOMPRESS_PLAIN;
+    return 0;
+  }
+  if (s->in[0] == 0x1f) {
+    s->format = DECOMPRESS_GZIP;
+#if EMBEDJSON_ZLIB
+    /* 16 + MAX_WBITS stands for gzip header and trailer */
+    if (inflateInit2(&s->zlib, 16 + MAX_WBITS) != Z_OK) {
+      return EMBEDJSON_READ_ERROR;
+    }
+    s->zlib_init = 1;
+    return 0;
+#endif /* EMBEDJSON_ZLIB */
+  } else {
+    s->format = DECOMPRESS_ZSTD;
+#if EMBEDJSON_ZSTD
+    s->zstd = ZSTD_createDStream();
+    if (!s->zstd || ZSTD_isError(ZSTD_initDStream(s->zstd))) {
+      return EMBEDJSON_READ_ERROR;
+    }
+    return 0;
+#endif /* EMBEDJSON_ZSTD */
+  }
+  /* Format is not supported by this build */
+  return EMBEDJSON_BAD_COMPRESSION;
+}
+
+static void source_close(decompress_source* s)
+{
+#if EMBEDJSON_ZLIB
+  if (s->zlib_init) {
+    inflateEnd(&s->zlib);
+  }
+#endif /* EMBEDJSON_ZLIB */
+#if EMBEDJSON_ZSTD
+  ZSTD_freeDStream(s->zstd);
+#endif /* EMBEDJSON_ZSTD */
+  free(s->in);
+}
+
+/*
+ * Decompresses available input into out[*n..size). Returns 0,
+ * DECOMPRESS_END at the end of the stream, or EMBEDJSON_BAD_COMPRESSION.
+ */
+static int decompress_step(decompress_source* s, char* out, size_t size,
+    size_t* n)
+{
+  if (s->pos == s->end && s->eof
+      && (s->format == DECOMPRESS_PLAIN || s->member_end) && !s->pending) {
+    return DECOMPRESS_END;
+  }
+  size_t pos = s->pos;
+  size_t n0 = *n;
+  switch (s->format) {
+#if EMBEDJSON_ZLIB
+    case DECOMPRESS_GZIP: {
+      if (s->member_end && s->pos < s->end) {
+        /* Next member of a multi-member file, e.g. produced by pigz */
+        if (inflateReset(&s->zlib) != Z_OK) {
+          return EMBEDJSON_BAD_COMPRESSION;
+        }
+        s->member_end = 0;
+      }
+      s->zlib.next_in = s->in + s->pos;
+      s->zlib.avail_in = (uInt) (s->end - s->pos);
+      s->zlib.next_out = (unsigned char*) out + *n;
+      s->zlib.avail_out = (uInt) (size - *n);
+      int rc = inflate(&s->zlib, Z_NO_FLUSH);
+      s->pos = s->end - s->zlib.avail_in;
+      *n = size - s->zlib.avail_out;
+      if (rc == Z_STREAM_END) {
+        s->member_end = 1;
+      } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        return EMBEDJSON_BAD_COMPRESSION;
+      }
+      break;
+    }
+#endif /* EMBEDJSON_ZLIB */
+#if EMBEDJSON_ZSTD
+    case DECOMPRESS_ZSTD: {
+      ZSTD_inBuffer in = {s->in, s->end, s->pos};
+      ZSTD_outBuffer o = {out, size, *n};
+      size_t rc = ZSTD_decompressStream(s->zstd, &o, &in);
+      if (ZSTD_isError(rc)) {
+        return EMBEDJSON_BAD_COMPRESSION;
+      }
+      s->pos = in.pos;
+      *n = o.pos;
+      /* Zero is returned when a frame is completely decoded and flushed */
+      s->member_end = !rc;
+      break;
+    }
+#endif /* EMBEDJSON_ZSTD */
+    default: {
+      size_t copy = s->end - s->pos < size - *n ? s->end - s->pos : size - *n;
+      memcpy(out + *n, s->in + s->pos, copy);
+      s->pos += copy;
+      *n += copy;
+      return 0;
+    }
+  }
+  s->pending = *n == size;
+  if (pos == s->pos && n0 == *n && s->pos == s->end && s->eof) {
+    /* Input ended in the middle of a gzip member or a zstd frame */
+    return EMBEDJSON_BAD_COMPRESSION;
+  }
+  return 0;
+}
+
+/*
+ * Fills out[0..size) with decompressed data. The block is returned
+ * early, rather than waiting for more input, if it is not empty: pipes
+ * and sockets may deliver the rest of the document much later.
+ *
+ * Returns 0, DECOMPRESS_END if the stream is over (*n may be non-zero),
+ * EMBEDJSON_READ_ERROR or EMBEDJSON_BAD_COMPRESSION.
+ */
+static int source_read(decompress_source* s, char* out, size_t size,
+    size_t* n)
+{
+  *n = 0;
+  while (*n < size) {
+    if (s->pos == s->end && !s->eof && !s->pending) {
+      if (*n) {
+        break;
+      }
+      if (source_fill(s)) {
+        return EMBEDJSON_READ_ERROR;
+      }
+    }
+    int err = decompress_step(s, out, size, n);
+    if (err) {
+      return err;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Pushes a block of decompressed data. Data decompressed before an error
+ * is parsed first, so that errors in the document are reported as usual.
+ * Returns 0 at the end of the stream.
+ */
+static int push_block(embedjson_parser* parser, const char* data,
+    size_t size, int err)
+{
+  if (size) {
+    int push_err = embedjson_push(parser, data, (embedjson_size_t) size);
+    if (push_err) {
+      return push_err;
+    }
+  }
+  return err == DECOMPRESS_END ? 0 : err;
+}
+
+static void decompress_unlock(void* mutex)
+{
+  pthread_mutex_unlock(mutex);
+}
+
+/* Waits until the i-th block is parsed, the wait can be cancelled */
+static void pipeline_wait(decompress_pipeline* p, int i)
+{
+  pthread_mutex_lock(&p->mutex);
+  pthread_cleanup_push(decompress_unlock, &p->mutex);
+  while (p->full[i]) {
+    pthread_cond_wait(&p->cond, &p->mutex);
+  }
+  pthread_cleanup_pop(1);
+}
+
+static void* pipeline_main(void* arg)
+{
+  decompress_pipeline* p = arg;
+  for (int i = 0;; i ^= 1) {
+    pipeline_wait(p, i);
+    size_t n;
+    int err = source_read(p->source, p->blocks[i], p->block_size, &n);
+    pthread_mutex_lock(&p->mutex);
+    p->sizes[i] = n;
+    p->err = err;
+    p->error_errno = errno;
+    p->full[i] = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    if (err) {
+      return NULL;
+    }
+  }
+}
+
+static int push_pipeline(embedjson_parser* parser, decompress_source* s,
+    size_t block_size)
+{
+  decompress_pipeline p;
+  memset(&p, 0, sizeof(p));
+  p.source = s;
+  p.block_size = block_size;
+  p.blocks[0] = malloc(block_size);
+  p.blocks[1] = malloc(block_size);
+  int err = EMBEDJSON_READ_ERROR;
+  if (!p.blocks[0] || !p.blocks[1]) {
+    free(p.blocks[0]);
+    free(p.blocks[1]);
+    return err;
+  }
+  pthread_mutex_init(&p.mutex, NULL);
+  pthread_cond_init(&p.cond, NULL);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, pipeline_main, &p)) {
+    err = EMBEDJSON_THREAD_ERROR;
+  } else {
+    for (int i = 0;; i ^= 1) {
+      pthread_mutex_lock(&p.mutex);
+      while (!p.full[i]) {
+        pthread_cond_wait(&p.cond, &p.mutex);
+      }
+      size_t n = p.sizes[i];
+      int read_err = p.err;
+      pthread_mutex_unlock(&p.mutex);
+      int last = read_err != 0;
+      err = push_block(parser, p.blocks[i], n, read_err);
+      if (err && !last) {
+        /* The thread may be blocked on the input that never ends */
+        pthread_cancel(thread);
+      }
+      if (err || last) {
+        break;
+      }
+      pthread_mutex_lock(&p.mutex);
+      p.full[i] = 0;
+      pthread_cond_broadcast(&p.cond);
+      pthread_mutex_unlock(&p.mutex);
+    }
+    pthread_join(thread, NULL);
+    if (err == EMBEDJSON_READ_ERROR) {
+      errno = p.error_errno;
+    }
+  }
+  pthread_cond_destroy(&p.cond);
+  pthread_mutex_destroy(&p.mutex);
+  free(p.blocks[0]);
+  free(p.blocks[1]);
+  return err;
+}
+
+static int push_sequential(embedjson_parser* parser, decompress_source* s,
+    size_t block_size)
+{
+  char* block = malloc(block_size);
+  if (!block) {
+    return EMBEDJSON_READ_ERROR;
+  }
+  int err;
+  for (;;) {
+    size_t n;
+    int read_err = source_read(s, block, block_size, &n);
+    err = push_block(parser, block, n, read_err);
+    if (err || read_err) {
+      break;
+    }
+  }
+  int saved_errno = errno;
+  free(block);
+  errno = saved_errno;
+  return err;
+}
+
+EMBEDJSON_STATIC int embedjson_push_compressed(embedjson_parser* parser,
+    int fd, embedjson_size_t block_size, int flags)
+{
+  decompress_source s;
+  memset(&s, 0, sizeof(s));
+  s.fd = fd;
+  if (!block_size) {
+    block_size = DECOMPRESS_BLOCK_SIZE;
+  }
+  int err = source_open(&s);
+  if (!err) {
+    err = flags & EMBEDJSON_DECOMPRESS_THREAD
+      ? push_pipeline(parser, &s, block_size)
+      : push_sequential(parser, &s, block_size);
+  }
+  int saved_errno = errno;
+  source_close(&s);
+  errno = saved_errno;
+  return err;
+}
+
+#endif /* EMBEDJSON_DECOMPRESS */
@@ -0,0 +1,64 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+#pragma once
+#include "common.h"
+#include "parser.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_DECOMPRESS
+
+#ifndef EMBEDJSON_ZLIB
+/**
+ * Decompress gzip input with zlib, link with -lz
+ */
+#define EMBEDJSON_ZLIB 0
+#endif
+
+#ifndef EMBEDJSON_ZSTD
+/**
+ * Decompress zstd input with libzstd, link with -lzstd
+ */
+#define EMBEDJSON_ZSTD 0
+#endif
+
+/**
+ * Flag of embedjson_push_compressed: decompress on a separate thread,
+ * while the previous block is parsed on the calling thread
+ */
+#define EMBEDJSON_DECOMPRESS_THREAD 1
+
+/**
+ * Returns non-zero value if data starts with gzip or zstd magic number,
+ * whether or not the format is supported by this build
+ */
+EMBEDJSON_STATIC int embedjson_is_compressed(const char* data,
+    embedjson_size_t size);
+
+/**
+ * Reads fd until the end of input, decompresses it into blocks of
+ * block_size bytes (zero means 256 KiB) and pushes each block to the parser
+ * with embedjson_push. The whole document is never held in memory.
+ *
+ * Compression format is detected by the magic number: gzip (several
+ * concatenated members are allowed) or zstd (several frames are allowed).
+ * Input without a known magic number is pushed as is.
+ *
+ * embedjson_finalize is not called.
+ *
+ * Returns 0 at the end of input, non-zero value returned from
+ * embedjson_push, EMBEDJSON_READ_ERROR with errno set if input can not be
+ * read or memory can not be allocated, EMBEDJSON_THREAD_ERROR if the
+ * decompression thread can not be started, or EMBEDJSON_BAD_COMPRESSION.
+ *
+ * @note Requires libc and POSIX threads
+ */
+EMBEDJSON_STATIC int embedjson_push_compressed(embedjson_parser* parser,
+    int fd, embedjson_size_t block_size, int flags);
+
+#endif /* EMBEDJSON_DECOMPRESS */
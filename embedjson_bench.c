@@ -0,0 +1,745 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+/* POSIX 2008 functions */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The parser is measured as configured by CMake, without I/O and threads */
+#include "config.h"
+/* See the embedjson-bench-stream test */
+#ifdef EMBEDJSON_BENCH_STREAM
+#undef EMBEDJSON_STREAM
+#define EMBEDJSON_STREAM 1
+#endif
+#undef EMBEDJSON_PARALLEL
+#define EMBEDJSON_PARALLEL 0
+#undef EMBEDJSON_READER
+#define EMBEDJSON_READER 0
+#undef EMBEDJSON_DECOMPRESS
+#define EMBEDJSON_DECOMPRESS 0
+#include <embedjson.c>
+
+#include "embedjson_gen.h"
+
+/**
+ * Command-line arguments
+ */
+static size_t corpus_size = 4 << 20;
+static unsigned bench_runs = 10;
+static unsigned long long seed = 1;
+static const char* corpus_names = NULL;
+static const char* json_output = NULL;
+static int push_sweep = 0;
+
+/*
+ * Growing buffer that holds a generated document
+ */
+typedef struct corpus {
+  char* data;
+  size_t size;
+  size_t capacity;
+  /* Records are newline-delimited documents */
+  int ndjson;
+  /* Records are parsed in stream mode, see corpus_type */
+  int stream;
+} corpus;
+
+static void corpus_write(void* context, const char* data, size_t size)
+{
+  corpus* c = context;
+  if (c->size + size > c->capacity) {
+    size_t capacity = c->capacity ? c->capacity : 4096;
+    while (capacity < c->size + size) {
+      capacity *= 2;
+    }
+    char* buffer = realloc(c->data, capacity);
+    if (!buffer) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+    c->data = buffer;
+    c->capacity = capacity;
+  }
+  memcpy(c->data + c->size, data, size);
+  c->size += size;
+}
+
+/*
+ * Maximum nesting of a record, including the top-level array. Parser's
+ * stack holds one bit per level.
+ */
+#if EMBEDJSON_DYNAMIC_STACK || EMBEDJSON_STATIC_STACK_SIZE > 12
+#define MAX_NESTING 96
+#else
+#define MAX_NESTING (8 * EMBEDJSON_STATIC_STACK_SIZE)
+#endif
+
+/*
+ * Corpora are embedjson-gen outputs, generated with --size and --seed
+ * of the benchmark and the given arguments. Newline-delimited records are
+ * parsed one by one with a fresh parser, the way applications do without
+ * stream mode, so that results of all configurations are comparable.
+ * Corpora with the stream flag are parsed with a single parser in stream
+ * mode instead, and exist only if EMBEDJSON_STREAM is enabled.
+ */
+typedef struct corpus_type {
+  const char* name;
+  const char* args;
+  int stream;
+} corpus_type;
+
+static const corpus_type corpus_types[] = {
+  {"records", "--depth 1:4 --keys 1:8", 0},
+  {"pretty", "--whitespace pretty --depth 2:6 --keys 2:12", 0},
+  {"tweet", "--depth 2:5 --keys 4:12 --containers 1:4 --string-length 16:140 "
+    "--scalars 6:2:1 --escapes 1 --non-ascii 5", 0},
+  {"catalog", "--depth 1:2 --keys 24:48 --containers 1:9 --scalars 3:4:2", 0},
+  {"numbers", "--depth 1:2 --keys 2:32 --scalars 0:1:0 --numbers 30:70:0",
+    0},
+  {"coordinates", "--depth 1:3 --keys 2:16 --containers 9:1 --scalars 0:1:0 "
+    "--numbers 0:1:0", 0},
+  {"literals", "--depth 1:3 --keys 4:16 --scalars 0:1:3", 0},
+  {"nested", "--depth 48:95 --keys 1:3", 0},
+  {"escapes", "--string-length 16:128 --escapes 25 --scalars 1:0:0", 0},
+  {"unicode", "--string-length 8:64 --non-ascii 80 --scalars 1:0:0", 0},
+  {"ndjson", "--ndjson --depth 1:4 --keys 1:8", 0},
+#if EMBEDJSON_STREAM
+  {"ndjson-stream", "--ndjson --depth 1:4 --keys 1:8", 1}
+#endif /* EMBEDJSON_STREAM */
+};
+
+#define NCORPORA (sizeof(corpus_types) / sizeof(corpus_types[0]))
+
+static gen generator;
+
+/*
+ * Generates a corpus at least corpus_size bytes long
+ */
+static void generate(corpus* c, const corpus_type* type)
+{
+  gen_options options = gen_default_options;
+  char args[256];
+  char* argv[32];
+  int argc = 0;
+  snprintf(args, sizeof(args), "%s", type->args);
+  for (char* arg = strtok(args, " "); arg; arg = strtok(NULL, " ")) {
+    argv[argc++] = arg;
+  }
+  for (int i = 0; i < argc;) {
+    int n = gen_parse_option(&options, argv[i], i + 1 < argc ? argv[i + 1]
+        : NULL);
+    if (n <= 0) {
+      fprintf(stderr, "invalid arguments of corpus '%s'\n", type->name);
+      exit(1);
+    }
+    i += n;
+  }
+  options.seed = seed;
+  options.size = corpus_size;
+  /* Records are not nested deeper than the parser's stack allows */
+  if (options.depth.max > MAX_NESTING - 1) {
+    options.depth.max = MAX_NESTING - 1;
+    options.depth.min = options.depth.max / 2;
+  }
+  c->size = 0;
+  c->ndjson = options.ndjson;
+  c->stream = type->stream;
+  gen_generate(&generator, &options, corpus_write, c);
+}
+
+/*
+ * No-op callbacks, only the number of calls is counted
+ */
+static int embedjson_error(embedjson_parser* parser, const char* position)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(position);
+  return 1;
+}
+
+#define EMBEDJSON_COUNT(parser) ++*(unsigned long long*) (parser)->userdata
+
+static int embedjson_null(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_bool(embedjson_parser* parser, char value)
+{
+  EMBEDJSON_UNUSED(value);
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_int(embedjson_parser* parser, embedjson_int_t value)
+{
+  EMBEDJSON_UNUSED(value);
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_double(embedjson_parser* parser, double value)
+{
+  EMBEDJSON_UNUSED(value);
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_string_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+#if EMBEDJSON_UTF16_STRINGS
+static int embedjson_string_chunk16(embedjson_parser* parser,
+    const embedjson_char16_t* data, embedjson_size_t size)
+#else
+static int embedjson_string_chunk(embedjson_parser* parser,
+    const char* data, embedjson_size_t size)
+#endif /* EMBEDJSON_UTF16_STRINGS */
+{
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_UNUSED(size);
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_string_end(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_object_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_object_end(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_array_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_array_end(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+#if EMBEDJSON_BIGNUM
+static int embedjson_bignum_begin(embedjson_parser* parser,
+    embedjson_int_t initial_value)
+{
+  EMBEDJSON_UNUSED(initial_value);
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_bignum_chunk(embedjson_parser* parser,
+    const char* data, embedjson_size_t size)
+{
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_UNUSED(size);
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+
+static int embedjson_bignum_end(embedjson_parser* parser)
+{
+  EMBEDJSON_COUNT(parser);
+  return 0;
+}
+#endif /* EMBEDJSON_BIGNUM */
+
+#if EMBEDJSON_STREAM
+static int embedjson_document_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+static int embedjson_document_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+#endif /* EMBEDJSON_STREAM */
+
+#if EMBEDJSON_DYNAMIC_STACK
+static int embedjson_stack_overflow(embedjson_parser* parser)
+{
+  size_t new_stack_capacity = 2 * parser->stack_capacity + 1;
+  char* new_stack = realloc(parser->stack, new_stack_capacity);
+  if (!new_stack) {
+    return -1;
+  }
+  parser->stack = new_stack;
+  parser->stack_capacity = new_stack_capacity;
+  return 0;
+}
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+
+/*
+ * Push size that stands for random_splits
+ */
+#define PUSH_RANDOM ((size_t) -1)
+
+/*
+ * Push sizes of --push-sizes mode, from one byte to 1 MiB and random.
+ * Zero stands for the whole input.
+ */
+static const size_t push_sizes[] = {
+  0, 1, 4, 16, 64, 256, 1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10,
+  1 << 20, PUSH_RANDOM
+};
+
+#define NPUSH_SIZES (sizeof(push_sizes) / sizeof(push_sizes[0]))
+
+/*
+ * Lengths of chunks the input is split into with PUSH_RANDOM, distributed
+ * log-uniformly from one byte to 64 KiB, like reads from a socket
+ */
+static size_t* random_splits;
+static size_t nrandom_splits;
+
+static void split_randomly(size_t size)
+{
+  gen_rng r;
+  gen_rng_init(&r, ~seed);
+  size_t capacity = 0;
+  nrandom_splits = 0;
+  for (size_t total = 0; total < size;) {
+    if (nrandom_splits == capacity) {
+      capacity = capacity ? 2 * capacity : 1024;
+      size_t* splits = realloc(random_splits, capacity * sizeof(size_t));
+      if (!splits) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+      }
+      random_splits = splits;
+    }
+    size_t n = 1 + (size_t) (gen_rng_next(&r)
+        % (1u << gen_rng_below(&r, 17)));
+    random_splits[nrandom_splits++] = n;
+    total += n;
+  }
+}
+
+/*
+ * Parses data[0..size) with a fresh parser, pushing it in chunks
+ * of push_size bytes. The whole input is pushed at once if push_size is
+ * zero, the way most applications do. Returns non-zero value if the input
+ * is invalid.
+ */
+static int parse(const char* data, size_t size, size_t push_size,
+    unsigned long long* events)
+{
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  parser.userdata = events;
+  if (!push_size) {
+    push_size = size;
+  }
+  int err = 0;
+  const size_t* split = random_splits;
+  for (size_t i = 0; i < size && !err;) {
+    size_t n = push_size == PUSH_RANDOM ? *split++ : push_size;
+    if (n > size - i) {
+      n = size - i;
+    }
+    err = embedjson_push(&parser, data + i, n);
+    i += n;
+  }
+  if (!err) {
+    err = embedjson_finalize(&parser);
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  return err;
+}
+
+/*
+ * Parses each newline-delimited record with a fresh parser, pushed at once
+ */
+static int parse_records(const char* data, size_t size,
+    unsigned long long* events)
+{
+  const char* end = data + size;
+  while (data != end) {
+    const char* eol = memchr(data, '\n', (size_t) (end - data));
+    size_t n = (size_t) ((eol ? eol : end) - data);
+    if (n && parse(data, n, 0, events)) {
+      return -1;
+    }
+    data += eol ? n + 1 : n;
+  }
+  return 0;
+}
+
+static int parse_corpus(const corpus* c, size_t push_size,
+    unsigned long long* events)
+{
+  if (c->ndjson && !c->stream) {
+    return parse_records(c->data, c->size, events);
+  }
+  return parse(c->data, c->size, push_size, events);
+}
+
+/*
+ * Returns the number of embedjson_push calls that parse_corpus makes
+ */
+static size_t count_pushes(const corpus* c, size_t push_size)
+{
+  if (c->ndjson && !c->stream) {
+    size_t n = 0;
+    for (size_t i = 0; i < c->size; ++i) {
+      n += c->data[i] == '\n';
+    }
+    return n;
+  }
+  if (!push_size) {
+    return 1;
+  }
+  if (push_size != PUSH_RANDOM) {
+    return (c->size + push_size - 1) / push_size;
+  }
+  size_t n = 0;
+  for (size_t total = 0; total < c->size; total += random_splits[n++]) {
+  }
+  return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_CYCLES 1
+static unsigned long long read_cycles(void)
+{
+  return __builtin_ia32_rdtsc();
+}
+#else
+#define HAVE_CYCLES 0
+static unsigned long long read_cycles(void)
+{
+  return 0;
+}
+#endif
+
+static double read_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+typedef struct measurement {
+  double seconds;
+  unsigned long long cycles;
+} measurement;
+
+static int compare_measurements(const void* lhs, const void* rhs)
+{
+  double a = ((const measurement*) lhs)->seconds;
+  double b = ((const measurement*) rhs)->seconds;
+  return (a > b) - (a < b);
+}
+
+/*
+ * Result of a corpus benchmark with the given push size
+ */
+typedef struct result {
+  const char* name;
+  size_t size;
+  size_t push_size;
+  size_t pushes;
+  unsigned long long events;
+  measurement median;
+  /*
+   * Time in excess of parsing the whole input at once, per push,
+   * in nanoseconds
+   */
+  double overhead;
+} result;
+
+/*
+ * Parses the corpus bench_runs times with the given push size, after
+ * a warm-up run. Returns non-zero value if the warm-up run fails.
+ */
+static int bench_push_size(const corpus* c, result* res, measurement* runs)
+{
+  unsigned long long events = 0;
+  res->size = c->size;
+  res->pushes = count_pushes(c, res->push_size);
+  if (parse_corpus(c, res->push_size, &events)) {
+    return -1;
+  }
+  for (unsigned i = 0; i < bench_runs; ++i) {
+    double seconds = read_seconds();
+    unsigned long long cycles = read_cycles();
+    parse_corpus(c, res->push_size, &events);
+    runs[i].cycles = read_cycles() - cycles;
+    runs[i].seconds = read_seconds() - seconds;
+  }
+  qsort(runs, bench_runs, sizeof(*runs), compare_measurements);
+  res->median = runs[bench_runs / 2];
+  return 0;
+}
+
+static void format_push_size(char* buf, size_t size, size_t push_size)
+{
+  if (!push_size) {
+    snprintf(buf, size, "whole");
+  } else if (push_size == PUSH_RANDOM) {
+    snprintf(buf, size, "random");
+  } else {
+    snprintf(buf, size, "%llu", (unsigned long long) push_size);
+  }
+}
+
+/*
+ * Parses the corpus once to validate it and count events, then measures
+ * each push size, the whole input only unless in --push-sizes mode.
+ * Returns the number of results, or zero if the corpus can not be parsed.
+ */
+static size_t bench_corpus(const corpus* c, const char* name,
+    result* results, measurement* runs)
+{
+  unsigned long long events = 0;
+  if (parse_corpus(c, 0, &events)) {
+    fprintf(stderr, "error parsing corpus '%s'\n", name);
+    return 0;
+  }
+  /* Records parsed one by one are always pushed at once */
+  int records = c->ndjson && !c->stream;
+  size_t n = push_sweep && !records ? NPUSH_SIZES : 1;
+  if (n > 1) {
+    split_randomly(c->size);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    result* res = results + i;
+    res->name = name;
+    res->push_size = push_sizes[i];
+    res->events = events;
+    if (bench_push_size(c, res, runs)) {
+      char label[32];
+      format_push_size(label, sizeof(label), res->push_size);
+      fprintf(stderr, "error parsing corpus '%s' with push size %s\n",
+          name, label);
+      return 0;
+    }
+    res->overhead = 1e9 * (res->median.seconds - results->median.seconds)
+      / (double) res->pushes;
+  }
+  return n;
+}
+
+static void print_cycles(const result* res)
+{
+  if (HAVE_CYCLES) {
+    printf(" %12.2f", (double) res->median.cycles / (double) res->size);
+  } else {
+    printf(" %12s", "n/a");
+  }
+}
+
+static void print_table(const result* results, size_t n)
+{
+  printf("seed %llu, median of %u runs\n", seed, bench_runs);
+  if (push_sweep) {
+    printf("%-14s %-9s %10s %10s %12s %10s %12s\n", "corpus", "push size",
+        "pushes", "MB/s", "cycles/byte", "ns/push", "overhead ns");
+  } else {
+    printf("%-14s %10s %10s %10s %10s %12s\n",
+        "corpus", "bytes", "events", "MB/s", "Mevents/s", "cycles/byte");
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const result* res = results + i;
+    double mbps = 1e-6 * (double) res->size / res->median.seconds;
+    if (!push_sweep) {
+      printf("%-14s %10llu %10llu %10.2f %10.2f", res->name,
+          (unsigned long long) res->size, res->events, mbps,
+          1e-6 * (double) res->events / res->median.seconds);
+      print_cycles(res);
+      printf("\n");
+      continue;
+    }
+    char label[32];
+    format_push_size(label, sizeof(label), res->push_size);
+    printf("%-14s %-9s %10llu %10.2f", res->name, label,
+        (unsigned long long) res->pushes, mbps);
+    print_cycles(res);
+    printf(" %10.2f", 1e9 * res->median.seconds / (double) res->pushes);
+    if (res->push_size) {
+      printf(" %12.2f\n", res->overhead);
+    } else {
+      printf(" %12s\n", "-");
+    }
+  }
+}
+
+static void print_json(FILE* out, const result* results, size_t n)
+{
+  fprintf(out, "{\"seed\":%llu,\"runs\":%u,\"results\":[", seed,
+      bench_runs);
+  for (size_t i = 0; i < n; ++i) {
+    const result* res = results + i;
+    char label[32];
+    format_push_size(label, sizeof(label), res->push_size);
+    fprintf(out, "%s\n{\"corpus\":\"%s\",\"push_size\":\"%s\","
+        "\"pushes\":%llu,\"bytes\":%llu,\"events\":%llu,"
+        "\"seconds\":%.9f,\"mb_per_s\":%.2f,\"mevents_per_s\":%.2f,"
+        "\"ns_per_push\":%.2f,\"overhead_ns_per_push\":", i ? "," : "",
+        res->name, label, (unsigned long long) res->pushes,
+        (unsigned long long) res->size, res->events, res->median.seconds,
+        1e-6 * (double) res->size / res->median.seconds,
+        1e-6 * (double) res->events / res->median.seconds,
+        1e9 * res->median.seconds / (double) res->pushes);
+    if (res->push_size) {
+      fprintf(out, "%.2f", res->overhead);
+    } else {
+      fprintf(out, "null");
+    }
+    fprintf(out, ",\"cycles_per_byte\":");
+    if (HAVE_CYCLES) {
+      fprintf(out, "%.2f}",
+          (double) res->median.cycles / (double) res->size);
+    } else {
+      fprintf(out, "null}");
+    }
+  }
+  fprintf(out, "\n]}\n");
+}
+
+/*
+ * Returns non-zero value if name is in the comma-separated list
+ */
+static int in_list(const char* list, const char* name)
+{
+  size_t n = strlen(name);
+  for (;;) {
+    size_t len = strcspn(list, ",");
+    if (len == n && !strncmp(list, name, n)) {
+      return 1;
+    }
+    if (!list[len]) {
+      return 0;
+    }
+    list += len + 1;
+  }
+}
+
+static void usage(FILE* out)
+{
+  fprintf(out, "usage: embedjson-bench [--size BYTES] [--runs N] "
+      "[--seed N] [--corpus NAME,...] [--push-sizes] [--json FILE]\n");
+  fprintf(out, "corpora (arguments of embedjson-gen):\n");
+  for (size_t i = 0; i < NCORPORA; ++i) {
+    fprintf(out, "  %-14s %s%s\n", corpus_types[i].name,
+        corpus_types[i].args, corpus_types[i].stream ? " (stream mode)" : "");
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+      corpus_size = strtoul(argv[++i], NULL, 0);
+      if (!corpus_size) {
+        fprintf(stderr, "invalid corpus size '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+      bench_runs = (unsigned) strtoul(argv[++i], NULL, 0);
+      if (!bench_runs) {
+        fprintf(stderr, "invalid number of runs '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--corpus") && i + 1 < argc) {
+      corpus_names = argv[++i];
+    } else if (!strcmp(argv[i], "--push-sizes")) {
+      push_sweep = 1;
+    } else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+      json_output = argv[++i];
+    } else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+      usage(stdout);
+      return 0;
+    } else {
+      usage(stderr);
+      return 1;
+    }
+  }
+  if (corpus_names) {
+    /* Unknown names are most likely typos */
+    for (const char* p = corpus_names; *p;) {
+      size_t n = strcspn(p, ",");
+      size_t i = 0;
+      while (i < NCORPORA && (strlen(corpus_types[i].name) != n
+            || strncmp(corpus_types[i].name, p, n))) {
+        ++i;
+      }
+      if (!n || i == NCORPORA) {
+        fprintf(stderr, "unknown corpus '%.*s'\n", (int) n, p);
+        usage(stderr);
+        return 1;
+      }
+      p += p[n] ? n + 1 : n;
+    }
+  }
+  result results[NCORPORA * NPUSH_SIZES];
+  size_t nresults = 0;
+  measurement* runs = malloc(bench_runs * sizeof(*runs));
+  corpus c;
+  memset(&c, 0, sizeof(c));
+  int err = !runs;
+  for (size_t i = 0; i < NCORPORA && !err; ++i) {
+    if (corpus_names && !in_list(corpus_names, corpus_types[i].name)) {
+      continue;
+    }
+    generate(&c, corpus_types + i);
+    size_t n = bench_corpus(&c, corpus_types[i].name, results + nresults,
+        runs);
+    err = !n;
+    nresults += n;
+  }
+  free(c.data);
+  free(runs);
+  free(random_splits);
+  if (err) {
+    return 1;
+  }
+  if (json_output && !strcmp(json_output, "-")) {
+    print_json(stdout, results, nresults);
+    return 0;
+  }
+  print_table(results, nresults);
+  if (json_output) {
+    FILE* out = fopen(json_output, "w");
+    if (!out) {
+      fprintf(stderr, "can not open '%s'\n", json_output);
+      return 1;
+    }
+    print_json(out, results, nresults);
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+/*
+ * Generator of synthetic JSON documents with the given characteristics,
+ * see embedjson_gen.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "embedjson_gen.h"
+
+static gen generator;
+
+static void write_output(void* context, const char* data, size_t size)
+{
+  if (fwrite(data, 1, size, (FILE*) context) != size) {
+    perror("error writing output");
+    exit(1);
+  }
+}
+
+static void usage(FILE* f)
+{
+  fprintf(f,
+      "usage: embedjson-gen [options]\n"
+      "  -o FILE                  output file, stdout by default\n"
+      "  --seed N                 seed of the generator (1)\n"
+      "  --size BYTES[K|M|G]      approximate size of the output (1M)\n"
+      "  --depth MIN:MAX          nesting depth of records (1:4)\n"
+      "  --keys MIN:MAX           members of objects and arrays (1:8)\n"
+      "  --string-length MIN:MAX  characters in strings (0:32)\n"
+      "  --escapes PERCENT        escaped characters in strings (0)\n"
+      "  --non-ascii PERCENT      non-ASCII characters in strings (0)\n"
+      "  --containers ARRAY:OBJECT\n"
+      "                           weights of container types (1:1)\n"
+      "  --scalars STRING:NUMBER:LITERAL\n"
+      "                           weights of scalar types (4:4:2)\n"
+      "  --numbers INT:FLOAT:BIG  weights of number types (70:30:0)\n"
+      "  --whitespace STYLE       compact, pretty or random (compact)\n"
+      "  --ndjson                 newline-delimited records instead of\n"
+      "                           a top-level array\n");
+}
+
+int main(int argc, char* argv[])
+{
+  gen_options options = gen_default_options;
+  const char* output_file = NULL;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+      usage(stdout);
+      return 0;
+    } else if (!strcmp(arg, "-o") && value) {
+      output_file = value;
+      ++i;
+      continue;
+    }
+    int n = gen_parse_option(&options, arg, value);
+    if (!n) {
+      usage(stderr);
+      return 1;
+    }
+    if (n < 0) {
+      fprintf(stderr, "invalid argument of %s\n", arg);
+      usage(stderr);
+      return 1;
+    }
+    i += n - 1;
+  }
+  FILE* out = stdout;
+  if (output_file) {
+    out = fopen(output_file, "wb");
+    if (!out) {
+      perror(output_file);
+      return 1;
+    }
+  }
+  gen_generate(&generator, &options, write_output, out);
+  if (fclose(out)) {
+    perror("error writing output");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,562 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+/*
+ * Generator of synthetic JSON documents with the given characteristics,
+ * shared by embedjson-gen and embedjson-bench. The output depends only on
+ * the options, so a corpus can be reproduced from the command line
+ * instead of being shared.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Inclusive range of values, see gen_parse_range
+ */
+typedef struct gen_range {
+  unsigned min;
+  unsigned max;
+} gen_range;
+
+enum {
+  GEN_WHITESPACE_COMPACT,
+  GEN_WHITESPACE_PRETTY,
+  GEN_WHITESPACE_RANDOM
+};
+
+enum {
+  GEN_CONTAINER_ARRAY,
+  GEN_CONTAINER_OBJECT,
+  GEN_CONTAINER_COUNT
+};
+
+enum {
+  GEN_SCALAR_STRING,
+  GEN_SCALAR_NUMBER,
+  GEN_SCALAR_LITERAL,
+  GEN_SCALAR_COUNT
+};
+
+enum {
+  GEN_NUMBER_INT,
+  GEN_NUMBER_FLOAT,
+  GEN_NUMBER_BIG,
+  GEN_NUMBER_COUNT
+};
+
+/* Containers are generated recursively */
+#define GEN_MAX_DEPTH 4096
+
+/*
+ * Characteristics of the generated corpus, see embedjson-gen --help
+ */
+typedef struct gen_options {
+  unsigned long long seed;
+  unsigned long long size;
+  gen_range depth;
+  gen_range keys;
+  gen_range string_length;
+  unsigned escape_percent;
+  unsigned non_ascii_percent;
+  unsigned container_weights[GEN_CONTAINER_COUNT];
+  unsigned scalar_weights[GEN_SCALAR_COUNT];
+  unsigned number_weights[GEN_NUMBER_COUNT];
+  int whitespace;
+  int ndjson;
+} gen_options;
+
+static const gen_options gen_default_options = {
+  .seed = 1,
+  .size = 1 << 20,
+  .depth = {1, 4},
+  .keys = {1, 8},
+  .string_length = {0, 32},
+  .container_weights = {1, 1},
+  .scalar_weights = {4, 4, 2},
+  .number_weights = {70, 30, 0},
+  .whitespace = GEN_WHITESPACE_COMPACT
+};
+
+/*
+ * Deterministic pseudo-random number generator (xorshift64*), so that
+ * the corpora are the same on every machine and every run
+ */
+typedef struct gen_rng {
+  unsigned long long state;
+} gen_rng;
+
+static void gen_rng_init(gen_rng* r, unsigned long long seed)
+{
+  /* Zero state is a fixed point of xorshift */
+  r->state = seed * 0x9E3779B97F4A7C15ull + 1;
+}
+
+static unsigned long long gen_rng_next(gen_rng* r)
+{
+  r->state ^= r->state >> 12;
+  r->state ^= r->state << 25;
+  r->state ^= r->state >> 27;
+  return r->state * 2685821657736338717ull;
+}
+
+/*
+ * Returns a number in [0, n)
+ */
+static unsigned gen_rng_below(gen_rng* r, unsigned n)
+{
+  return (unsigned) ((gen_rng_next(r) >> 32) % n);
+}
+
+static unsigned gen_rng_range(gen_rng* r, gen_range range)
+{
+  return range.min + (unsigned) ((gen_rng_next(r) >> 32)
+      % ((unsigned long long) range.max - range.min + 1));
+}
+
+/*
+ * Returns non-zero value with the given probability
+ */
+static int gen_rng_percent(gen_rng* r, unsigned percent)
+{
+  return gen_rng_below(r, 100) < percent;
+}
+
+/*
+ * Returns an index drawn with the given relative weights
+ */
+static int gen_rng_weighted(gen_rng* r, const unsigned* weights, int n)
+{
+  unsigned total = 0;
+  for (int i = 0; i < n; ++i) {
+    total += weights[i];
+  }
+  unsigned w = gen_rng_below(r, total);
+  int i = 0;
+  while (w >= weights[i]) {
+    w -= weights[i++];
+  }
+  return i;
+}
+
+/*
+ * Object keys are taken from a small dictionary, as in real documents
+ */
+#define GEN_NKEYS 64
+
+/*
+ * Generator state. Output is buffered and passed to write when the buffer
+ * is full, so multi-gigabyte corpora take no memory.
+ */
+typedef struct gen {
+  gen_options options;
+  gen_rng rng;
+  char keys[GEN_NKEYS][16];
+  void (*write)(void* context, const char* data, size_t size);
+  void* context;
+  unsigned long long total;
+  size_t size;
+  char buffer[1 << 16];
+} gen;
+
+static void gen_flush(gen* g)
+{
+  if (g->size) {
+    g->write(g->context, g->buffer, g->size);
+  }
+  g->size = 0;
+}
+
+static void gen_put_char(gen* g, char c)
+{
+  if (g->size == sizeof(g->buffer)) {
+    gen_flush(g);
+  }
+  g->buffer[g->size++] = c;
+  ++g->total;
+}
+
+static void gen_put(gen* g, const char* s)
+{
+  while (*s) {
+    gen_put_char(g, *s++);
+  }
+}
+
+static void gen_put_digits(gen* g, unsigned n)
+{
+  gen_put_char(g, (char) ('1' + gen_rng_below(&g->rng, 9)));
+  for (unsigned i = 1; i < n; ++i) {
+    gen_put_char(g, (char) ('0' + gen_rng_below(&g->rng, 10)));
+  }
+}
+
+/*
+ * Whitespace before a token at the given nesting level. Pretty-printed
+ * output has one value or key per line.
+ */
+static void gen_put_newline(gen* g, unsigned level)
+{
+  if (g->options.whitespace == GEN_WHITESPACE_PRETTY) {
+    gen_put_char(g, '\n');
+    for (unsigned i = 0; i < level; ++i) {
+      gen_put(g, "  ");
+    }
+  } else if (g->options.whitespace == GEN_WHITESPACE_RANDOM) {
+    static const char spaces[] = " \t\n\r";
+    for (unsigned i = 0, n = gen_rng_below(&g->rng, 4); i < n; ++i) {
+      gen_put_char(g, spaces[gen_rng_below(&g->rng, 4)]);
+    }
+  }
+}
+
+static void gen_put_colon(gen* g)
+{
+  gen_put_char(g, ':');
+  if (g->options.whitespace == GEN_WHITESPACE_PRETTY) {
+    gen_put_char(g, ' ');
+  } else if (g->options.whitespace == GEN_WHITESPACE_RANDOM) {
+    gen_put_newline(g, 0);
+  }
+}
+
+static const char* gen_escapes[] = {
+  "\\n", "\\t", "\\r", "\\b", "\\f", "\\\"", "\\\\", "\\/", "\\u00e9",
+  "\\u20ac", "\\ud83d\\ude00"
+};
+
+#define GEN_NESCAPES (sizeof(gen_escapes) / sizeof(gen_escapes[0]))
+
+static const char gen_alphabet[] =
+  "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+
+/*
+ * Appends UTF-8 encoding of a random non-ASCII code point: two, three
+ * or four bytes long, surrogates excluded
+ */
+static void gen_put_non_ascii(gen* g)
+{
+  unsigned cp;
+  switch (gen_rng_below(&g->rng, 3)) {
+    case 0:
+      cp = 0x80 + gen_rng_below(&g->rng, 0x800 - 0x80);
+      gen_put_char(g, (char) (0xC0 | cp >> 6));
+      break;
+    case 1:
+      do {
+        cp = 0x800 + gen_rng_below(&g->rng, 0x10000 - 0x800);
+      } while (cp >= 0xD800 && cp < 0xE000);
+      gen_put_char(g, (char) (0xE0 | cp >> 12));
+      gen_put_char(g, (char) (0x80 | (cp >> 6 & 0x3F)));
+      break;
+    default:
+      cp = 0x10000 + gen_rng_below(&g->rng, 0x110000 - 0x10000);
+      gen_put_char(g, (char) (0xF0 | cp >> 18));
+      gen_put_char(g, (char) (0x80 | (cp >> 12 & 0x3F)));
+      gen_put_char(g, (char) (0x80 | (cp >> 6 & 0x3F)));
+      break;
+  }
+  gen_put_char(g, (char) (0x80 | (cp & 0x3F)));
+}
+
+/*
+ * String of string_length characters, each of which is escaped with
+ * escape_percent probability, or is non-ASCII with non_ascii_percent
+ * probability
+ */
+static void gen_put_string(gen* g)
+{
+  gen_put_char(g, '"');
+  for (unsigned i = 0, n = gen_rng_range(&g->rng, g->options.string_length);
+      i < n; ++i) {
+    if (gen_rng_percent(&g->rng, g->options.escape_percent)) {
+      gen_put(g, gen_escapes[gen_rng_below(&g->rng, GEN_NESCAPES)]);
+    } else if (gen_rng_percent(&g->rng, g->options.non_ascii_percent)) {
+      gen_put_non_ascii(g);
+    } else {
+      gen_put_char(g, gen_alphabet[gen_rng_below(&g->rng,
+            sizeof(gen_alphabet) - 1)]);
+    }
+  }
+  gen_put_char(g, '"');
+}
+
+static void gen_init_keys(gen* g)
+{
+  for (int i = 0; i < GEN_NKEYS; ++i) {
+    unsigned n = 3 + gen_rng_below(&g->rng, 10);
+    for (unsigned j = 0; j < n; ++j) {
+      g->keys[i][j] = (char) ('a' + gen_rng_below(&g->rng, 26));
+    }
+    g->keys[i][n] = 0;
+  }
+}
+
+static void gen_put_number(gen* g)
+{
+  int kind = gen_rng_weighted(&g->rng, g->options.number_weights,
+      GEN_NUMBER_COUNT);
+  if (gen_rng_below(&g->rng, 4) == 0) {
+    gen_put_char(g, '-');
+  }
+  switch (kind) {
+    case GEN_NUMBER_INT:
+      if (gen_rng_below(&g->rng, 8) == 0) {
+        gen_put_char(g, '0');
+      } else {
+        gen_put_digits(g, 1 + gen_rng_below(&g->rng, 18));
+      }
+      break;
+    case GEN_NUMBER_FLOAT:
+      /*
+       * Digits are generated rather than printed, so are the same
+       * in any libc
+       */
+      gen_put_digits(g, 1 + gen_rng_below(&g->rng, 6));
+      gen_put_char(g, '.');
+      gen_put_digits(g, 1 + gen_rng_below(&g->rng, 12));
+      if (gen_rng_below(&g->rng, 4) == 0) {
+        gen_put_char(g, 'e');
+        gen_put(g, gen_rng_below(&g->rng, 2) ? "-" : "+");
+        gen_put_digits(g, 1 + gen_rng_below(&g->rng, 2));
+      }
+      break;
+    default:
+      /* Does not fit into 64 bits, see EMBEDJSON_BIGNUM */
+      gen_put_digits(g, 20 + gen_rng_below(&g->rng, 20));
+      break;
+  }
+}
+
+static void gen_put_scalar(gen* g)
+{
+  static const char* literals[] = {"true", "false", "null"};
+  switch (gen_rng_weighted(&g->rng, g->options.scalar_weights,
+        GEN_SCALAR_COUNT)) {
+    case GEN_SCALAR_STRING:
+      gen_put_string(g);
+      break;
+    case GEN_SCALAR_NUMBER:
+      gen_put_number(g);
+      break;
+    default:
+      gen_put(g, literals[gen_rng_below(&g->rng, 3)]);
+      break;
+  }
+}
+
+/*
+ * Value of exactly the given depth: a chain of nested containers with
+ * keys count members each (at least one), other members are scalars
+ */
+static void gen_put_value(gen* g, unsigned depth, unsigned level)
+{
+  if (!depth) {
+    gen_put_scalar(g);
+    return;
+  }
+  int object = gen_rng_weighted(&g->rng, g->options.container_weights,
+      GEN_CONTAINER_COUNT) == GEN_CONTAINER_OBJECT;
+  unsigned n = gen_rng_range(&g->rng, g->options.keys);
+  if (!n) {
+    n = 1;
+  }
+  unsigned nested = gen_rng_below(&g->rng, n);
+  gen_put_char(g, object ? '{' : '[');
+  for (unsigned i = 0; i < n; ++i) {
+    if (i) {
+      gen_put_char(g, ',');
+    }
+    gen_put_newline(g, level + 1);
+    if (object) {
+      gen_put_char(g, '"');
+      gen_put(g, g->keys[gen_rng_below(&g->rng, GEN_NKEYS)]);
+      gen_put_char(g, '"');
+      gen_put_colon(g);
+    }
+    if (i == nested) {
+      gen_put_value(g, depth - 1, level + 1);
+    } else {
+      gen_put_scalar(g);
+    }
+  }
+  gen_put_newline(g, level);
+  gen_put_char(g, object ? '}' : ']');
+}
+
+/*
+ * Writes records until options->size bytes are written. Records are
+ * elements of a top-level array, or top-level values separated
+ * by newlines.
+ */
+static void gen_generate(gen* g, const gen_options* options,
+    void (*write)(void* context, const char* data, size_t size),
+    void* context)
+{
+  g->options = *options;
+  g->write = write;
+  g->context = context;
+  g->total = 0;
+  g->size = 0;
+  gen_rng_init(&g->rng, options->seed);
+  gen_init_keys(g);
+  if (!options->ndjson) {
+    gen_put_char(g, '[');
+  }
+  for (int first = 1; g->total < options->size; first = 0) {
+    if (options->ndjson) {
+      gen_put_value(g, gen_rng_range(&g->rng, options->depth), 0);
+      gen_put_char(g, '\n');
+      continue;
+    }
+    if (!first) {
+      gen_put_char(g, ',');
+    }
+    gen_put_newline(g, 1);
+    gen_put_value(g, gen_rng_range(&g->rng, options->depth), 1);
+  }
+  if (!options->ndjson) {
+    gen_put_newline(g, 0);
+    gen_put(g, "]\n");
+  }
+  gen_flush(g);
+}
+
+/*
+ * Parses a number with an optional K, M or G suffix
+ */
+static int gen_parse_size(const char* s, unsigned long long* size)
+{
+  char* end;
+  if (*s < '0' || *s > '9') {
+    return -1;
+  }
+  *size = strtoull(s, &end, 0);
+  switch (*end) {
+    case 'G':
+      *size <<= 10;
+      /* fallthrough */
+    case 'M':
+      *size <<= 10;
+      /* fallthrough */
+    case 'K':
+      *size <<= 10;
+      ++end;
+      break;
+  }
+  return *end ? -1 : 0;
+}
+
+static int gen_parse_unsigned(const char* s, unsigned* value, char** end)
+{
+  if (*s < '0' || *s > '9') {
+    return -1;
+  }
+  unsigned long n = strtoul(s, end, 10);
+  if (n > 1000000000ul) {
+    return -1;
+  }
+  *value = (unsigned) n;
+  return 0;
+}
+
+/*
+ * Parses "N" or "MIN:MAX"
+ */
+static int gen_parse_range(const char* s, gen_range* r)
+{
+  char* end;
+  if (gen_parse_unsigned(s, &r->min, &end)) {
+    return -1;
+  }
+  r->max = r->min;
+  if (*end == ':' && gen_parse_unsigned(end + 1, &r->max, &end)) {
+    return -1;
+  }
+  return *end || r->min > r->max ? -1 : 0;
+}
+
+static int gen_parse_percent(const char* s, unsigned* percent)
+{
+  char* end;
+  return gen_parse_unsigned(s, percent, &end) || *end || *percent > 100
+    ? -1 : 0;
+}
+
+/*
+ * Parses n weights separated by colons, e.g. "INT:FLOAT:BIG"
+ */
+static int gen_parse_weights(const char* s, unsigned* weights, int n)
+{
+  unsigned total = 0;
+  for (int i = 0; i < n; ++i) {
+    char* end;
+    if ((i && *s++ != ':') || gen_parse_unsigned(s, weights + i, &end)) {
+      return -1;
+    }
+    total += weights[i];
+    s = end;
+  }
+  return *s || !total ? -1 : 0;
+}
+
+/*
+ * Sets the corpus option arg of embedjson-gen to value (ignored by flags).
+ * Returns the number of arguments used, zero if arg is not a corpus
+ * option, or -1 if value is invalid.
+ */
+static int gen_parse_option(gen_options* o, const char* arg,
+    const char* value)
+{
+  int err = 0;
+  if (!strcmp(arg, "--ndjson")) {
+    o->ndjson = 1;
+    return 1;
+  } else if (!strcmp(arg, "--seed")) {
+    err = !value;
+    if (!err) {
+      o->seed = strtoull(value, NULL, 0);
+    }
+  } else if (!strcmp(arg, "--size")) {
+    err = !value || gen_parse_size(value, &o->size);
+  } else if (!strcmp(arg, "--depth")) {
+    err = !value || gen_parse_range(value, &o->depth)
+      || o->depth.max > GEN_MAX_DEPTH;
+  } else if (!strcmp(arg, "--keys")) {
+    err = !value || gen_parse_range(value, &o->keys);
+  } else if (!strcmp(arg, "--string-length")) {
+    err = !value || gen_parse_range(value, &o->string_length);
+  } else if (!strcmp(arg, "--escapes")) {
+    err = !value || gen_parse_percent(value, &o->escape_percent);
+  } else if (!strcmp(arg, "--non-ascii")) {
+    err = !value || gen_parse_percent(value, &o->non_ascii_percent);
+  } else if (!strcmp(arg, "--containers")) {
+    err = !value || gen_parse_weights(value, o->container_weights,
+        GEN_CONTAINER_COUNT);
+  } else if (!strcmp(arg, "--scalars")) {
+    err = !value || gen_parse_weights(value, o->scalar_weights,
+        GEN_SCALAR_COUNT);
+  } else if (!strcmp(arg, "--numbers")) {
+    err = !value || gen_parse_weights(value, o->number_weights,
+        GEN_NUMBER_COUNT);
+  } else if (!strcmp(arg, "--whitespace")) {
+    if (value && !strcmp(value, "compact")) {
+      o->whitespace = GEN_WHITESPACE_COMPACT;
+    } else if (value && !strcmp(value, "pretty")) {
+      o->whitespace = GEN_WHITESPACE_PRETTY;
+    } else if (value && !strcmp(value, "random")) {
+      o->whitespace = GEN_WHITESPACE_RANDOM;
+    } else {
+      err = 1;
+    }
+  } else {
+    return 0;
+  }
+  return err ? -1 : 2;
+}
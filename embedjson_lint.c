@@ -5,13 +5,26 @@
  * Licensed under the MIT License (see LICENSE)
  */
 
+/* O_DIRECT, embedjson_push_fd and POSIX 2008 functions */
+#define _GNU_SOURCE
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <glob.h>
 
+#define EMBEDJSON_READER 1
+#define EMBEDJSON_DECOMPRESS 1
 #include <embedjson.c>
 
 /**
@@ -19,101 +32,195 @@
  */
 static int verbose = 0;
 static const char* input_file = NULL;
+static const char* files_from = NULL;
+static const char* include_pattern = "*.json";
+static unsigned jobs = 0;
+static size_t buffer_size = 1 << 20;
+static int direct = 0;
+static int decompress = 0;
+static int pipeline = 0;
+static int bench = 0;
+static unsigned bench_runs = 10;
+static const char* push_sizes = "0";
+
+/*
+ * Types of callback calls
+ */
+enum {
+  EVENT_NULL,
+  EVENT_BOOL,
+  EVENT_INT,
+  EVENT_DOUBLE,
+  EVENT_STRING_BEGIN,
+  EVENT_STRING_CHUNK,
+  EVENT_STRING_END,
+  EVENT_OBJECT_BEGIN,
+  EVENT_OBJECT_END,
+  EVENT_ARRAY_BEGIN,
+  EVENT_ARRAY_END,
+  EVENT_BIGNUM_BEGIN,
+  EVENT_BIGNUM_CHUNK,
+  EVENT_BIGNUM_END,
+  EVENT_COUNT
+};
+
+static const char* event_names[EVENT_COUNT] = {
+  "null",
+  "bool",
+  "int",
+  "double",
+  "string begin",
+  "string chunk",
+  "string end",
+  "object begin",
+  "object end",
+  "array begin",
+  "array end",
+  "bignum begin",
+  "bignum chunk",
+  "bignum end"
+};
 
-static const char* error_position = NULL;
-static embedjson_error_code error_code = EMBEDJSON_OK;
+/*
+ * Per-input state, pointed to by embedjson_parser.userdata
+ */
+typedef struct lint_state {
+  /* Verbose output, NULL if events are not printed */
+  FILE* out;
+  /*
+   * Symbol at the error position. The position itself may point into
+   * a temporary buffer (see EMBEDJSON_TRANSCODE), so the symbol is copied
+   */
+  char error_symbol;
+  embedjson_error_code error_code;
+  /* Number of callback calls of each type */
+  unsigned long long events[EVENT_COUNT];
+} lint_state;
+
+static void lint_state_init(lint_state* state, FILE* out)
+{
+  memset(state, 0, sizeof(*state));
+  state->out = out;
+  state->error_symbol = '?';
+}
 
-#define EMBEDJSON_PRINTF(...) \
+#define EMBEDJSON_PRINTF(state, ...) \
 { \
-  if (verbose) { \
-    printf(__VA_ARGS__); \
+  if ((state)->out) { \
+    fprintf((state)->out, __VA_ARGS__); \
   } \
 }
 
 static int embedjson_error(embedjson_parser* parser, const char* position)
 {
-  EMBEDJSON_UNUSED(parser);
-  error_position = position;
+  lint_state* state = parser->userdata;
+  if (position) {
+    state->error_symbol = *position;
+  }
   /** @todo When 3.0 is released, real erro code will be reported here */
-  error_code = EMBEDJSON_INTERNAL_ERROR;
+  state->error_code = EMBEDJSON_INTERNAL_ERROR;
   return 1;
 }
 
 static int embedjson_null(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("null\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_NULL];
+  EMBEDJSON_PRINTF(state, "null\n");
   return 0;
 }
 
 static int embedjson_bool(embedjson_parser* parser, char value)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("bool %s\n", value ? "true" : "false");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_BOOL];
+  EMBEDJSON_PRINTF(state, "bool %s\n", value ? "true" : "false");
   return 0;
 }
 
 static int embedjson_int(embedjson_parser* parser, embedjson_int_t value)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("int %lld\n", value);
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_INT];
+  EMBEDJSON_PRINTF(state, "int %lld\n", value);
   return 0;
 }
 
 static int embedjson_double(embedjson_parser* parser, double value)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("double %lf\n", value);
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_DOUBLE];
+  EMBEDJSON_PRINTF(state, "double %lf\n", value);
   return 0;
 }
 
 static int embedjson_string_begin(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("begin string\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_STRING_BEGIN];
+  EMBEDJSON_PRINTF(state, "begin string\n");
   return 0;
 }
 
+#if EMBEDJSON_UTF16_STRINGS
+static int embedjson_string_chunk16(embedjson_parser* parser,
+    const embedjson_char16_t* data, embedjson_size_t size)
+{
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_STRING_CHUNK];
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_PRINTF(state, "string of %llu UTF-16 code units\n",
+      (unsigned long long) size);
+  return 0;
+}
+#else
 static int embedjson_string_chunk(embedjson_parser* parser,
     const char* data, embedjson_size_t size)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("string %.*s\n", (int) size, data);
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_STRING_CHUNK];
+  EMBEDJSON_PRINTF(state, "string %.*s\n", (int) size, data);
   return 0;
 }
+#endif /* EMBEDJSON_UTF16_STRINGS */
 
 static int embedjson_string_end(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("end string\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_STRING_END];
+  EMBEDJSON_PRINTF(state, "end string\n");
   return 0;
 }
 
 static int embedjson_object_begin(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("begin object\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_OBJECT_BEGIN];
+  EMBEDJSON_PRINTF(state, "begin object\n");
   return 0;
 }
 
 static int embedjson_object_end(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("end object\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_OBJECT_END];
+  EMBEDJSON_PRINTF(state, "end object\n");
   return 0;
 }
 
 static int embedjson_array_begin(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("begin array\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_ARRAY_BEGIN];
+  EMBEDJSON_PRINTF(state, "begin array\n");
   return 0;
 }
 
 static int embedjson_array_end(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("end array\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_ARRAY_END];
+  EMBEDJSON_PRINTF(state, "end array\n");
   return 0;
 }
 
@@ -121,23 +228,26 @@ static int embedjson_array_end(embedjson_parser* parser)
 static int embedjson_bignum_begin(embedjson_parser* parser,
     embedjson_int_t initial_value)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("begin big number, initial value %lld\n", initial_value);
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_BIGNUM_BEGIN];
+  EMBEDJSON_PRINTF(state, "begin big number, initial value %lld\n", initial_value);
   return 0;
 }
 
 static int embedjson_bignum_chunk(embedjson_parser* parser,
     const char* data, embedjson_size_t size)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("bignum %.*s\n", (int) size, data);
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_BIGNUM_CHUNK];
+  EMBEDJSON_PRINTF(state, "bignum %.*s\n", (int) size, data);
   return 0;
 }
 
 static int embedjson_bignum_end(embedjson_parser* parser)
 {
-  EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_PRINTF("end bignum\n");
+  lint_state* state = parser->userdata;
+  ++state->events[EVENT_BIGNUM_END];
+  EMBEDJSON_PRINTF(state, "end bignum\n");
   return 0;
 }
 #endif /* EMBEDJSON_BIGNUM */
@@ -156,40 +266,821 @@ static int embedjson_stack_overflow(embedjson_parser* parser)
 }
 #endif /* EMBEDJSON_DYNAMIC_STACK */
 
+/*
+ * Maps a non-empty regular file into memory. Returns non-zero value
+ * if the file can not be mapped, e.g. if it is a pipe.
+ */
+static int map_input(int fd, const char** data, size_t* size)
+{
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    return -1;
+  }
+  void* addr = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    return -1;
+  }
+  posix_madvise(addr, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+  *data = addr;
+  *size = (size_t) st.st_size;
+  return 0;
+}
+
+/*
+ * Reads the whole input into memory allocated with malloc(). Returns -1
+ * if input can not be read.
+ */
+static int read_input(int fd, char** data, size_t* size)
+{
+  size_t capacity = buffer_size;
+  size_t n = 0;
+  char* buf = malloc(capacity);
+  if (!buf) {
+    return -1;
+  }
+  for (;;) {
+    if (n == capacity) {
+      char* new_buf = realloc(buf, 2 * capacity);
+      if (!new_buf) {
+        free(buf);
+        return -1;
+      }
+      buf = new_buf;
+      capacity *= 2;
+    }
+    ssize_t r = read(fd, buf + n, capacity - n);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r < 0) {
+      free(buf);
+      return -1;
+    }
+    if (!r) {
+      break;
+    }
+    n += (size_t) r;
+  }
+  *data = buf;
+  *size = n;
+  return 0;
+}
+
+/*
+ * Parses data[0..size) with a fresh parser, pushing it in chunks
+ * of push_size bytes (the whole input at once if push_size is zero)
+ */
+static int parse_buffer(lint_state* state, const char* data, size_t size,
+    size_t push_size)
+{
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  parser.userdata = state;
+  if (!push_size) {
+    push_size = size;
+  }
+  int err = 0;
+  for (size_t i = 0; i < size && !err; i += push_size) {
+    size_t n = size - i < push_size ? size - i : push_size;
+    err = embedjson_push(&parser, data + i, n);
+  }
+  if (!err) {
+    err = embedjson_finalize(&parser);
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  return err;
+}
+
+/*
+ * Same as parse_buffer, for gzip or zstd input read from fd
+ */
+static int parse_compressed(lint_state* state, int fd)
+{
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  parser.userdata = state;
+  int err = embedjson_push_compressed(&parser, fd, buffer_size,
+      pipeline ? EMBEDJSON_DECOMPRESS_THREAD : 0);
+  if (!err) {
+    err = embedjson_finalize(&parser);
+  } else if (err == EMBEDJSON_BAD_COMPRESSION
+      || err == EMBEDJSON_THREAD_ERROR) {
+    /* Not reported by embedjson_error */
+    state->error_code = (embedjson_error_code) err;
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  return err;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_CYCLES 1
+static unsigned long long read_cycles(void)
+{
+  return __builtin_ia32_rdtsc();
+}
+#else
+#define HAVE_CYCLES 0
+static unsigned long long read_cycles(void)
+{
+  return 0;
+}
+#endif
+
+static double read_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+/*
+ * Larger than last level caches of common CPUs. Writing it evicts
+ * the input and the parser from caches before a cold run.
+ */
+#define EVICT_SIZE (64 << 20)
+static char* evict_buffer;
+
+static void evict_caches(void)
+{
+  for (size_t i = 0; i < EVICT_SIZE; i += 64) {
+    ++evict_buffer[i];
+  }
+}
+
+typedef struct measurement {
+  double seconds;
+  unsigned long long cycles;
+} measurement;
+
+static int compare_measurements(const void* lhs, const void* rhs)
+{
+  double a = ((const measurement*) lhs)->seconds;
+  double b = ((const measurement*) rhs)->seconds;
+  return (a > b) - (a < b);
+}
+
+/*
+ * Parses the input bench_runs times and returns the median run.
+ * Warm runs follow a warm-up run, caches are evicted before each cold run.
+ */
+static measurement bench_push_size(lint_state* state, const char* data,
+    size_t size, size_t push_size, int cold, measurement* runs)
+{
+  if (!cold) {
+    parse_buffer(state, data, size, push_size);
+  }
+  for (unsigned i = 0; i < bench_runs; ++i) {
+    if (cold) {
+      evict_caches();
+    }
+    double seconds = read_seconds();
+    unsigned long long cycles = read_cycles();
+    parse_buffer(state, data, size, push_size);
+    runs[i].cycles = read_cycles() - cycles;
+    runs[i].seconds = read_seconds() - seconds;
+  }
+  qsort(runs, bench_runs, sizeof(*runs), compare_measurements);
+  return runs[bench_runs / 2];
+}
+
+static void print_parse_error(FILE* out, const lint_state* state)
+{
+  fprintf(out, "error parsing json near symbol '%c': %s\n",
+      state->error_symbol,
+      embedjson_strerror(state->error_code));
+}
+
+/*
+ * Benchmark mode: parses data[0..size) repeatedly with each push size
+ * and prints throughput and the number of callback calls of each type
+ */
+static int run_bench(const char* data, size_t size)
+{
+  lint_state state;
+  lint_state_init(&state, NULL);
+  int err = parse_buffer(&state, data, size, 0);
+  if (err) {
+    print_parse_error(stderr, &state);
+    return err;
+  }
+  unsigned long long counts[EVENT_COUNT];
+  unsigned long long total = 0;
+  for (int i = 0; i < EVENT_COUNT; ++i) {
+    counts[i] = state.events[i];
+    total += state.events[i];
+  }
+  evict_buffer = calloc(EVICT_SIZE, 1);
+  measurement* runs = malloc(bench_runs * sizeof(*runs));
+  if (!evict_buffer || !runs) {
+    fprintf(stderr, "out of memory\n");
+    free(evict_buffer);
+    free(runs);
+    return 1;
+  }
+  printf("input: %llu bytes, %llu events, median of %u runs\n",
+      (unsigned long long) size, total, bench_runs);
+  printf("%-12s %-5s %10s %10s %12s\n",
+      "push size", "cache", "MB/s", "Mevents/s", "cycles/byte");
+  const char* p = push_sizes;
+  while (*p) {
+    char* end;
+    size_t push_size = strtoul(p, &end, 0);
+    for (int cold = 0; cold < 2; ++cold) {
+      measurement m = bench_push_size(&state, data, size, push_size, cold,
+          runs);
+      char label[32];
+      if (push_size) {
+        snprintf(label, sizeof(label), "%llu",
+            (unsigned long long) push_size);
+      } else {
+        snprintf(label, sizeof(label), "whole");
+      }
+      printf("%-12s %-5s %10.2f %10.2f", label, cold ? "cold" : "warm",
+          1e-6 * (double) size / m.seconds,
+          1e-6 * (double) total / m.seconds);
+      if (HAVE_CYCLES) {
+        printf(" %12.2f\n", (double) m.cycles / (double) size);
+      } else {
+        printf(" %12s\n", "n/a");
+      }
+    }
+    p = *end ? end + 1 : end;
+  }
+  printf("events:\n");
+  for (int i = 0; i < EVENT_COUNT; ++i) {
+    printf("  %-14s %llu\n", event_names[i], counts[i]);
+  }
+  free(evict_buffer);
+  free(runs);
+  return 0;
+}
+
+/*
+ * List of input files, see add_input
+ */
+typedef struct path_list {
+  char** paths;
+  size_t size;
+  size_t capacity;
+} path_list;
+
+static int path_list_add(path_list* list, const char* path)
+{
+  if (list->size == list->capacity) {
+    size_t new_capacity = 2 * list->capacity + 16;
+    char** new_paths = realloc(list->paths, new_capacity * sizeof(char*));
+    if (!new_paths) {
+      return -1;
+    }
+    list->paths = new_paths;
+    list->capacity = new_capacity;
+  }
+  char* copy = strdup(path);
+  if (!copy) {
+    return -1;
+  }
+  list->paths[list->size++] = copy;
+  return 0;
+}
+
+static void path_list_destroy(path_list* list)
+{
+  for (size_t i = 0; i < list->size; ++i) {
+    free(list->paths[i]);
+  }
+  free(list->paths);
+}
+
+static int compare_paths(const void* lhs, const void* rhs)
+{
+  return strcmp(*(char* const*) lhs, *(char* const*) rhs);
+}
+
+static int add_input(path_list* list, const char* input);
+
+/*
+ * Adds files from the directory and its subdirectories whose names match
+ * include_pattern, in the order of names
+ */
+static int add_directory(path_list* list, const char* dir)
+{
+  DIR* d = opendir(dir);
+  if (!d) {
+    /* Reported as an unreadable input */
+    return path_list_add(list, dir);
+  }
+  path_list names;
+  memset(&names, 0, sizeof(names));
+  int err = 0;
+  struct dirent* entry;
+  while (!err && (entry = readdir(d))) {
+    if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+      err = path_list_add(&names, entry->d_name);
+    }
+  }
+  closedir(d);
+  if (names.size) {
+    qsort(names.paths, names.size, sizeof(char*), compare_paths);
+  }
+  size_t dir_length = strlen(dir);
+  for (size_t i = 0; !err && i < names.size; ++i) {
+    char* path = malloc(dir_length + strlen(names.paths[i]) + 2);
+    if (!path) {
+      err = -1;
+      break;
+    }
+    sprintf(path, "%s%s%s", dir,
+        dir_length && dir[dir_length - 1] == '/' ? "" : "/", names.paths[i]);
+    struct stat st;
+    if (!stat(path, &st) && S_ISDIR(st.st_mode)) {
+      err = add_directory(list, path);
+    } else if (!fnmatch(include_pattern, names.paths[i], 0)) {
+      err = path_list_add(list, path);
+    }
+    free(path);
+  }
+  path_list_destroy(&names);
+  return err;
+}
+
+/*
+ * Adds a file, files from a directory, or files and directories that match
+ * a glob pattern. Returns -1 if memory can not be allocated.
+ */
+static int add_input(path_list* list, const char* input)
+{
+  struct stat st;
+  if (!stat(input, &st)) {
+    return S_ISDIR(st.st_mode)
+      ? add_directory(list, input)
+      : path_list_add(list, input);
+  }
+  glob_t g;
+  int rc = glob(input, 0, NULL, &g);
+  if (rc == GLOB_NOSPACE) {
+    return -1;
+  }
+  if (rc) {
+    /* Neither a file nor a pattern, reported as an unreadable input */
+    return path_list_add(list, input);
+  }
+  int err = 0;
+  for (size_t i = 0; !err && i < g.gl_pathc; ++i) {
+    err = add_input(list, g.gl_pathv[i]);
+  }
+  globfree(&g);
+  return err;
+}
+
+/*
+ * Adds inputs listed in the file, one per line. "-" stands for stdin.
+ */
+static int add_inputs_from(path_list* list, const char* filename)
+{
+  FILE* f = strcmp(filename, "-") ? fopen(filename, "r") : stdin;
+  if (!f) {
+    fprintf(stderr, "can not open '%s': %s\n", filename, strerror(errno));
+    return 1;
+  }
+  char* line = NULL;
+  size_t capacity = 0;
+  ssize_t length;
+  int err = 0;
+  while (!err && (length = getline(&line, &capacity, f)) >= 0) {
+    if (length && line[length - 1] == '\n') {
+      line[--length] = 0;
+    }
+    if (length) {
+      err = add_input(list, line);
+    }
+  }
+  free(line);
+  if (f != stdin) {
+    fclose(f);
+  }
+  if (err) {
+    fprintf(stderr, "out of memory\n");
+  }
+  return err;
+}
+
+/*
+ * Validation of a single file in the multi-file mode
+ */
+typedef struct lint_task {
+  const char* path;
+  size_t size;
+  /* 0, -1 if the file can not be read, or error returned from the parser */
+  int err;
+  /* errno if the file can not be read */
+  int io_error;
+  lint_state state;
+  /* Verbose output, allocated with open_memstream() */
+  char* output;
+  size_t output_size;
+  /* Set when the task is complete, guarded by task_pool.mutex */
+  int done;
+} lint_task;
+
+static void lint_file(lint_task* task)
+{
+  FILE* out = NULL;
+  if (verbose) {
+    out = open_memstream(&task->output, &task->output_size);
+  }
+  lint_state_init(&task->state, out);
+  int fd = open(task->path, O_RDONLY);
+  if (fd < 0) {
+    task->err = -1;
+    task->io_error = errno;
+  } else {
+    const char* data;
+    char* buf = NULL;
+    int compressed = 0;
+    if (map_input(fd, &data, &task->size)) {
+      if (read_input(fd, &buf, &task->size)) {
+        task->err = -1;
+        task->io_error = errno;
+      }
+      data = buf;
+    } else if (embedjson_is_compressed(data, task->size)) {
+      munmap((void*) data, task->size);
+      compressed = 1;
+      task->err = parse_compressed(&task->state, fd);
+      if (task->err == EMBEDJSON_READ_ERROR) {
+        task->err = -1;
+        task->io_error = errno;
+      }
+    }
+    close(fd);
+    if (!task->err && !compressed) {
+      task->err = parse_buffer(&task->state, data, task->size, 0);
+      if (buf) {
+        free(buf);
+      } else {
+        munmap((void*) data, task->size);
+      }
+    }
+  }
+  if (out) {
+    fclose(out);
+  }
+  task->state.out = NULL;
+}
+
+/*
+ * Range of tasks [head, tail) owned by a worker. The owner takes tasks
+ * from the head, other workers steal them from the tail.
+ */
+typedef struct task_queue {
+  pthread_mutex_t mutex;
+  size_t head;
+  size_t tail;
+} task_queue;
+
+typedef struct task_pool {
+  lint_task* tasks;
+  task_queue* queues;
+  unsigned nthreads;
+  pthread_mutex_t mutex;
+  /* Signalled when a task is complete */
+  pthread_cond_t cond;
+} task_pool;
+
+typedef struct worker {
+  task_pool* pool;
+  unsigned index;
+  pthread_t thread;
+  int running;
+} worker;
+
+/*
+ * Returns the next task for the worker, or NULL if no tasks are left
+ */
+static lint_task* take_task(task_pool* pool, unsigned index)
+{
+  for (unsigned i = 0; i < pool->nthreads; ++i) {
+    task_queue* q = &pool->queues[(index + i) % pool->nthreads];
+    lint_task* task = NULL;
+    pthread_mutex_lock(&q->mutex);
+    if (q->head < q->tail) {
+      task = &pool->tasks[i ? --q->tail : q->head++];
+    }
+    pthread_mutex_unlock(&q->mutex);
+    if (task) {
+      return task;
+    }
+  }
+  return NULL;
+}
+
+static void* worker_main(void* arg)
+{
+  worker* w = arg;
+  task_pool* pool = w->pool;
+  lint_task* task;
+  while ((task = take_task(pool, w->index))) {
+    lint_file(task);
+    pthread_mutex_lock(&pool->mutex);
+    task->done = 1;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+  return NULL;
+}
+
+static void print_task(const lint_task* task)
+{
+  if (task->err < 0) {
+    printf("%s: can not read: %s\n", task->path, strerror(task->io_error));
+  } else if (task->err) {
+    printf("%s: ", task->path);
+    print_parse_error(stdout, &task->state);
+  } else {
+    printf("%s: ok\n", task->path);
+  }
+  if (task->output_size) {
+    fwrite(task->output, 1, task->output_size, stdout);
+  }
+}
+
+/*
+ * Multi-file mode: validates files on a pool of threads, prints results
+ * in the order of files, followed by a summary. Returns non-zero value
+ * if some files are invalid or can not be read.
+ */
+static int lint_files(const path_list* files, unsigned nthreads)
+{
+  if (nthreads > files->size) {
+    nthreads = files->size ? (unsigned) files->size : 1;
+  }
+  task_pool pool;
+  memset(&pool, 0, sizeof(pool));
+  pool.tasks = calloc(files->size + 1, sizeof(lint_task));
+  pool.queues = calloc(nthreads, sizeof(task_queue));
+  worker* workers = calloc(nthreads, sizeof(worker));
+  if (!pool.tasks || !pool.queues || !workers) {
+    fprintf(stderr, "out of memory\n");
+    free(pool.tasks);
+    free(pool.queues);
+    free(workers);
+    return 1;
+  }
+  pool.nthreads = nthreads;
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+  for (size_t i = 0; i < files->size; ++i) {
+    pool.tasks[i].path = files->paths[i];
+  }
+  for (unsigned i = 0; i < nthreads; ++i) {
+    pthread_mutex_init(&pool.queues[i].mutex, NULL);
+    pool.queues[i].head = files->size * i / nthreads;
+    pool.queues[i].tail = files->size * (i + 1) / nthreads;
+  }
+  double start = read_seconds();
+  unsigned started = 0;
+  for (unsigned i = 0; i < nthreads; ++i) {
+    workers[i].pool = &pool;
+    workers[i].index = i;
+    /* Tasks of workers that failed to start are stolen by others */
+    workers[i].running = !pthread_create(&workers[i].thread, NULL,
+        worker_main, &workers[i]);
+    started += (unsigned) workers[i].running;
+  }
+  if (!started) {
+    /* Validate files on the calling thread */
+    worker_main(&workers[0]);
+  }
+  size_t valid = 0;
+  size_t invalid = 0;
+  size_t unreadable = 0;
+  unsigned long long bytes = 0;
+  for (size_t i = 0; i < files->size; ++i) {
+    lint_task* task = &pool.tasks[i];
+    pthread_mutex_lock(&pool.mutex);
+    while (!task->done) {
+      pthread_cond_wait(&pool.cond, &pool.mutex);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    print_task(task);
+    free(task->output);
+    bytes += task->size;
+    if (task->err < 0) {
+      ++unreadable;
+    } else if (task->err) {
+      ++invalid;
+    } else {
+      ++valid;
+    }
+  }
+  double seconds = read_seconds() - start;
+  for (unsigned i = 0; i < nthreads; ++i) {
+    if (workers[i].running) {
+      pthread_join(workers[i].thread, NULL);
+    }
+  }
+  for (unsigned i = 0; i < nthreads; ++i) {
+    pthread_mutex_destroy(&pool.queues[i].mutex);
+  }
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+  printf("%llu files: %llu valid, %llu invalid, %llu unreadable\n",
+      (unsigned long long) files->size, (unsigned long long) valid,
+      (unsigned long long) invalid, (unsigned long long) unreadable);
+  if (seconds > 0) {
+    unsigned threads = started ? started : 1;
+    printf("%llu bytes in %.3f s on %u thread%s: %.2f MB/s, %.0f files/s\n",
+        bytes, seconds, threads, threads > 1 ? "s" : "",
+        1e-6 * (double) bytes / seconds, (double) files->size / seconds);
+  }
+  free(pool.tasks);
+  free(pool.queues);
+  free(workers);
+  return valid != files->size;
+}
+
+/*
+ * Checks that the push size list is a comma-separated list of numbers
+ */
+static int valid_push_sizes(const char* list)
+{
+  for (;;) {
+    char* end;
+    if (*list < '0' || *list > '9') {
+      return 0;
+    }
+    strtoul(list, &end, 0);
+    if (!*end) {
+      return 1;
+    }
+    if (*end != ',') {
+      return 0;
+    }
+    list = end + 1;
+  }
+}
+
 int main(int argc, char* argv[])
 {
   embedjson_parser parser;
-  char ch;
+  lint_state state;
+  const char** inputs = calloc((size_t) argc, sizeof(char*));
+  int ninputs = 0;
+  if (!inputs) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
   for (int i = 1; i < argc; ++i) {
     if (!strcmp(argv[i], "-v")) {
       verbose = 1;
     } else if (!strcmp(argv[i], "--verbose")) {
       verbose = 1;
+    } else if ((!strcmp(argv[i], "-b") || !strcmp(argv[i], "--buffer-size"))
+        && i + 1 < argc) {
+      buffer_size = strtoul(argv[++i], NULL, 0);
+      if (!buffer_size) {
+        fprintf(stderr, "invalid buffer size '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--direct")) {
+      direct = 1;
+    } else if (!strcmp(argv[i], "-z") || !strcmp(argv[i], "--decompress")) {
+      decompress = 1;
+    } else if (!strcmp(argv[i], "--pipeline")) {
+      pipeline = 1;
+    } else if (!strcmp(argv[i], "--bench")) {
+      bench = 1;
+    } else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+      bench_runs = (unsigned) strtoul(argv[++i], NULL, 0);
+      if (!bench_runs) {
+        fprintf(stderr, "invalid number of runs '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--push-size") && i + 1 < argc) {
+      push_sizes = argv[++i];
+      if (!valid_push_sizes(push_sizes)) {
+        fprintf(stderr, "invalid push size list '%s'\n", push_sizes);
+        return 1;
+      }
+    } else if ((!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs"))
+        && i + 1 < argc) {
+      jobs = (unsigned) strtoul(argv[++i], NULL, 0);
+      if (!jobs) {
+        fprintf(stderr, "invalid number of jobs '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--include") && i + 1 < argc) {
+      include_pattern = argv[++i];
+    } else if (!strcmp(argv[i], "--files-from") && i + 1 < argc) {
+      files_from = argv[++i];
+    } else {
+      inputs[ninputs++] = argv[i];
+    }
+  }
+  /*
+   * Several inputs, directories, and glob patterns are validated
+   * in the multi-file mode
+   */
+  int multi = ninputs > 1 || files_from || jobs;
+  if (ninputs == 1 && !multi) {
+    struct stat st;
+    if (!stat(inputs[0], &st)) {
+      multi = S_ISDIR(st.st_mode);
     } else {
-      input_file = argv[i];
+      multi = strpbrk(inputs[0], "*?[") != NULL;
     }
   }
+  if (multi) {
+    if (bench) {
+      fprintf(stderr, "--bench takes a single input\n");
+      return 1;
+    }
+    path_list files;
+    memset(&files, 0, sizeof(files));
+    int err = files_from ? add_inputs_from(&files, files_from) : 0;
+    for (int i = 0; !err && i < ninputs; ++i) {
+      err = add_input(&files, inputs[i]);
+      if (err) {
+        fprintf(stderr, "out of memory\n");
+      }
+    }
+    if (!err) {
+      if (!jobs) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = n > 0 ? (unsigned) n : 1;
+      }
+      err = lint_files(&files, jobs);
+    }
+    path_list_destroy(&files);
+    free(inputs);
+    return err;
+  }
+  input_file = ninputs ? inputs[0] : NULL;
+  free(inputs);
   memset(&parser, 0, sizeof(parser));
+  lint_state_init(&state, verbose ? stdout : NULL);
+  parser.userdata = &state;
   int fd = STDIN_FILENO;
   if (input_file) {
-    fd = open(input_file, O_RDONLY);
+    fd = open(input_file, O_RDONLY | (direct ? O_DIRECT : 0));
+    if (fd < 0) {
+      fprintf(stderr, "can not open '%s': %s\n", input_file, strerror(errno));
+      return 1;
+    }
   }
-  while (read(fd, &ch, 1) > 0) {
-    int err = embedjson_push(&parser, &ch, 1);
-    if (err) {
-      fprintf(stderr, "error parsing json near symbol '%c': %s\n",
-          error_position ? *error_position : '?',
-          embedjson_strerror(error_code));
-      return err;
+  const char* data;
+  size_t size;
+  int err;
+  if (bench) {
+    char* buf = NULL;
+    if (map_input(fd, &data, &size)) {
+      if (read_input(fd, &buf, &size)) {
+        fprintf(stderr, "error reading input: %s\n", strerror(errno));
+        return 1;
+      }
+      data = buf;
     }
+    err = run_bench(data, size);
+    if (buf) {
+      free(buf);
+    } else {
+      munmap((void*) data, size);
+    }
+    return err;
+  }
+  /* Compressed files are recognized by the magic number */
+  int compressed = decompress && !direct;
+  if (!direct && !map_input(fd, &data, &size)) {
+    compressed = embedjson_is_compressed(data, size);
+    if (!compressed) {
+      err = embedjson_push(&parser, data, size);
+    }
+    munmap((void*) data, size);
+  } else if (!compressed) {
+    err = embedjson_push_fd(&parser, fd, buffer_size,
+        direct ? EMBEDJSON_READ_DIRECT : 0);
+  }
+  if (compressed) {
+    err = embedjson_push_compressed(&parser, fd, buffer_size,
+        pipeline ? EMBEDJSON_DECOMPRESS_THREAD : 0);
+    if (err == EMBEDJSON_BAD_COMPRESSION || err == EMBEDJSON_THREAD_ERROR) {
+      state.error_code = (embedjson_error_code) err;
+    }
+  }
+  if (err == EMBEDJSON_READ_ERROR) {
+    fprintf(stderr, "error reading input: %s\n", strerror(errno));
+    return 1;
+  }
+  if (!err) {
+    err = embedjson_finalize(&parser);
   }
-  int err = embedjson_finalize(&parser);
   if (err) {
-    fprintf(stderr, "error parsing json near symbol '%c': %s\n",
-        error_position ? *error_position : '?',
-        embedjson_strerror(error_code));
+    print_parse_error(stderr, &state);
     return err;
   }
   return 0;
 }
-
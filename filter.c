@@ -0,0 +1,148 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+#include "common.h"
+#include "filter.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_PATH_FILTER
+
+EMBEDJSON_STATIC embedjson_error_code embedjson_filter_add(
+    embedjson_filter* filter, const char* path, embedjson_size_t size)
+{
+  const char* end = path + size;
+  unsigned char length = 0;
+  unsigned char exact = 1;
+  if (filter->npaths == EMBEDJSON_FILTER_MAX_PATHS) {
+    return EMBEDJSON_PATH_OVERFLOW;
+  }
+  embedjson_filter_step* steps = filter->steps[filter->npaths];
+  if (path == end || *path++ != '$') {
+    return EMBEDJSON_BAD_PATH;
+  }
+  while (path != end) {
+    embedjson_filter_step step = {EMBEDJSON_FILTER_STEP_ANY, 0, 0};
+    if (*path == '.') {
+      const char* key = ++path;
+      while (path != end && *path != '.' && *path != '[') {
+        path++;
+      }
+      if (path == key) {
+        return EMBEDJSON_BAD_PATH;
+      }
+      if (path - key != 1 || *key != '*') {
+        step.type = EMBEDJSON_FILTER_STEP_KEY;
+        step.key = key;
+        step.value = path - key;
+      }
+    } else if (*path == '[') {
+      if (++path == end) {
+        return EMBEDJSON_BAD_PATH;
+      }
+      if (*path == '\'' || *path == '"') {
+        const char quote = *path++;
+        const char* key = path;
+        while (path != end && *path != quote) {
+          path++;
+        }
+        if (path == end) {
+          return EMBEDJSON_BAD_PATH;
+        }
+        step.type = EMBEDJSON_FILTER_STEP_KEY;
+        step.key = key;
+        step.value = path++ - key;
+      } else if (*path == '*') {
+        path++;
+      } else if ('0' <= *path && *path <= '9') {
+        step.type = EMBEDJSON_FILTER_STEP_INDEX;
+        for (; path != end && '0' <= *path && *path <= '9'; ++path) {
+          step.value = 10 * step.value + *path - '0';
+        }
+      } else {
+        return EMBEDJSON_BAD_PATH;
+      }
+      if (path == end || *path++ != ']') {
+        return EMBEDJSON_BAD_PATH;
+      }
+    } else {
+      return EMBEDJSON_BAD_PATH;
+    }
+    if (length == EMBEDJSON_FILTER_MAX_DEPTH) {
+      return EMBEDJSON_PATH_OVERFLOW;
+    }
+    steps[length++] = step;
+    exact = exact && step.type != EMBEDJSON_FILTER_STEP_ANY;
+  }
+  if (exact) {
+    filter->exact |= 1ul << filter->npaths;
+  }
+  filter->length[filter->npaths++] = length;
+  return EMBEDJSON_OK;
+}
+
+EMBEDJSON_STATIC unsigned long embedjson_filter_index(
+    const embedjson_filter* filter, unsigned long mask, embedjson_size_t nstep,
+    embedjson_size_t index)
+{
+  unsigned long result = 0;
+  for (unsigned char i = 0; i < filter->npaths; ++i) {
+    if (!(mask & (1ul << i)) || filter->length[i] <= nstep) {
+      continue;
+    }
+    const embedjson_filter_step* step = &filter->steps[i][nstep];
+    if (step->type == EMBEDJSON_FILTER_STEP_ANY
+        || (step->type == EMBEDJSON_FILTER_STEP_INDEX && step->value == index)) {
+      result |= 1ul << i;
+    }
+  }
+  return result;
+}
+
+EMBEDJSON_STATIC unsigned long embedjson_filter_key_chunk(
+    const embedjson_filter* filter, unsigned long mask, embedjson_size_t nstep,
+    embedjson_size_t offset, const char* data, embedjson_size_t size)
+{
+  unsigned long result = 0;
+  for (unsigned char i = 0; i < filter->npaths; ++i) {
+    if (!(mask & (1ul << i)) || filter->length[i] <= nstep) {
+      continue;
+    }
+    const embedjson_filter_step* step = &filter->steps[i][nstep];
+    if (step->type == EMBEDJSON_FILTER_STEP_ANY) {
+      result |= 1ul << i;
+    } else if (step->type == EMBEDJSON_FILTER_STEP_KEY
+        && offset + size <= step->value) {
+      embedjson_size_t j = 0;
+      for (; j < size && data[j] == step->key[offset + j]; ++j);
+      if (j == size) {
+        result |= 1ul << i;
+      }
+    }
+  }
+  return result;
+}
+
+EMBEDJSON_STATIC unsigned long embedjson_filter_key_end(
+    const embedjson_filter* filter, unsigned long mask, embedjson_size_t nstep,
+    embedjson_size_t size)
+{
+  unsigned long result = 0;
+  for (unsigned char i = 0; i < filter->npaths; ++i) {
+    if (!(mask & (1ul << i)) || filter->length[i] <= nstep) {
+      continue;
+    }
+    const embedjson_filter_step* step = &filter->steps[i][nstep];
+    if (step->type == EMBEDJSON_FILTER_STEP_ANY
+        || (step->type == EMBEDJSON_FILTER_STEP_KEY && step->value == size)) {
+      result |= 1ul << i;
+    }
+  }
+  return result;
+}
+
+#endif /* EMBEDJSON_PATH_FILTER */
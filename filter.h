@@ -0,0 +1,119 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+#pragma once
+#include "common.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_PATH_FILTER
+
+#if EMBEDJSON_FILTER_MAX_PATHS > 32
+#error EMBEDJSON_FILTER_MAX_PATHS should not exceed 32
+#endif
+
+typedef enum {
+  /** Object member with the given key: .key or ['key'] */
+  EMBEDJSON_FILTER_STEP_KEY,
+  /** Array element with the given index: [10] */
+  EMBEDJSON_FILTER_STEP_INDEX,
+  /** Any object member or array element: .* or [*] */
+  EMBEDJSON_FILTER_STEP_ANY
+} embedjson_filter_step_type;
+
+typedef enum {
+  /** Parse the whole input */
+  EMBEDJSON_FILTER_STOP_NEVER = 0,
+  /**
+   * Stop reporting parsing events when all paths are found,
+   * but validate the rest of the input
+   */
+  EMBEDJSON_FILTER_STOP_VALIDATE,
+  /**
+   * Stop parsing when all paths are found, embedjson_push returns
+   * EMBEDJSON_DONE and the rest of the input is not validated
+   */
+  EMBEDJSON_FILTER_STOP_TRUST
+} embedjson_filter_stop;
+
+typedef struct embedjson_filter_step {
+  unsigned char type;
+  /**
+   * Object key for the EMBEDJSON_FILTER_STEP_KEY step.
+   *
+   * @note Points into the path expression provided for embedjson_filter_add
+   */
+  const char* key;
+  /** Key size or array index, depending on the step type */
+  embedjson_size_t value;
+} embedjson_filter_step;
+
+/**
+ * A set of compiled JSON paths.
+ *
+ * When filter is attached to the parser (see embedjson_parser.filter),
+ * parsing callbacks are called only for the values that match
+ * one of the paths, including all nested values. Values that can not
+ * match any path are skipped in the same way as if EMBEDJSON_SKIP was
+ * returned from the callback.
+ *
+ * Construct embedjson_filter instance, memset it's content to zero
+ * and add paths with embedjson_filter_add.
+ */
+typedef struct embedjson_filter {
+  unsigned char npaths;
+  /** Paths without wildcards, i.e. that match at most one value */
+  unsigned long exact;
+  unsigned char length[EMBEDJSON_FILTER_MAX_PATHS];
+  embedjson_filter_step
+    steps[EMBEDJSON_FILTER_MAX_PATHS][EMBEDJSON_FILTER_MAX_DEPTH];
+} embedjson_filter;
+
+/**
+ * Compiles JSON path expression and adds it to the filter.
+ *
+ * Supported syntax is a subset of JSONPath: $.user.id, $.items[*].price,
+ * $['key with spaces'][0], $.*.name
+ *
+ * Returns EMBEDJSON_OK on success, EMBEDJSON_BAD_PATH if the expression
+ * is malformed, or EMBEDJSON_PATH_OVERFLOW if the expression does not fit
+ * into EMBEDJSON_FILTER_MAX_PATHS / EMBEDJSON_FILTER_MAX_DEPTH limits.
+ *
+ * @note Keys are not copied, so path expression should outlive the filter
+ */
+EMBEDJSON_STATIC embedjson_error_code embedjson_filter_add(
+    embedjson_filter* filter, const char* path, embedjson_size_t size);
+
+/**
+ * Returns a subset of paths from the mask, whose step number nstep matches
+ * array element with the given index.
+ */
+EMBEDJSON_STATIC unsigned long embedjson_filter_index(
+    const embedjson_filter* filter, unsigned long mask, embedjson_size_t nstep,
+    embedjson_size_t index);
+
+/**
+ * Returns a subset of paths from the mask, whose step number nstep matches
+ * object key chunk data of the given size, that starts at the offset
+ * of the key.
+ */
+EMBEDJSON_STATIC unsigned long embedjson_filter_key_chunk(
+    const embedjson_filter* filter, unsigned long mask, embedjson_size_t nstep,
+    embedjson_size_t offset, const char* data, embedjson_size_t size);
+
+/**
+ * Returns a subset of paths from the mask, whose step number nstep matches
+ * the whole object key of the given size.
+ *
+ * Should be called after all key chunks are matched with
+ * embedjson_filter_key_chunk.
+ */
+EMBEDJSON_STATIC unsigned long embedjson_filter_key_end(
+    const embedjson_filter* filter, unsigned long mask, embedjson_size_t nstep,
+    embedjson_size_t size);
+
+#endif /* EMBEDJSON_PATH_FILTER */
@@ -26,7 +26,8 @@ typedef enum {
 #endif
   LEXER_STATE_IN_TRUE,
   LEXER_STATE_IN_FALSE,
-  LEXER_STATE_IN_NULL
+  LEXER_STATE_IN_NULL,
+  LEXER_STATE_SKIP
 } lexer_state;
 
 
@@ -75,6 +76,150 @@ do { \
 #endif
 
 
+/*
+ * Same as RETURN_IF, but stops parsing after the current byte
+ * if expression (f) evaluates to EMBEDJSON_PAUSE, or if the events
+ * budget is exhausted (see embedjson_lexer_push_ex)
+ */
+#define PAUSE_OR_RETURN_IF(f) \
+do { \
+  int err = (f); \
+  if (err == EMBEDJSON_PAUSE || (!err && budget && !--budget)) { \
+    paused = 1; \
+    end = data + 1; \
+  } else if (err) { \
+    return err; \
+  } \
+} while (0)
+
+
+/*
+ * Same as PAUSE_OR_RETURN_IF, but switches lexer into the LEXER_STATE_SKIP
+ * state if expression (f) evaluates to EMBEDJSON_SKIP
+ */
+#define SKIP_OR_RETURN_IF(f, depth) \
+do { \
+  int skip_err = (f); \
+  if (skip_err == EMBEDJSON_SKIP) { \
+    lex.state = LEXER_STATE_SKIP; \
+    lex.skip_depth = (depth); \
+    lex.skip_expect_value = !(depth); \
+  } else { \
+    PAUSE_OR_RETURN_IF(skip_err); \
+  } \
+} while (0)
+
+
+/*
+ * Skips a value on the user's request (see EMBEDJSON_SKIP).
+ *
+ * Only quotes, escape sequences and brackets are tracked, so this is
+ * much cheaper than the regular lexing. Skipping is complete when
+ * lex->skip_depth drops to zero after the closing bracket or quote,
+ * or when a primitive value that has been skipped at the zero depth level
+ * is followed by a delimiter. The delimiter is left for the regular lexer.
+ *
+ * Sets *position to the last consumed byte. Returns an error code if
+ * a comma or a closing bracket is met where a value is expected,
+ * then *position points to it.
+ */
+static int embedjson_skip(embedjson_lexer* lex, const char** position,
+    const char* end)
+{
+  const char* data = *position;
+  for (; data != end; ++data) {
+    if (lex->skip_in_string) {
+      if (lex->skip_escape) {
+        lex->skip_escape = 0;
+      } else if (*data == '\\') {
+        lex->skip_escape = 1;
+      } else if (*data == '"') {
+        lex->skip_in_string = 0;
+        if (!lex->skip_depth) {
+          lex->state = LEXER_STATE_LOOKUP_TOKEN;
+          *position = data;
+          return 0;
+        }
+      }
+      continue;
+    }
+    switch (*data) {
+      case '"':
+        if (lex->skip_primitive) {
+          goto delimiter;
+        }
+        lex->skip_in_string = 1;
+        lex->skip_expect_value = 0;
+        break;
+      case '{':
+      case '[':
+        if (lex->skip_primitive) {
+          goto delimiter;
+        }
+        lex->skip_depth++;
+        lex->skip_expect_value = 0;
+        break;
+      case '}':
+      case ']':
+        if (lex->skip_expect_value) {
+          goto missing_value;
+        }
+        if (!lex->skip_depth) {
+          goto delimiter;
+        }
+        if (!--lex->skip_depth) {
+          lex->state = LEXER_STATE_LOOKUP_TOKEN;
+          *position = data;
+          return 0;
+        }
+        break;
+      case ',':
+        if (lex->skip_expect_value) {
+          goto missing_value;
+        }
+        if (!lex->skip_depth) {
+          goto delimiter;
+        }
+        lex->skip_expect_value = 1;
+        break;
+      case ' ':
+      case '\n':
+      case '\r':
+      case '\t':
+#if EMBEDJSON_STREAM
+      case EMBEDJSON_RS:
+#endif /* EMBEDJSON_STREAM */
+        if (!lex->skip_depth && lex->skip_primitive) {
+          goto delimiter;
+        }
+        break;
+      default:
+        if (!lex->skip_depth) {
+          lex->skip_primitive = 1;
+        }
+        /* A colon is followed by the value of a nested object's member */
+        lex->skip_expect_value = *data == ':' && lex->skip_depth;
+        break;
+    }
+  }
+  *position = data - 1;
+  return 0;
+
+delimiter:
+  lex->skip_primitive = 0;
+  lex->state = LEXER_STATE_LOOKUP_TOKEN;
+  *position = data - 1;
+  return 0;
+
+missing_value:
+  /* Same errors as the regular lexing reports for a missing value */
+  *position = data;
+  return *data == ',' ? EMBEDJSON_UNEXP_COMMA
+    : *data == '}' ? EMBEDJSON_UNEXP_CLOSE_CURLY
+    : EMBEDJSON_UNEXP_CLOSE_BRACKET;
+}
+
+
 /*
  * memcmp implementation taken from musl:
  * http://git.musl-libc.org/cgit/musl/tree/src/string/memcmp.c
@@ -88,6 +233,103 @@ static int embedjson_memcmp(const void *vl, const void *vr, embedjson_size_t n)
 }
 
 
+/*
+ * Word-at-a-time scanning of padded input (see embedjson_push_padded).
+ *
+ * Words are assembled in little-endian order, so that the i-th byte of
+ * input is the i-th byte of the word on any platform, and compilers turn
+ * this into a single load. Loads may read up to 7 bytes past the end.
+ */
+#define WORD_ONES 0x0101010101010101ull
+#define WORD_HIGH 0x8080808080808080ull
+#define WORD_HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGH)
+#define KEYWORD(a, b, c, d) ((unsigned long long) (a) \
+    | (unsigned long long) (b) << 8 \
+    | (unsigned long long) (c) << 16 \
+    | (unsigned long long) (d) << 24)
+
+
+static unsigned long long load_word(const char* data)
+{
+  const unsigned char* b = (const unsigned char*) data;
+  return (unsigned long long) b[0]
+    | (unsigned long long) b[1] << 8
+    | (unsigned long long) b[2] << 16
+    | (unsigned long long) b[3] << 24
+    | (unsigned long long) b[4] << 32
+    | (unsigned long long) b[5] << 40
+    | (unsigned long long) b[6] << 48
+    | (unsigned long long) b[7] << 56;
+}
+
+
+/*
+ * Returns the index of the lowest non-zero byte of a non-zero word
+ */
+static int first_byte(unsigned long long word)
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(word) >> 3;
+#else
+  int i = 0;
+  for (; !(word & 0xff); word >>= 8) {
+    ++i;
+  }
+  return i;
+#endif
+}
+
+
+/*
+ * Returns a pointer to the first quote, backslash, control character
+ * or non-ASCII byte, or end
+ */
+static const char* scan_string(const char* data, const char* end)
+{
+  for (; data < end; data += 8) {
+    unsigned long long w = load_word(data);
+    unsigned long long special = WORD_HAS_ZERO(w ^ ('"' * WORD_ONES))
+      | WORD_HAS_ZERO(w ^ ('\\' * WORD_ONES))
+      | (((w - ' ' * WORD_ONES) | w) & WORD_HIGH);
+    if (special) {
+      data += first_byte(special);
+      return data < end ? data : end;
+    }
+  }
+  return end;
+}
+
+
+/*
+ * Returns a pointer to the first byte that is not a space, or end
+ */
+static const char* scan_spaces(const char* data, const char* end)
+{
+  for (; data < end; data += 8) {
+    unsigned long long other = load_word(data) ^ (' ' * WORD_ONES);
+    if (other) {
+      data += first_byte(other);
+      return data < end ? data : end;
+    }
+  }
+  return end;
+}
+
+
+/*
+ * Returns the number of decimal digits at the beginning of data,
+ * at most 8 and at most end - data
+ */
+static int scan_digits(const char* data, const char* end)
+{
+  unsigned long long w = load_word(data);
+  unsigned long long other = ((w & 0xf0 * WORD_ONES) ^ '0' * WORD_ONES)
+    | (((w + 6 * WORD_ONES) & 0xf0 * WORD_ONES) ^ '0' * WORD_ONES);
+  int n = other ? first_byte(other) : 8;
+  return n < end - data ? n : (int) (end - data);
+}
+
+
 /*
  * Returns {10}^{308-n}
  */
@@ -178,11 +420,117 @@ static double powm10(int n)
 }
 
 
+/*
+ * Writes UTF-8 encoding of the code point, returns the number of bytes
+ * written. Unpaired surrogates are encoded as 3-byte sequences.
+ */
+static int utf8_encode(unsigned long cp, char* out)
+{
+  if (cp < 0x80) {
+    out[0] = (char) cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char) (0xc0 | cp >> 6);
+    out[1] = (char) (0x80 | (cp & 0x3f));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char) (0xe0 | cp >> 12);
+    out[1] = (char) (0x80 | (cp >> 6 & 0x3f));
+    out[2] = (char) (0x80 | (cp & 0x3f));
+    return 3;
+  }
+  out[0] = (char) (0xf0 | cp >> 18);
+  out[1] = (char) (0x80 | (cp >> 12 & 0x3f));
+  out[2] = (char) (0x80 | (cp >> 6 & 0x3f));
+  out[3] = (char) (0x80 | (cp & 0x3f));
+  return 4;
+}
+
+
+/*
+ * Guesses encoding from the first four bytes of input
+ */
+static unsigned char guess_encoding(int magic)
+{
+  if ((magic | 0x000000FF) == 0x000000FF) {
+    return EMBEDJSON_ENCODING_UTF32BE;
+  } else if ((magic | 0xFF000000) == 0xFF000000) {
+    return EMBEDJSON_ENCODING_UTF32LE;
+  } else if ((magic | 0x00FF00FF) == 0x00FF00FF) {
+    return EMBEDJSON_ENCODING_UTF16BE;
+  } else if ((magic | 0xFF00FF00) == 0xFF00FF00) {
+    return EMBEDJSON_ENCODING_UTF16LE;
+  }
+  return EMBEDJSON_ENCODING_UTF8;
+}
+
+
+/* Size of the on-stack buffer for text decoded from \u escape sequences */
+#define ESCAPE_BUFFER_SIZE 128
+
+
+/*
+ * Reports text decoded from a run of \u escape sequences as a single
+ * string chunk. If (pending) is non-zero, a high surrogate that waits for
+ * the low one is reported as unpaired.
+ */
+#define FLUSH_ESCAPES(pending) \
+do { \
+  if ((pending) && lex.unicode_high) { \
+    nescapes += utf8_encode(lex.unicode_high, escapes + nescapes); \
+    lex.unicode_high = 0; \
+  } \
+  if (nescapes) { \
+    embedjson_size_t n = nescapes; \
+    nescapes = 0; \
+    PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, escapes, n)); \
+  } \
+} while (0)
+
+
+
 EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
     const char* data, embedjson_size_t size)
+{
+  return embedjson_lexer_push_ex(lexer, data, size, 0, 0);
+}
+
+
+/*
+ * UTF-8 lexer behind embedjson_lexer_push_ex and embedjson_lexer_pushv.
+ * Remaining events budget is passed in and out via *max_events, so that
+ * it can be shared between subsequent calls for the same pushed buffer.
+ *
+ * Segments are lexed one after another with the same local copy of the
+ * lexer state, as if they were a single buffer, except that a string
+ * chunk is reported at the end of each segment.
+ */
+static int lexer_pushv(embedjson_lexer* lexer, const embedjson_iovec* iov,
+    embedjson_size_t iovcnt, embedjson_size_t* max_events,
+    embedjson_size_t* consumed, int padded)
 {
   embedjson_lexer lex = *lexer;
-  const char* string_chunk_begin = 0;
+  embedjson_size_t total = 0;
+  embedjson_size_t segment = 0;
+  const char* data;
+  const char* begin;
+  const char* end;
+  const char* string_chunk_begin;
+  embedjson_size_t budget = *max_events;
+  int paused = 0;
+  char escapes[ESCAPE_BUFFER_SIZE];
+  embedjson_size_t nescapes = 0;
+  if (!iovcnt) {
+    goto done;
+  }
+
+next_segment:
+  data = (const char*) iov[segment].iov_base;
+  begin = data;
+  end = data + iov[segment].iov_len;
+  string_chunk_begin = 0;
 #if EMBEDJSON_BIGNUM
   if (lex.state == LEXER_STATE_IN_STRING
       || lex.state == LEXER_STATE_IN_BIG_NUMBER) {
@@ -191,53 +539,82 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
 #endif
     string_chunk_begin = data;
   }
-  const char* end = data + size;
+  /*
+   * Word-at-a-time fast paths for padded input, once the first bytes
+   * are seen by the encoding guessing below
+   */
+#define FAST_PATH (padded && lex.encoding != EMBEDJSON_ENCODING_UNKNOWN)
   for (; data != end; ++data) {
     if (lex.magic_bytes_read < 4) {
       lex.magic.as_char[lex.magic_bytes_read++] = *data;
     } else if (lex.encoding == EMBEDJSON_ENCODING_UNKNOWN) {
-      if ((lex.magic.as_int | 0x000000FF) == 0x000000FF) {
-        lex.encoding = EMBEDJSON_ENCODING_UTF32BE;
-      } else if ((lex.magic.as_int | 0xFF000000) == 0xFF000000) {
-        lex.encoding = EMBEDJSON_ENCODING_UTF32LE;
-      } else if ((lex.magic.as_int | 0x00FF00FF) == 0x00FF00FF) {
-        lex.encoding = EMBEDJSON_ENCODING_UTF16BE;
-      } else if ((lex.magic.as_int | 0xFF00FF00) == 0xFF00FF00) {
-        lex.encoding = EMBEDJSON_ENCODING_UTF16LE;
-      } else {
-        lex.encoding = EMBEDJSON_ENCODING_UTF8;
-      }
+      lex.encoding = guess_encoding(lex.magic.as_int);
       EMBEDJSON_LOG(lexer, "determined encoding: %s", embedjson_encoding_to_str(lex.encoding));
     }
     switch (lex.state) {
       case LEXER_STATE_LOOKUP_TOKEN:
         if (*data == ' ' || *data == '\n' || *data == '\r' || *data == '\t') {
+          if (FAST_PATH) {
+            data = scan_spaces(data + 1, end) - 1;
+          }
           continue;
+#if EMBEDJSON_STREAM
+        } else if (*data == EMBEDJSON_RS) {
+          continue;
+#endif /* EMBEDJSON_STREAM */
         } else if (*data == ':') {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_COLON, data));
+          SKIP_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_COLON, data),
+              0);
         } else if (*data == ',') {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_COMMA, data));
+          SKIP_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_COMMA, data),
+              0);
         } else if (*data == '{') {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET, data));
+          SKIP_OR_RETURN_IF(embedjson_token(lexer,
+                EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET, data), 1);
         } else if (*data == '}') {
-          RETURN_IF(embedjson_token(lexer,
+          PAUSE_OR_RETURN_IF(embedjson_token(lexer,
                 EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET, data));
         } else if (*data == '[') {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_OPEN_BRACKET, data));
+          SKIP_OR_RETURN_IF(embedjson_token(lexer,
+                EMBEDJSON_TOKEN_OPEN_BRACKET, data), 1);
         } else if (*data == ']') {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_CLOSE_BRACKET, data));
+          PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_CLOSE_BRACKET, data));
         } else if (*data == '"') {
           string_chunk_begin = data + 1;
           lex.state = LEXER_STATE_IN_STRING;
-          RETURN_IF(embedjson_tokenc_begin(lexer, data));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc_begin(lexer, data));
           break;
         } else if (*data == 't') {
+          if (FAST_PATH && end - data >= 4 && (load_word(data) & 0xffffffff)
+              == KEYWORD('t', 'r', 'u', 'e')) {
+            data += 3;
+            lex.offset = 4;
+            PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_TRUE,
+                  data));
+            break;
+          }
           lex.offset = 1;
           lex.state = LEXER_STATE_IN_TRUE;
         } else if (*data == 'f') {
+          if (FAST_PATH && end - data >= 5 && (load_word(data + 1)
+                & 0xffffffff) == KEYWORD('a', 'l', 's', 'e')) {
+            data += 4;
+            lex.offset = 5;
+            PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_FALSE,
+                  data));
+            break;
+          }
           lex.offset = 1;
           lex.state = LEXER_STATE_IN_FALSE;
         } else if (*data == 'n') {
+          if (FAST_PATH && end - data >= 4 && (load_word(data) & 0xffffffff)
+              == KEYWORD('n', 'u', 'l', 'l')) {
+            data += 3;
+            lex.offset = 4;
+            PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_NULL,
+                  data));
+            break;
+          }
           lex.offset = 1;
           lex.state = LEXER_STATE_IN_NULL;
         } else if (*data == '-') {
@@ -255,6 +632,18 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
         }
         break;
       case LEXER_STATE_IN_STRING:
+#if EMBEDJSON_VALIDATE_UTF8
+        if (FAST_PATH && !lex.nb) {
+#else
+        if (FAST_PATH) {
+#endif
+          /* Bytes that need no processing are skipped up to the next one */
+          data = scan_string(data, end);
+          if (data == end) {
+            data--;
+            continue;
+          }
+        }
 #if EMBEDJSON_VALIDATE_UTF8
         if (lex.nb) {
           if (lex.nb == 2 && lex.cc == 1) {
@@ -275,9 +664,10 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
                * '\x90' <= *data <= '\xbf'
                * Or, in binary representation:
                * b10010000 <= *data <= b10111111
-               * Therefore, *data & b11010000 should be equal to b10010000
+               * Therefore, either *data & b11110000 should be equal to
+               * b10010000, or *data & b11100000 should be equal to b10100000
                */
-              if ((*data & 0xd0) != 0x90) {
+              if ((*data & 0xf0) != 0x90 && (*data & 0xe0) != 0xa0) {
                 return embedjson_error_ex((embedjson_parser*) lexer,
                     EMBEDJSON_BAD_UTF8, data);
               }
@@ -336,16 +726,18 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
 #endif
           if (*data == '\\') {
             if (data != string_chunk_begin) {
-              RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
+              FLUSH_ESCAPES(1);
+              PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
                     data - string_chunk_begin));
             }
             lex.state = LEXER_STATE_IN_STRING_ESCAPE;
           } else if (*data == '"') {
+            FLUSH_ESCAPES(1);
             if (data != string_chunk_begin) {
-              RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
+              PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
                     data - string_chunk_begin));
             }
-            RETURN_IF(embedjson_tokenc_end(lexer, data));
+            PAUSE_OR_RETURN_IF(embedjson_tokenc_end(lexer, data));
             lex.state = LEXER_STATE_LOOKUP_TOKEN;
 #if EMBEDJSON_VALIDATE_UTF8
           } else if (!lex.nb && (unsigned char) *data < 0x20) {
@@ -356,22 +748,25 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
         }
         break;
       case LEXER_STATE_IN_STRING_ESCAPE:
+        if (*data != 'u') {
+          FLUSH_ESCAPES(1);
+        }
         if (*data == '"') {
-          RETURN_IF(embedjson_tokenc(lexer, "\"", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\"", 1));
         } else if (*data == '\\') {
-          RETURN_IF(embedjson_tokenc(lexer, "\\", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\\", 1));
         } else if (*data == '/') {
-          RETURN_IF(embedjson_tokenc(lexer, "/", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "/", 1));
         } else if (*data == 'b') {
-          RETURN_IF(embedjson_tokenc(lexer, "\b", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\b", 1));
         } else if (*data == 'f') {
-          RETURN_IF(embedjson_tokenc(lexer, "\f", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\f", 1));
         } else if (*data == 'n') {
-          RETURN_IF(embedjson_tokenc(lexer, "\n", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\n", 1));
         } else if (*data == 'r') {
-          RETURN_IF(embedjson_tokenc(lexer, "\r", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\r", 1));
         } else if (*data == 't') {
-          RETURN_IF(embedjson_tokenc(lexer, "\t", 1));
+          PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, "\t", 1));
         } else if (*data == 'u') {
           lex.state = LEXER_STATE_IN_STRING_UNICODE_ESCAPE;
           lex.offset = 0;
@@ -399,12 +794,31 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
           case 0: lex.unicode_cp[0] = value << 4; break;
           case 1: lex.unicode_cp[0] |= value; break;
           case 2: lex.unicode_cp[1] = value << 4; break;
-          case 3:
+          case 3: {
             lex.unicode_cp[1] |= value;
-            RETURN_IF(embedjson_tokenc(lexer, lex.unicode_cp, 2));
+            unsigned long cp = (unsigned char) lex.unicode_cp[0] << 8
+              | (unsigned char) lex.unicode_cp[1];
+            if (nescapes > ESCAPE_BUFFER_SIZE - 6) {
+              FLUSH_ESCAPES(0);
+            }
+            if (lex.unicode_high && (cp & 0xfc00) == 0xdc00) {
+              cp = 0x10000 + ((lex.unicode_high - 0xd800ul) << 10)
+                + (cp - 0xdc00);
+              lex.unicode_high = 0;
+            } else if (lex.unicode_high) {
+              nescapes += utf8_encode(lex.unicode_high, escapes + nescapes);
+              lex.unicode_high = 0;
+            }
+            if ((cp & 0xfffc00) == 0xd800) {
+              /* Wait for the low surrogate */
+              lex.unicode_high = (unsigned short) cp;
+            } else {
+              nescapes += utf8_encode(cp, escapes + nescapes);
+            }
             string_chunk_begin = data + 1;
             lex.state = LEXER_STATE_IN_STRING;
             break;
+          }
         }
         lex.offset++;
         break;
@@ -419,6 +833,18 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
         }
         break;
       case LEXER_STATE_IN_NUMBER:
+        /* Neither a leading zero, nor an overflow is possible */
+        if (FAST_PATH && lex.int_value
+            && lex.int_value < EMBEDJSON_INT_MAX / 100000000) {
+          int n = scan_digits(data, end);
+          if (n) {
+            for (int i = 0; i < n; ++i) {
+              lex.int_value = 10 * lex.int_value + data[i] - '0';
+            }
+            data += n - 1;
+            break;
+          }
+        }
         if ('0' <= *data && *data <= '9') {
           if (!lex.int_value) {
             return embedjson_error_ex((embedjson_parser*) lexer,
@@ -428,7 +854,7 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
 #if EMBEDJSON_BIGNUM
             string_chunk_begin = data + 1;
             lex.state = LEXER_STATE_IN_BIG_NUMBER;
-            RETURN_IF(embedjson_tokenbn_begin(lexer, data, lex.int_value));
+            PAUSE_OR_RETURN_IF(embedjson_tokenbn_begin(lexer, data, lex.int_value));
 #else
             return embedjson_error_ex((embedjson_parser*) lexer,
               EMBEDJSON_INT_OVERFLOW, data);
@@ -445,13 +871,24 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
           if (lex.minus) {
             lex.int_value = 0 - lex.int_value;
           }
-          RETURN_IF(embedjson_tokeni(lexer, lex.int_value, data));
+          PAUSE_OR_RETURN_IF(embedjson_tokeni(lexer, lex.int_value, data));
           lex.int_value = 0;
           lex.minus = 0;
           lex.state = LEXER_STATE_LOOKUP_TOKEN;
         }
         break;
       case LEXER_STATE_IN_NUMBER_FRAC:
+        if (FAST_PATH) {
+          int n = scan_digits(data, end);
+          if (n) {
+            for (int i = 0; i < n; ++i) {
+              lex.frac_value = 10 * lex.frac_value + data[i] - '0';
+            }
+            lex.frac_power += n;
+            data += n - 1;
+            break;
+          }
+        }
         if ('0' <= *data && *data <= '9') {
           lex.frac_value = 10 * lex.frac_value + *data - '0';
           lex.frac_power++;
@@ -472,7 +909,7 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
           if (lex.minus) {
             value = 0 - value;
           }
-          RETURN_IF(embedjson_tokenf(lexer, value, data));
+          PAUSE_OR_RETURN_IF(embedjson_tokenf(lexer, value, data));
           lex.int_value = 0;
           lex.frac_power = 0;
           lex.frac_value = 0;
@@ -513,7 +950,7 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
           if (lex.minus) {
             value = 0 - value;
           }
-          RETURN_IF(embedjson_tokenf(lexer, value, data));
+          PAUSE_OR_RETURN_IF(embedjson_tokenf(lexer, value, data));
           lex.int_value = 0;
           lex.frac_power = 0;
           lex.frac_value = 0;
@@ -531,11 +968,11 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
           continue;
         }
         if (data != string_chunk_begin) {
-          RETURN_IF(embedjson_tokenbn(lexer, string_chunk_begin,
+          PAUSE_OR_RETURN_IF(embedjson_tokenbn(lexer, string_chunk_begin,
                 data - string_chunk_begin));
         }
         data--;
-        RETURN_IF(embedjson_tokenbn_end(lexer, data));
+        PAUSE_OR_RETURN_IF(embedjson_tokenbn_end(lexer, data));
         lex.int_value = 0;
         lex.frac_power = 0;
         lex.frac_value = 0;
@@ -552,7 +989,7 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
               EMBEDJSON_BAD_TRUE, data);
         }
         if (++lex.offset > 3) {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_TRUE, data));
+          PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_TRUE, data));
           lex.state = LEXER_STATE_LOOKUP_TOKEN;
         }
         break;
@@ -562,7 +999,7 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
               EMBEDJSON_BAD_FALSE, data);
         }
         if (++lex.offset > 4) {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_FALSE, data));
+          PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_FALSE, data));
           lex.state = LEXER_STATE_LOOKUP_TOKEN;
         }
         break;
@@ -572,38 +1009,1155 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
               EMBEDJSON_BAD_NULL, data);
         }
         if (++lex.offset > 3) {
-          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_NULL, data));
+          PAUSE_OR_RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_NULL, data));
           lex.state = LEXER_STATE_LOOKUP_TOKEN;
         }
         break;
+      case LEXER_STATE_SKIP: {
+        /*
+         * Encoding guessing above needs to see the first bytes one by one
+         */
+        int err = embedjson_skip(&lex, &data,
+            lex.encoding == EMBEDJSON_ENCODING_UNKNOWN ? data + 1 : end);
+        if (err) {
+          return embedjson_error_ex((embedjson_parser*) lexer, err, data);
+        }
+        break;
+      }
     }
   }
 
+  /*
+   * A high surrogate at the end of the buffer is kept until the next
+   * escape sequence, unless it is followed by other string characters
+   */
+  FLUSH_ESCAPES(lex.state == LEXER_STATE_IN_STRING
+      && data != string_chunk_begin);
   if (data != string_chunk_begin) {
     if (lex.state == LEXER_STATE_IN_STRING) {
-      RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
+      PAUSE_OR_RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
             data - string_chunk_begin));
     }
 #if EMBEDJSON_BIGNUM
     if (lex.state == LEXER_STATE_IN_BIG_NUMBER) {
-      RETURN_IF(embedjson_tokenbn(lexer, string_chunk_begin,
+      PAUSE_OR_RETURN_IF(embedjson_tokenbn(lexer, string_chunk_begin,
             data - string_chunk_begin));
     }
 #endif
   }
+  total += data - begin;
+  if (!paused && ++segment < iovcnt) {
+    goto next_segment;
+  }
+#undef FAST_PATH
 
+done:
   /*
    * Cache-friendly update lexer state only if it has changed
    */
   if (embedjson_memcmp(&lex, lexer, sizeof(lex))) {
     *lexer = lex;
   }
+  if (consumed) {
+    *consumed = total;
+  }
+  *max_events = budget;
+  return paused ? EMBEDJSON_PAUSE : 0;
+}
+
+
+static int lexer_push(embedjson_lexer* lexer, const char* data,
+    embedjson_size_t size, embedjson_size_t* max_events,
+    embedjson_size_t* consumed)
+{
+  embedjson_iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = size;
+  return lexer_pushv(lexer, &iov, 1, max_events, consumed, 0);
+}
+
+
+#if EMBEDJSON_TRANSCODE
+/*
+ * Size of the on-stack buffer for UTF-8 text produced from UTF-16
+ * and UTF-32 input
+ */
+#define TRANSCODE_BUFFER_SIZE 512
+
+/*
+ * Byte order marks. Shorter marks come after the longer ones they are
+ * a prefix of.
+ */
+static const struct {
+  unsigned char size;
+  unsigned char encoding;
+  unsigned char bytes[4];
+} transcode_boms[] = {
+  {4, EMBEDJSON_ENCODING_UTF32BE, {0x00, 0x00, 0xfe, 0xff}},
+  {4, EMBEDJSON_ENCODING_UTF32LE, {0xff, 0xfe, 0x00, 0x00}},
+  {3, EMBEDJSON_ENCODING_UTF8, {0xef, 0xbb, 0xbf}},
+  {2, EMBEDJSON_ENCODING_UTF16BE, {0xfe, 0xff}},
+  {2, EMBEDJSON_ENCODING_UTF16LE, {0xff, 0xfe}},
+};
+
+
+/*
+ * Guesses encoding from the first n (at most 4) bytes of the input,
+ * as described in RFC 4627, section 3, respecting byte order marks.
+ * Size of the byte order mark is stored in *bom.
+ *
+ * Returns EMBEDJSON_ENCODING_UNKNOWN if more bytes are needed, unless
+ * final is set.
+ */
+static unsigned char transcode_detect_encoding(const unsigned char* b,
+    unsigned char n, int final, unsigned char* bom)
+{
+  *bom = 0;
+  for (unsigned i = 0; i < sizeof(transcode_boms) / sizeof(*transcode_boms);
+      ++i) {
+    unsigned char size = transcode_boms[i].size;
+    if (!embedjson_memcmp(b, transcode_boms[i].bytes, n < size ? n : size)) {
+      if (n >= size) {
+        *bom = size;
+        return transcode_boms[i].encoding;
+      }
+      if (!final) {
+        return EMBEDJSON_ENCODING_UNKNOWN;
+      }
+    }
+  }
+  if (n < 2) {
+    return final ? EMBEDJSON_ENCODING_UTF8 : EMBEDJSON_ENCODING_UNKNOWN;
+  }
+  if (!b[0]) {
+    return b[1] ? EMBEDJSON_ENCODING_UTF16BE : EMBEDJSON_ENCODING_UTF32BE;
+  }
+  if (b[1]) {
+    return EMBEDJSON_ENCODING_UTF8;
+  }
+  if (n < 4) {
+    return final ? EMBEDJSON_ENCODING_UTF16LE : EMBEDJSON_ENCODING_UNKNOWN;
+  }
+  return b[2] || b[3] ? EMBEDJSON_ENCODING_UTF16LE
+    : EMBEDJSON_ENCODING_UTF32LE;
+}
+
+
+/*
+ * Decodes a single code point from n bytes of UTF-16 or UTF-32 input.
+ *
+ * Returns the number of bytes decoded, zero if the code point
+ * is incomplete, or -1 for unpaired surrogates and values beyond U+10FFFF.
+ */
+static int transcode_decode(unsigned char encoding, const unsigned char* p,
+    embedjson_size_t n, unsigned long* cp)
+{
+  unsigned long lo;
+  if (encoding == EMBEDJSON_ENCODING_UTF32LE
+      || encoding == EMBEDJSON_ENCODING_UTF32BE) {
+    if (n < 4) {
+      return 0;
+    }
+    if (encoding == EMBEDJSON_ENCODING_UTF32LE) {
+      *cp = p[0] | p[1] << 8 | (unsigned long) p[2] << 16
+        | (unsigned long) p[3] << 24;
+    } else {
+      *cp = (unsigned long) p[0] << 24 | (unsigned long) p[1] << 16
+        | p[2] << 8 | p[3];
+    }
+    return *cp > 0x10ffff || (*cp >= 0xd800 && *cp <= 0xdfff) ? -1 : 4;
+  }
+  if (n < 2) {
+    return 0;
+  }
+  if (encoding == EMBEDJSON_ENCODING_UTF16LE) {
+    *cp = p[0] | p[1] << 8;
+  } else {
+    *cp = p[0] << 8 | p[1];
+  }
+  if (*cp < 0xd800 || *cp > 0xdfff) {
+    return 2;
+  }
+  if (*cp > 0xdbff) {
+    return -1;
+  }
+  if (n < 4) {
+    return 0;
+  }
+  if (encoding == EMBEDJSON_ENCODING_UTF16LE) {
+    lo = p[2] | p[3] << 8;
+  } else {
+    lo = p[2] << 8 | p[3];
+  }
+  if (lo < 0xdc00 || lo > 0xdfff) {
+    return -1;
+  }
+  *cp = 0x10000 + ((*cp - 0xd800) << 10) + (lo - 0xdc00);
+  return 4;
+}
+
+
+/*
+ * Returns a pointer to the input byte that follows code points
+ * transcoded into the first n bytes of UTF-8 text
+ */
+static const unsigned char* transcode_skip(unsigned char encoding,
+    const unsigned char* p, embedjson_size_t n)
+{
+  char buf[4];
+  unsigned long cp;
+  while (n) {
+    int size = transcode_decode(encoding, p, 4, &cp);
+    embedjson_size_t utf8_size = utf8_encode(cp, buf);
+    if (utf8_size > n) {
+      break;
+    }
+    p += size;
+    n -= utf8_size;
+  }
+  return p;
+}
+
+
+#if EMBEDJSON_STREAM
+/*
+ * Checks if the error that started stream recovery points into the size
+ * bytes of transcoded text at out, and has to be moved to the input
+ */
+static int transcode_recovering(embedjson_lexer* lexer, const char* out,
+    embedjson_size_t size)
+{
+  embedjson_parser* parser = (embedjson_parser*) lexer;
+  return parser->stream_recover && out <= parser->stream_position
+    && parser->stream_position < out + size;
+}
+#endif /* EMBEDJSON_STREAM */
+
+
+/*
+ * Removes the first n bytes of lexer->unit
+ */
+static void transcode_drop(embedjson_lexer* lexer, int n)
+{
+  lexer->unit_size -= n;
+  for (unsigned char i = 0; i < lexer->unit_size; ++i) {
+    lexer->unit[i] = lexer->unit[i + n];
+  }
+}
+
+
+/*
+ * Transcodes UTF-16 or UTF-32 input into UTF-8 and passes it to the
+ * lexer block by block. Bytes of an incomplete code point at the end
+ * of the input are kept in lexer->unit until the next call.
+ */
+static int transcode_push(embedjson_lexer* lexer, const char* data,
+    embedjson_size_t size, embedjson_size_t* max_events,
+    embedjson_size_t* consumed)
+{
+  char out[TRANSCODE_BUFFER_SIZE];
+  const unsigned char* p = (const unsigned char*) data;
+  const unsigned char* end = p + size;
+  unsigned char encoding = lexer->encoding;
+  /* Offset of the low byte within a UTF-16 code unit */
+  unsigned char lo = encoding == EMBEDJSON_ENCODING_UTF16BE;
+  int utf16 = encoding == EMBEDJSON_ENCODING_UTF16LE
+    || encoding == EMBEDJSON_ENCODING_UTF16BE;
+  unsigned long cp;
+  int n;
+
+  /*
+   * Code points carried over from the previous call are lexed one by one,
+   * so that the rest of them is kept if parsing is paused
+   */
+  while (lexer->unit_size) {
+    n = transcode_decode(encoding, lexer->unit, lexer->unit_size, &cp);
+    if (n < 0) {
+      return embedjson_error_ex((embedjson_parser*) lexer,
+          EMBEDJSON_BAD_ENCODING, (const char*) p);
+    }
+    if (!n) {
+      if (p == end) {
+        break;
+      }
+      lexer->unit[lexer->unit_size++] = *p++;
+      continue;
+    }
+    embedjson_size_t used;
+    int err = lexer_push(lexer, out, utf8_encode(cp, out), max_events,
+        &used);
+    if (err && err != EMBEDJSON_PAUSE) {
+#if EMBEDJSON_STREAM
+      /*
+       * Held bytes after the failed code point, and then the input,
+       * are scanned for the next document
+       */
+      if (transcode_recovering(lexer, out, sizeof(out))) {
+        ((embedjson_parser*) lexer)->stream_position = (const char*) p;
+        transcode_drop(lexer, n);
+      }
+#endif /* EMBEDJSON_STREAM */
+      return err;
+    }
+    /* Delimiter after a number is not consumed if parsing is paused */
+    if (used) {
+      transcode_drop(lexer, n);
+    }
+    if (err) {
+      if (consumed) {
+        *consumed = p - (const unsigned char*) data;
+      }
+      return err;
+    }
+  }
+
+  n = 1;
+  while (p != end && n > 0) {
+    const unsigned char* first = p;
+    char* o = out;
+    for (;;) {
+      /*
+       * ASCII fast path: four UTF-16 code units at a time, with no
+       * branches per code unit
+       */
+      while (utf16 && end - p >= 8 && out + sizeof(out) - o >= 4
+          && !((p[lo] | p[lo + 2] | p[lo + 4] | p[lo + 6]) & 0x80)
+          && !(p[1 - lo] | p[3 - lo] | p[5 - lo] | p[7 - lo])) {
+        o[0] = (char) p[lo];
+        o[1] = (char) p[lo + 2];
+        o[2] = (char) p[lo + 4];
+        o[3] = (char) p[lo + 6];
+        o += 4;
+        p += 8;
+      }
+      if (p == end || out + sizeof(out) - o < 4) {
+        break;
+      }
+      n = transcode_decode(encoding, p, end - p, &cp);
+      if (n <= 0) {
+        break;
+      }
+      o += utf8_encode(cp, o);
+      p += n;
+    }
+    if (!n) {
+      while (p != end) {
+        lexer->unit[lexer->unit_size++] = *p++;
+      }
+    }
+    if (o != out) {
+      embedjson_size_t used;
+      int err = lexer_push(lexer, out, o - out, max_events, &used);
+      if (err == EMBEDJSON_PAUSE) {
+        if (used != (embedjson_size_t) (o - out)) {
+          p = transcode_skip(encoding, first, used);
+          lexer->unit_size = 0;
+        }
+        if (consumed) {
+          *consumed = p - (const unsigned char*) data;
+        }
+        return EMBEDJSON_PAUSE;
+      }
+      if (err) {
+#if EMBEDJSON_STREAM
+        /*
+         * Input is scanned for the next document from the failed code
+         * point, including the bytes just held
+         */
+        if (transcode_recovering(lexer, out, o - out)) {
+          embedjson_parser* parser = (embedjson_parser*) lexer;
+          parser->stream_position = (const char*) transcode_skip(encoding,
+              first, parser->stream_position - out);
+          lexer->unit_size = 0;
+        }
+#endif /* EMBEDJSON_STREAM */
+        return err;
+      }
+    }
+  }
+  if (n < 0) {
+    return embedjson_error_ex((embedjson_parser*) lexer,
+        EMBEDJSON_BAD_ENCODING, (const char*) p);
+  }
+  if (consumed) {
+    *consumed = size;
+  }
+  return 0;
+}
+
+
+/*
+ * Detects input encoding, holding the first bytes in lexer->magic until
+ * it is known. Held bytes are then passed either to the UTF-8 lexer, or to
+ * the transcoder, along with the rest of the input. Byte order mark
+ * is skipped.
+ */
+static int transcode_detect(embedjson_lexer* lexer, const char* data,
+    embedjson_size_t size, embedjson_size_t* max_events,
+    embedjson_size_t* consumed, int final)
+{
+  unsigned char peek[4];
+  unsigned char held = lexer->magic_bytes_read;
+  unsigned char n = held;
+  unsigned char bom;
+  unsigned char encoding;
+  for (unsigned char i = 0; i < held; ++i) {
+    peek[i] = (unsigned char) lexer->magic.as_char[i];
+  }
+  while (!(encoding = transcode_detect_encoding(peek, n, final, &bom))) {
+    if ((embedjson_size_t) (n - held) == size) {
+      while (lexer->magic_bytes_read < n) {
+        lexer->magic.as_char[lexer->magic_bytes_read] =
+          (char) peek[lexer->magic_bytes_read];
+        lexer->magic_bytes_read++;
+      }
+      if (consumed) {
+        *consumed = size;
+      }
+      return 0;
+    }
+    peek[n] = (unsigned char) data[n - held];
+    n++;
+  }
+
+  lexer->encoding = encoding;
+  lexer->magic_bytes_read = 4;
+  EMBEDJSON_LOG(lexer, "determined encoding: %s",
+      embedjson_encoding_to_str(lexer->encoding));
+  embedjson_size_t skipped = 0;
+  if (bom > held) {
+    skipped = bom - held;
+    data += skipped;
+    size -= skipped;
+  }
+  embedjson_size_t used = 0;
+  int err = 0;
+  if (encoding == EMBEDJSON_ENCODING_UTF8) {
+    if (bom < held) {
+      /*
+       * At most one byte is held for UTF-8 input unless it starts with
+       * a broken byte order mark, so parsing can not pause in the middle
+       */
+      err = lexer_push(lexer, lexer->magic.as_char + bom, held - bom,
+          max_events, 0);
+#if EMBEDJSON_STREAM
+      if (transcode_recovering(lexer, lexer->magic.as_char, held)) {
+        ((embedjson_parser*) lexer)->stream_position = data;
+      }
+#endif /* EMBEDJSON_STREAM */
+    }
+    if (!err) {
+      err = lexer_push(lexer, data, size, max_events, &used);
+    }
+  } else {
+    for (unsigned char i = bom; i < held; ++i) {
+      lexer->unit[lexer->unit_size++] = peek[i];
+    }
+    err = transcode_push(lexer, data, size, max_events, &used);
+  }
+  if (err && err != EMBEDJSON_PAUSE) {
+    return err;
+  }
+  if (consumed) {
+    *consumed = skipped + used;
+  }
+  return err;
+}
+
+
+/*
+ * Flushes bytes held by transcode_detect and transcode_push. Bytes of
+ * a truncated code point are left in lexer->unit.
+ */
+static int transcode_finalize(embedjson_lexer* lexer)
+{
+  embedjson_size_t budget = 0;
+  if (lexer->encoding == EMBEDJSON_ENCODING_UNKNOWN
+      && lexer->magic_bytes_read) {
+    RETURN_IF(transcode_detect(lexer, 0, 0, &budget, 0, 1));
+  }
+  if (lexer->unit_size) {
+    RETURN_IF(transcode_push(lexer, 0, 0, &budget, 0));
+  }
+  return 0;
+}
+#endif /* EMBEDJSON_TRANSCODE */
+
+
+EMBEDJSON_STATIC int embedjson_lexer_push_ex(embedjson_lexer* lexer,
+    const char* data, embedjson_size_t size, embedjson_size_t max_events,
+    embedjson_size_t* consumed)
+{
+#if EMBEDJSON_TRANSCODE
+  if (lexer->encoding == EMBEDJSON_ENCODING_UNKNOWN) {
+    return transcode_detect(lexer, data, size, &max_events, consumed, 0);
+  }
+  if (lexer->encoding != EMBEDJSON_ENCODING_UTF8) {
+    return transcode_push(lexer, data, size, &max_events, consumed);
+  }
+#endif /* EMBEDJSON_TRANSCODE */
+  return lexer_push(lexer, data, size, &max_events, consumed);
+}
+
+
+EMBEDJSON_STATIC int embedjson_lexer_pushv(embedjson_lexer* lexer,
+    const embedjson_iovec* iov, embedjson_size_t iovcnt)
+{
+  embedjson_size_t max_events = 0;
+  for (embedjson_size_t i = 0; i < iovcnt; ++i) {
+#if EMBEDJSON_TRANSCODE
+    /* Segments are decoded one by one, until input turns out to be UTF-8 */
+    if (lexer->encoding != EMBEDJSON_ENCODING_UTF8) {
+      RETURN_IF(embedjson_lexer_push_ex(lexer, iov[i].iov_base,
+            iov[i].iov_len, 0, 0));
+      continue;
+    }
+#endif /* EMBEDJSON_TRANSCODE */
+    return lexer_pushv(lexer, iov + i, iovcnt - i, &max_events, 0, 0);
+  }
   return 0;
 }
 
 
+EMBEDJSON_STATIC int embedjson_lexer_push_padded(embedjson_lexer* lexer,
+    const char* data, embedjson_size_t size)
+{
+#if EMBEDJSON_TRANSCODE
+  if (lexer->encoding != EMBEDJSON_ENCODING_UTF8) {
+    return embedjson_lexer_push_ex(lexer, data, size, 0, 0);
+  }
+#endif /* EMBEDJSON_TRANSCODE */
+  embedjson_iovec iov;
+  embedjson_size_t max_events = 0;
+  iov.iov_base = data;
+  iov.iov_len = size;
+  return lexer_pushv(lexer, &iov, 1, &max_events, 0, 1);
+}
+
+
+/*
+ * Complete input lexer behind embedjson_lexer_parse_complete.
+ *
+ * Input does not continue in the next call, so each token is lexed to its
+ * end with a simple look-ahead, keeping its state in local variables.
+ * Lexer state is stored only if data ends in the middle of a token, to be
+ * reported by embedjson_lexer_finalize exactly as after
+ * embedjson_lexer_push.
+ */
+
+
+/*
+ * Same as FLUSH_ESCAPES, but parsing stops at EMBEDJSON_PAUSE
+ */
+#define COMPLETE_FLUSH_ESCAPES(pending) \
+do { \
+  if ((pending) && unicode_high) { \
+    nescapes += utf8_encode(unicode_high, escapes + nescapes); \
+    unicode_high = 0; \
+  } \
+  if (nescapes) { \
+    embedjson_size_t n = nescapes; \
+    nescapes = 0; \
+    RETURN_IF(embedjson_tokenc(lexer, escapes, n)); \
+  } \
+} while (0)
+
+
+/*
+ * Reports an error found by complete_string or complete_number. Lexing
+ * stops, even if the application ignores the error, as in lexer_pushv.
+ */
+#define COMPLETE_ERROR(code, position_) \
+do { \
+  *position = 0; \
+  return embedjson_error_ex((embedjson_parser*) lexer, (code), (position_)); \
+} while (0)
+
+
+/*
+ * Returns result of expression (f) if it evaluates to non-zero, or if
+ * lexing has been stopped by COMPLETE_ERROR
+ */
+#define COMPLETE_RETURN_IF(f) \
+do { \
+  int err = (f); \
+  if (err || !data) { \
+    return err; \
+  } \
+} while (0)
+
+
+/*
+ * Returns the number of leading bytes of data that match keyword,
+ * starting from the second one
+ */
+static int complete_keyword(const char* data, const char* end,
+    const char* keyword)
+{
+  int n = 1;
+  for (; keyword[n] && data + n != end && data[n] == keyword[n]; ++n);
+  return n;
+}
+
+
+/*
+ * Lexes a string that starts with the quote at *position. On return,
+ * *position points to the closing quote, to the last byte of data,
+ * or is set to NULL after an error.
+ *
+ * Word loads are allowed at positions before word_end.
+ */
+static int complete_string(embedjson_lexer* lexer, embedjson_lexer* lex,
+    const char** position, const char* end, const char* word_end)
+{
+  const char* data = *position;
+  char escapes[ESCAPE_BUFFER_SIZE];
+  embedjson_size_t nescapes = 0;
+  unsigned short unicode_high = 0;
+  unsigned char state = LEXER_STATE_IN_STRING;
+#if EMBEDJSON_VALIDATE_UTF8
+  /* As in lexer_pushv, a truncated sequence is carried to the next string */
+  unsigned char nb = lex->nb;
+  unsigned char cc = lex->cc;
+#endif
+  RETURN_IF(embedjson_tokenc_begin(lexer, data));
+  const char* string_chunk_begin = ++data;
+  for (;; ++data) {
+#if EMBEDJSON_VALIDATE_UTF8
+    if (!nb && data < word_end) {
+#else
+    if (data < word_end) {
+#endif
+      data = scan_string(data, word_end);
+    }
+    if (data == end) {
+      goto eof;
+    }
+#if EMBEDJSON_VALIDATE_UTF8
+    if (nb) {
+      /* See the comments in lexer_pushv */
+      if (nb == 2 && cc == 1) {
+        if ((*data & 0xe0) != 0xa0) {
+          COMPLETE_ERROR(EMBEDJSON_BAD_UTF8, data);
+        }
+        cc = 0;
+      } else if (nb == 3) {
+        if (cc == 2) {
+          if ((*data & 0xf0) != 0x90 && (*data & 0xe0) != 0xa0) {
+            COMPLETE_ERROR(EMBEDJSON_BAD_UTF8, data);
+          }
+          cc = 0;
+        } else if (cc == 3) {
+          if ((*data & 0xf0) != 0x80) {
+            COMPLETE_ERROR(EMBEDJSON_BAD_UTF8, data);
+          }
+          cc = 0;
+        }
+      } else if ((*data & 0xc0) != 0x80) {
+        COMPLETE_ERROR(EMBEDJSON_BAD_UTF8, data);
+      }
+      nb--;
+    }
+    if ((*data & 0xe0) == 0xc0) {
+      nb = 1;
+      continue;
+    } else if ((*data & 0xf0) == 0xe0) {
+      if (*data == '\xe0') {
+        cc = 1;
+      }
+      nb = 2;
+      continue;
+    } else if ((*data & 0xf8) == 0xf0) {
+      if (*data == '\xf0') {
+        cc = 2;
+      } else if (*data == '\xf4') {
+        cc = 3;
+      }
+      nb = 3;
+      continue;
+    } else if ((*data & 0xf8) == 0xf8) {
+      COMPLETE_ERROR(EMBEDJSON_LONG_UTF8, data);
+    }
+#endif
+    if (*data == '"') {
+      COMPLETE_FLUSH_ESCAPES(1);
+      if (data != string_chunk_begin) {
+        RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
+              data - string_chunk_begin));
+      }
+#if EMBEDJSON_VALIDATE_UTF8
+      lex->nb = nb;
+      lex->cc = cc;
+#endif
+      *position = data;
+      return embedjson_tokenc_end(lexer, data);
+    } else if (*data == '\\') {
+      if (data != string_chunk_begin) {
+        COMPLETE_FLUSH_ESCAPES(1);
+        RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
+              data - string_chunk_begin));
+      }
+      state = LEXER_STATE_IN_STRING_ESCAPE;
+      if (++data == end) {
+        goto eof;
+      }
+      const char* escape = 0;
+      switch (*data) {
+        case '"': escape = "\""; break;
+        case '\\': escape = "\\"; break;
+        case '/': escape = "/"; break;
+        case 'b': escape = "\b"; break;
+        case 'f': escape = "\f"; break;
+        case 'n': escape = "\n"; break;
+        case 'r': escape = "\r"; break;
+        case 't': escape = "\t"; break;
+      }
+      if (*data != 'u') {
+        COMPLETE_FLUSH_ESCAPES(1);
+        if (!escape) {
+          COMPLETE_ERROR(EMBEDJSON_BAD_ESCAPE, data);
+        }
+        RETURN_IF(embedjson_tokenc(lexer, escape, 1));
+      } else {
+        state = LEXER_STATE_IN_STRING_UNICODE_ESCAPE;
+        unsigned long cp = 0;
+        for (int i = 0; i < 4; ++i) {
+          if (++data == end) {
+            goto eof;
+          }
+          if ('0' <= *data && *data <= '9') {
+            cp = cp << 4 | (unsigned long) (*data - '0');
+          } else if ('a' <= *data && *data <= 'f') {
+            cp = cp << 4 | (unsigned long) (10 + *data - 'a');
+          } else if ('A' <= *data && *data <= 'F') {
+            cp = cp << 4 | (unsigned long) (10 + *data - 'A');
+          } else {
+            COMPLETE_ERROR(EMBEDJSON_BAD_UNICODE_ESCAPE, data);
+          }
+        }
+        if (nescapes > ESCAPE_BUFFER_SIZE - 6) {
+          COMPLETE_FLUSH_ESCAPES(0);
+        }
+        if (unicode_high && (cp & 0xfc00) == 0xdc00) {
+          cp = 0x10000 + ((unicode_high - 0xd800ul) << 10) + (cp - 0xdc00);
+          unicode_high = 0;
+        } else if (unicode_high) {
+          nescapes += utf8_encode(unicode_high, escapes + nescapes);
+          unicode_high = 0;
+        }
+        if ((cp & 0xfffc00) == 0xd800) {
+          /* Wait for the low surrogate */
+          unicode_high = (unsigned short) cp;
+        } else {
+          nescapes += utf8_encode(cp, escapes + nescapes);
+        }
+      }
+      string_chunk_begin = data + 1;
+      state = LEXER_STATE_IN_STRING;
+#if EMBEDJSON_VALIDATE_UTF8
+    } else if (!nb && (unsigned char) *data < 0x20) {
+      COMPLETE_ERROR(EMBEDJSON_BAD_UTF8, data);
+#endif
+    }
+  }
+
+eof:
+  /* Same as at the end of the buffer in lexer_pushv */
+  COMPLETE_FLUSH_ESCAPES(state == LEXER_STATE_IN_STRING
+      && end != string_chunk_begin);
+  if (state == LEXER_STATE_IN_STRING && end != string_chunk_begin) {
+    RETURN_IF(embedjson_tokenc(lexer, string_chunk_begin,
+          end - string_chunk_begin));
+  }
+#if EMBEDJSON_VALIDATE_UTF8
+  lex->nb = nb;
+  lex->cc = cc;
+#endif
+  lex->state = state;
+  *position = end - 1;
+  return 0;
+}
+
+
+/*
+ * Lexes a number that starts at *position. On return, *position points
+ * to the last byte of the number, to the last byte of data, or is set
+ * to NULL after an error.
+ */
+static int complete_number(embedjson_lexer* lexer, embedjson_lexer* lex,
+    const char** position, const char* end)
+{
+  const char* data = *position;
+  char minus = 0;
+  embedjson_int_t int_value = 0;
+  unsigned long long frac_value = 0;
+  unsigned short frac_power = 0;
+  unsigned short exp_value = 0;
+  char exp_minus = 0;
+  char exp_not_empty = 0;
+  unsigned char state = LEXER_STATE_IN_NUMBER_SIGN;
+  if (*data == '-') {
+    minus = 1;
+    if (++data == end) {
+      goto eof;
+    }
+    if (!('0' <= *data && *data <= '9')) {
+      COMPLETE_ERROR(EMBEDJSON_EOF_IN_STRING, data);
+    }
+  }
+  state = LEXER_STATE_IN_NUMBER;
+  int_value = *data - '0';
+  for (++data; data != end && '0' <= *data && *data <= '9'; ++data) {
+    if (!int_value) {
+      COMPLETE_ERROR(EMBEDJSON_LEADING_ZERO, data);
+    }
+    if (int_value > EMBEDJSON_INT_MAX / 10 - *data + '0') {
+#if EMBEDJSON_BIGNUM
+      RETURN_IF(embedjson_tokenbn_begin(lexer, data, int_value));
+      const char* string_chunk_begin = data + 1;
+      for (++data; data != end && (('0' <= *data && *data <= '9')
+            || *data == 'e' || *data == 'E' || *data == '-' || *data == '.');
+          ++data);
+      if (data != string_chunk_begin) {
+        RETURN_IF(embedjson_tokenbn(lexer, string_chunk_begin,
+              data - string_chunk_begin));
+      }
+      if (data == end) {
+        lex->state = LEXER_STATE_IN_BIG_NUMBER;
+        *position = end - 1;
+        return 0;
+      }
+      *position = data - 1;
+      return embedjson_tokenbn_end(lexer, data - 1);
+#else
+      COMPLETE_ERROR(EMBEDJSON_INT_OVERFLOW, data);
+#endif
+    }
+    int_value = 10 * int_value + *data - '0';
+  }
+  if (data == end) {
+    goto eof;
+  }
+  if (*data == '.') {
+    state = LEXER_STATE_IN_NUMBER_FRAC;
+    for (++data; data != end && '0' <= *data && *data <= '9'; ++data) {
+      frac_value = 10 * frac_value + *data - '0';
+      frac_power++;
+    }
+    if (data == end) {
+      goto eof;
+    }
+    if (!frac_power) {
+      COMPLETE_ERROR(EMBEDJSON_EMPTY_FRAC, data);
+    }
+  }
+  if (*data == 'e' || *data == 'E') {
+    state = LEXER_STATE_IN_NUMBER_EXP_SIGN;
+    if (++data == end) {
+      goto eof;
+    }
+    if (*data == '-') {
+      exp_minus = 1;
+    } else if ('0' <= *data && *data <= '9') {
+      exp_value = *data - '0';
+      exp_not_empty = 1;
+    } else if (*data != '+') {
+      COMPLETE_ERROR(EMBEDJSON_BAD_EXPONENT, data);
+    }
+    state = LEXER_STATE_IN_NUMBER_EXP;
+    for (++data; data != end && '0' <= *data && *data <= '9'; ++data) {
+      exp_value = 10 * exp_value + *data - '0';
+      exp_not_empty = 1;
+      if ((exp_minus && exp_value > 323) || (!exp_minus && exp_value > 308)) {
+        COMPLETE_ERROR(EMBEDJSON_EXPONENT_OVERFLOW, data);
+      }
+    }
+    if (data == end) {
+      goto eof;
+    }
+    if (!exp_not_empty) {
+      COMPLETE_ERROR(EMBEDJSON_EMPTY_EXP, data);
+    }
+  }
+  *position = --data;
+  if (state == LEXER_STATE_IN_NUMBER) {
+    if (minus) {
+      int_value = 0 - int_value;
+    }
+    return embedjson_tokeni(lexer, int_value, data);
+  }
+  double value = int_value + frac_value * powm10(frac_power);
+  if (state == LEXER_STATE_IN_NUMBER_EXP) {
+    value *= powm10(exp_minus ? exp_value : 0 - exp_value);
+  }
+  if (minus) {
+    value = 0 - value;
+  }
+  return embedjson_tokenf(lexer, value, data);
+
+eof:
+  lex->state = state;
+  lex->minus |= minus;
+  lex->int_value = int_value;
+  lex->frac_value = frac_value;
+  lex->frac_power = frac_power;
+  lex->exp_value = exp_value;
+  lex->exp_minus |= exp_minus;
+  lex->exp_not_empty |= exp_not_empty;
+  *position = end - 1;
+  return 0;
+}
+
+
+/*
+ * Same as SKIP_OR_RETURN_IF, but the value is skipped right away
+ */
+#define COMPLETE_SKIP_OR_RETURN_IF(f, depth) \
+do { \
+  int skip_err = (f); \
+  if (skip_err == EMBEDJSON_SKIP) { \
+    lex.state = LEXER_STATE_SKIP; \
+    lex.skip_depth = (depth); \
+    lex.skip_expect_value = !(depth); \
+    ++data; \
+    skip_err = embedjson_skip(&lex, &data, end); \
+    if (skip_err) { \
+      return embedjson_error_ex((embedjson_parser*) lexer, skip_err, data); \
+    } \
+  } else if (skip_err) { \
+    return skip_err; \
+  } \
+} while (0)
+
+
+static int lexer_complete(embedjson_lexer* lexer, const char* data,
+    const char* end)
+{
+  embedjson_lexer lex = *lexer;
+  /* Words may be loaded at positions before word_end */
+  const char* word_end = end - data >= 8 ? end - 7 : data;
+  for (; data != end; ++data) {
+    int n;
+    switch (*data) {
+      case ' ':
+      case '\n':
+      case '\r':
+      case '\t':
+        if (data + 1 < word_end) {
+          data = scan_spaces(data + 1, word_end) - 1;
+        }
+        break;
+      case ':':
+        COMPLETE_SKIP_OR_RETURN_IF(embedjson_token(lexer,
+              EMBEDJSON_TOKEN_COLON, data), 0);
+        break;
+      case ',':
+        COMPLETE_SKIP_OR_RETURN_IF(embedjson_token(lexer,
+              EMBEDJSON_TOKEN_COMMA, data), 0);
+        break;
+      case '{':
+        COMPLETE_SKIP_OR_RETURN_IF(embedjson_token(lexer,
+              EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET, data), 1);
+        break;
+      case '}':
+        RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET,
+              data));
+        break;
+      case '[':
+        COMPLETE_SKIP_OR_RETURN_IF(embedjson_token(lexer,
+              EMBEDJSON_TOKEN_OPEN_BRACKET, data), 1);
+        break;
+      case ']':
+        RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_CLOSE_BRACKET,
+              data));
+        break;
+      case '"':
+        COMPLETE_RETURN_IF(complete_string(lexer, &lex, &data, end,
+              word_end));
+        break;
+      case 't':
+        if ((n = complete_keyword(data, end, "true")) == 4) {
+          data += 3;
+          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_TRUE, data));
+          break;
+        }
+        if (data + n != end) {
+          return embedjson_error_ex((embedjson_parser*) lexer,
+              EMBEDJSON_BAD_TRUE, data + n);
+        }
+        lex.state = LEXER_STATE_IN_TRUE;
+        lex.offset = (unsigned char) n;
+        data = end - 1;
+        break;
+      case 'f':
+        if ((n = complete_keyword(data, end, "false")) == 5) {
+          data += 4;
+          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_FALSE, data));
+          break;
+        }
+        if (data + n != end) {
+          return embedjson_error_ex((embedjson_parser*) lexer,
+              EMBEDJSON_BAD_FALSE, data + n);
+        }
+        lex.state = LEXER_STATE_IN_FALSE;
+        lex.offset = (unsigned char) n;
+        data = end - 1;
+        break;
+      case 'n':
+        if ((n = complete_keyword(data, end, "null")) == 4) {
+          data += 3;
+          RETURN_IF(embedjson_token(lexer, EMBEDJSON_TOKEN_NULL, data));
+          break;
+        }
+        if (data + n != end) {
+          return embedjson_error_ex((embedjson_parser*) lexer,
+              EMBEDJSON_BAD_NULL, data + n);
+        }
+        lex.state = LEXER_STATE_IN_NULL;
+        lex.offset = (unsigned char) n;
+        data = end - 1;
+        break;
+      case '-':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+        COMPLETE_RETURN_IF(complete_number(lexer, &lex, &data, end));
+        break;
+      case '+':
+        return embedjson_error_ex((embedjson_parser*) lexer,
+            EMBEDJSON_LEADING_PLUS, data);
+      default:
+        return embedjson_error_ex((embedjson_parser*) lexer,
+            EMBEDJSON_UNEXP_SYMBOL, data);
+    }
+  }
+  if (embedjson_memcmp(&lex, lexer, sizeof(lex))) {
+    *lexer = lex;
+  }
+  return 0;
+}
+
+
+EMBEDJSON_STATIC int embedjson_lexer_parse_complete(embedjson_lexer* lexer,
+    const char* data, embedjson_size_t size)
+{
+  /* Input that has already been pushed is continued as usual */
+  if (lexer->magic_bytes_read) {
+    return embedjson_lexer_push(lexer, data, size);
+  }
+#if EMBEDJSON_TRANSCODE
+  unsigned char bom;
+  if (!size || transcode_detect_encoding((const unsigned char*) data,
+        size < 4 ? (unsigned char) size : 4, 1, &bom)
+      != EMBEDJSON_ENCODING_UTF8) {
+    return embedjson_lexer_push(lexer, data, size);
+  }
+  lexer->encoding = EMBEDJSON_ENCODING_UTF8;
+  lexer->magic_bytes_read = 4;
+  EMBEDJSON_LOG(lexer, "determined encoding: %s",
+      embedjson_encoding_to_str(lexer->encoding));
+  data += bom;
+  size -= bom;
+#else
+  while (lexer->magic_bytes_read < 4 && lexer->magic_bytes_read < size) {
+    lexer->magic.as_char[lexer->magic_bytes_read] =
+      data[lexer->magic_bytes_read];
+    lexer->magic_bytes_read++;
+  }
+  if (size > 4) {
+    lexer->encoding = guess_encoding(lexer->magic.as_int);
+    EMBEDJSON_LOG(lexer, "determined encoding: %s",
+        embedjson_encoding_to_str(lexer->encoding));
+  }
+#endif /* EMBEDJSON_TRANSCODE */
+  return lexer_complete(lexer, data, data + size);
+}
+
+
+#if EMBEDJSON_STREAM
+EMBEDJSON_STATIC void embedjson_lexer_reset(embedjson_lexer* lexer)
+{
+  lexer->state = LEXER_STATE_LOOKUP_TOKEN;
+  lexer->offset = 0;
+  lexer->minus = 0;
+  lexer->exp_minus = 0;
+  lexer->exp_not_empty = 0;
+  lexer->skip_in_string = 0;
+  lexer->skip_escape = 0;
+  lexer->skip_primitive = 0;
+  lexer->skip_expect_value = 0;
+  lexer->unicode_high = 0;
+  lexer->int_value = 0;
+  lexer->frac_value = 0;
+  lexer->frac_power = 0;
+  lexer->exp_value = 0;
+  lexer->skip_depth = 0;
+#if EMBEDJSON_VALIDATE_UTF8
+  lexer->nb = 0;
+  lexer->cc = 0;
+#endif /* EMBEDJSON_VALIDATE_UTF8 */
+#if EMBEDJSON_TRANSCODE
+  lexer->unit_size = 0;
+#endif /* EMBEDJSON_TRANSCODE */
+}
+
+
+EMBEDJSON_STATIC const char* embedjson_lexer_skip_line(
+    embedjson_lexer* lexer, const char* data, const char* end)
+{
+#if EMBEDJSON_TRANSCODE
+  unsigned char encoding = lexer->encoding;
+  if (encoding != EMBEDJSON_ENCODING_UNKNOWN
+      && encoding != EMBEDJSON_ENCODING_UTF8) {
+    unsigned char width = encoding == EMBEDJSON_ENCODING_UTF32LE
+      || encoding == EMBEDJSON_ENCODING_UTF32BE ? 4 : 2;
+    /* Offset of the least significant byte within a code unit */
+    unsigned char lo = encoding == EMBEDJSON_ENCODING_UTF16BE
+      || encoding == EMBEDJSON_ENCODING_UTF32BE ? width - 1 : 0;
+    for (;;) {
+      while (lexer->unit_size < width && data != end) {
+        lexer->unit[lexer->unit_size++] = (unsigned char) *data++;
+      }
+      if (lexer->unit_size < width) {
+        return 0;
+      }
+      unsigned char c = lexer->unit[lo];
+      unsigned char high = 0;
+      for (unsigned char i = 0; i < width; ++i) {
+        high |= i == lo ? 0 : lexer->unit[i];
+      }
+      transcode_drop(lexer, width);
+      if (!high && (c == '\n' || c == EMBEDJSON_RS)) {
+        return data;
+      }
+    }
+  }
+#endif /* EMBEDJSON_TRANSCODE */
+  EMBEDJSON_UNUSED(lexer);
+  while (data != end && *data != '\n' && *data != EMBEDJSON_RS) {
+    data++;
+  }
+  return data == end ? 0 : data + 1;
+}
+#endif /* EMBEDJSON_STREAM */
+
+
 EMBEDJSON_STATIC int embedjson_lexer_finalize(embedjson_lexer* lexer)
 {
+#if EMBEDJSON_TRANSCODE
+  RETURN_IF(transcode_finalize(lexer));
+  if (lexer->unit_size) {
+    return embedjson_error_ex((embedjson_parser*) lexer,
+        EMBEDJSON_BAD_ENCODING, 0);
+  }
+#endif /* EMBEDJSON_TRANSCODE */
   embedjson_lexer lex = *lexer;
   switch (lex.state) {
     case LEXER_STATE_LOOKUP_TOKEN:
@@ -655,6 +2209,9 @@ EMBEDJSON_STATIC int embedjson_lexer_finalize(embedjson_lexer* lexer)
     case LEXER_STATE_IN_NULL:
       return embedjson_error_ex((embedjson_parser*) lexer,
           EMBEDJSON_EOF_IN_NULL, 0);
+    case LEXER_STATE_SKIP:
+      return embedjson_error_ex((embedjson_parser*) lexer,
+          EMBEDJSON_INSUFFICIENT_INPUT, 0);
   }
   return 0;
 }
@@ -31,7 +31,8 @@
  * - a buffer provided for embedjson_lexer_push function is parsed
  *   to the end, while lexer is in the LEXER_STATE_IN_STRING state;
  * - ASCII escape sequence is found in the string;
- * - Unicode escape sequence is found in the string.
+ * - a run of Unicode escape sequences ends. Escape sequences are decoded
+ *   into UTF-8, surrogate pairs are combined into a single code point.
  *
  * For the user's convenience, two supplementary methods that wrap a sequence of
  * embedjson_tokenc calls are invoked by the lexer during parsing:
@@ -42,11 +43,19 @@ typedef struct embedjson_lexer {
   unsigned char state;
   unsigned char offset;
   char unicode_cp[2];
+  /**
+   * High surrogate from \u escape sequence that waits for the low one
+   */
+  unsigned short unicode_high;
   unsigned char encoding : 3;
   unsigned char magic_bytes_read : 3;
   char minus : 1;
   char exp_minus : 1;
   char exp_not_empty : 1;
+  unsigned char skip_in_string : 1;
+  unsigned char skip_escape : 1;
+  unsigned char skip_primitive : 1;
+  unsigned char skip_expect_value : 1;
   /**
    * Magic sequence for encoding guessing
    */
@@ -58,6 +67,10 @@ typedef struct embedjson_lexer {
   unsigned long long frac_value;
   unsigned short frac_power;
   unsigned short exp_value;
+  /**
+   * Nesting level of the value being skipped (see EMBEDJSON_SKIP)
+   */
+  embedjson_size_t skip_depth;
 #if EMBEDJSON_VALIDATE_UTF8
   /**
    * Number of bytes remaining to complete multibyte UTF-8 sequence
@@ -85,6 +98,14 @@ typedef struct embedjson_lexer {
    */
   unsigned char cc;
 #endif
+#if EMBEDJSON_TRANSCODE
+  /**
+   * Bytes of an incomplete UTF-16 or UTF-32 code point, carried over
+   * to the next embedjson_lexer_push call
+   */
+  unsigned char unit[4];
+  unsigned char unit_size;
+#endif
 } embedjson_lexer;
 
 /**
@@ -121,6 +142,43 @@ typedef enum {
 EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
     const char* data, embedjson_size_t size);
 
+/**
+ * Same as embedjson_lexer_push, but parsing is paused after the token
+ * that caused EMBEDJSON_PAUSE to be returned from the callback, or after
+ * max_events tokens and string chunks (zero means no limit).
+ *
+ * Returns EMBEDJSON_PAUSE if parsing has been paused. Number of bytes
+ * consumed is stored in *consumed, unless consumed is NULL. The rest of the
+ * data should be provided again to resume parsing.
+ */
+EMBEDJSON_STATIC int embedjson_lexer_push_ex(embedjson_lexer* lexer,
+    const char* data, embedjson_size_t size, embedjson_size_t max_events,
+    embedjson_size_t* consumed);
+
+/**
+ * Same as a series of embedjson_lexer_push calls for each of iovcnt
+ * segments, but the lexer state is loaded and stored only once
+ */
+EMBEDJSON_STATIC int embedjson_lexer_pushv(embedjson_lexer* lexer,
+    const embedjson_iovec* iov, embedjson_size_t iovcnt);
+
+/**
+ * Same as embedjson_lexer_push, but EMBEDJSON_PADDING bytes after
+ * the end of data should be readable
+ */
+EMBEDJSON_STATIC int embedjson_lexer_push_padded(embedjson_lexer* lexer,
+    const char* data, embedjson_size_t size);
+
+/**
+ * Same as embedjson_lexer_push, but data is known to be the whole input,
+ * so tokens are lexed to the end in one go.
+ *
+ * If data ends in the middle of a token, it is reported by
+ * embedjson_lexer_finalize.
+ */
+EMBEDJSON_STATIC int embedjson_lexer_parse_complete(embedjson_lexer* lexer,
+    const char* data, embedjson_size_t size);
+
 /**
  * Called by embedjson_finalize to indicate that all data has been submitted to
  * lexer.
@@ -129,6 +187,31 @@ EMBEDJSON_STATIC int embedjson_lexer_push(embedjson_lexer* lexer,
  */
 EMBEDJSON_STATIC int embedjson_lexer_finalize(embedjson_lexer* lexer);
 
+#if EMBEDJSON_STREAM
+/**
+ * Record separator (RFC 7464), treated as whitespace in stream mode
+ */
+#define EMBEDJSON_RS '\x1e'
+
+/**
+ * Discards the token being parsed, so that the next pushed byte is
+ * treated as the beginning of a new token.
+ *
+ * Detected input encoding is kept.
+ */
+EMBEDJSON_STATIC void embedjson_lexer_reset(embedjson_lexer* lexer);
+
+/**
+ * Returns a pointer past the first newline or record separator
+ * in [data, end), or NULL if there is none.
+ *
+ * UTF-16 and UTF-32 input is scanned by code units, bytes of a code unit
+ * split between calls are kept in the lexer.
+ */
+EMBEDJSON_STATIC const char* embedjson_lexer_skip_line(
+    embedjson_lexer* lexer, const char* data, const char* end);
+#endif /* EMBEDJSON_STREAM */
+
 /**
  * Called from embedjson_lexer_push for each successfully parsed any token
  * that does not have a value.
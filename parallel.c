@@ -0,0 +1,963 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+#include "common.h"
+#include "parallel.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_PARALLEL
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __GNUC__
+#error EMBEDJSON_PARALLEL requires GCC-compatible atomic builtins
+#endif /* __GNUC__ */
+
+#define PARALLEL_BATCH_SIZE (1 << 20)
+
+typedef struct {
+  const char* record;
+  embedjson_size_t size;
+  int err;
+  void* result;
+} parallel_record;
+
+/*
+ * Part of a document validated by a single worker, see
+ * embedjson_parallel_validate
+ */
+typedef struct {
+  const char* begin;
+  /* Enclosing objects and arrays, see embedjson_seed */
+  char* containers;
+  embedjson_size_t depth;
+} parallel_range;
+
+/*
+ * Slot of the reorder queue, holds results of a single batch
+ */
+typedef struct {
+  /* Index of the batch plus one, set when all results are ready */
+  embedjson_size_t ready;
+  /* Set if memory allocation failed */
+  unsigned char failed;
+  parallel_record* records;
+  embedjson_size_t nrecords;
+  embedjson_size_t capacity;
+} parallel_slot;
+
+/*
+ * Batches are claimed by workers in input order, and delivered
+ * to the application in the same order. A worker may run ahead of
+ * delivery by at most nslots batches.
+ */
+typedef struct {
+  const char* data;
+  const char* end;
+  embedjson_size_t batch_size;
+  /*
+   * Array mode: element i lies between delimiters[i] and delimiters[i + 1],
+   * batch_size is the number of elements per batch
+   */
+  const char** delimiters;
+  embedjson_size_t nelements;
+  /*
+   * Validation mode: each batch is a single range, delivery stops
+   * at the first invalid one
+   */
+  parallel_range* ranges;
+  embedjson_size_t nbatches;
+  /* Next batch to be claimed by a worker */
+  embedjson_size_t next;
+  /* Number of batches delivered to the application */
+  embedjson_size_t delivered;
+  /* Set if parsing is stopped by the application */
+  unsigned char stop;
+  embedjson_size_t nslots;
+  parallel_slot* slots;
+  /* Guards slots' ready flags, delivered and stop */
+  pthread_mutex_t lock;
+  /* Signalled when a batch is ready */
+  pthread_cond_t batch_ready;
+  /* Signalled when a batch is delivered, or parsing is stopped */
+  pthread_cond_t batch_delivered;
+} parallel_queue;
+
+typedef struct {
+  parallel_queue* queue;
+  void* userdata;
+} parallel_worker;
+
+/*
+ * Returns the beginning of the first record that starts at or after
+ * the given offset
+ */
+static const char* batch_boundary(const parallel_queue* q,
+    embedjson_size_t offset)
+{
+  if (!offset) {
+    return q->data;
+  }
+  if (offset >= (embedjson_size_t) (q->end - q->data)) {
+    return q->end;
+  }
+  const char* from = q->data + offset - 1;
+  const char* newline = memchr(from, '\n', q->end - from);
+  return newline ? newline + 1 : q->end;
+}
+
+static int blank(const char* data, const char* end)
+{
+  for (; data != end; ++data) {
+    if (*data != ' ' && *data != '\t' && *data != '\r') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Returns non-zero for UTF-16 and UTF-32 input, whose first code unit
+ * contains a zero byte
+ */
+static int wide_encoding(const char* data, embedjson_size_t size)
+{
+  return size && memchr(data, 0, size < 4 ? size : 4);
+}
+
+static int whitespace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*
+ * Prepares worker's parser for the next record
+ */
+static void parallel_reset(embedjson_parser* parser, void* userdata)
+{
+#if EMBEDJSON_DYNAMIC_STACK
+  char* stack = parser->stack;
+  embedjson_size_t stack_capacity = parser->stack_capacity;
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  memset(parser, 0, sizeof(*parser));
+#if EMBEDJSON_DYNAMIC_STACK
+  parser->stack = stack;
+  parser->stack_capacity = stack_capacity;
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  parser->userdata = userdata;
+}
+
+static int slot_append(parallel_slot* slot, const char* record,
+    embedjson_size_t size, int err, void* result)
+{
+  if (slot->nrecords == slot->capacity) {
+    embedjson_size_t capacity = 2 * slot->capacity + 16;
+    parallel_record* records = realloc(slot->records,
+        capacity * sizeof(parallel_record));
+    if (!records) {
+      return -1;
+    }
+    slot->records = records;
+    slot->capacity = capacity;
+  }
+  parallel_record* r = slot->records + slot->nrecords++;
+  r->record = record;
+  r->size = size;
+  r->err = err;
+  r->result = result;
+  return 0;
+}
+
+static int parse_lines(parallel_worker* worker, embedjson_parser* parser,
+    parallel_slot* slot, const char* data, const char* end)
+{
+  while (data != end) {
+    const char* newline = memchr(data, '\n', end - data);
+    const char* record_end = newline ? newline : end;
+    if (!blank(data, record_end)) {
+      embedjson_size_t size = record_end - data;
+      parallel_reset(parser, worker->userdata);
+      int err = embedjson_push(parser, data, size);
+      if (!err) {
+        err = embedjson_finalize(parser);
+      }
+      void* result = embedjson_record_end(parser, data, size, err);
+      if (slot_append(slot, data, size, err, result)) {
+        return -1;
+      }
+    }
+    data = newline ? newline + 1 : end;
+  }
+  return 0;
+}
+
+static int parse_elements(parallel_worker* worker, embedjson_parser* parser,
+    parallel_slot* slot, embedjson_size_t first, embedjson_size_t last)
+{
+  const char** delimiters = worker->queue->delimiters;
+  for (embedjson_size_t i = first; i < last; ++i) {
+    const char* data = delimiters[i] + 1;
+    const char* end = delimiters[i + 1];
+    for (; data != end && whitespace(*data); ++data);
+    for (; data != end && whitespace(end[-1]); --end);
+    embedjson_size_t size = end - data;
+    parallel_reset(parser, worker->userdata);
+    int err = embedjson_seed_array(parser, i);
+    if (!err) {
+      err = embedjson_push(parser, data, size);
+      if (!err) {
+        err = embedjson_finalize_element(parser);
+      }
+    } else if (err == EMBEDJSON_SKIP) {
+      err = 0;
+    }
+    void* result = embedjson_record_end(parser, data, size, err);
+    if (slot_append(slot, data, size, err, result)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int parse_range(parallel_worker* worker, embedjson_parser* parser,
+    parallel_slot* slot, embedjson_size_t i)
+{
+  const parallel_queue* q = worker->queue;
+  const parallel_range* range = q->ranges + i;
+  const char* end = i + 1 < q->nbatches ? range[1].begin : q->end;
+  embedjson_size_t size = end - range->begin;
+  parallel_reset(parser, worker->userdata);
+  int err = embedjson_seed(parser, range->containers, range->depth);
+  if (!err) {
+    err = embedjson_push(parser, range->begin, size);
+  }
+  if (!err && end == q->end) {
+    err = embedjson_finalize(parser);
+  }
+  void* result = embedjson_record_end(parser, range->begin, size, err);
+  return slot_append(slot, range->begin, size, err, result);
+}
+
+static int parse_batch(parallel_worker* worker, embedjson_parser* parser,
+    parallel_slot* slot, embedjson_size_t i)
+{
+  const parallel_queue* q = worker->queue;
+  slot->nrecords = 0;
+  if (q->ranges) {
+    return parse_range(worker, parser, slot, i);
+  }
+  if (q->delimiters) {
+    embedjson_size_t first = i * q->batch_size;
+    embedjson_size_t last = first + q->batch_size;
+    return parse_elements(worker, parser, slot, first,
+        last < q->nelements ? last : q->nelements);
+  }
+  return parse_lines(worker, parser, slot, batch_boundary(q, i * q->batch_size),
+      batch_boundary(q, (i + 1) * q->batch_size));
+}
+
+static void* worker_main(void* arg)
+{
+  parallel_worker* worker = (parallel_worker*) arg;
+  parallel_queue* q = worker->queue;
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  for (;;) {
+    embedjson_size_t i = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+    if (i >= q->nbatches) {
+      break;
+    }
+    pthread_mutex_lock(&q->lock);
+    while (i >= q->delivered + q->nslots && !q->stop) {
+      pthread_cond_wait(&q->batch_delivered, &q->lock);
+    }
+    unsigned char stop = q->stop;
+    pthread_mutex_unlock(&q->lock);
+    if (stop) {
+      break;
+    }
+    parallel_slot* slot = q->slots + i % q->nslots;
+    slot->failed = !!parse_batch(worker, &parser, slot, i);
+    pthread_mutex_lock(&q->lock);
+    slot->ready = i + 1;
+    pthread_cond_signal(&q->batch_ready);
+    pthread_mutex_unlock(&q->lock);
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  return NULL;
+}
+
+/*
+ * Parses batches of the queue on nthreads workers, and delivers
+ * results in order
+ */
+static int parallel_run(parallel_queue* q, unsigned nthreads,
+    void** userdata)
+{
+  if (pthread_mutex_init(&q->lock, NULL)) {
+    return EMBEDJSON_THREAD_ERROR;
+  }
+  if (pthread_cond_init(&q->batch_ready, NULL)) {
+    pthread_mutex_destroy(&q->lock);
+    return EMBEDJSON_THREAD_ERROR;
+  }
+  if (pthread_cond_init(&q->batch_delivered, NULL)) {
+    pthread_cond_destroy(&q->batch_ready);
+    pthread_mutex_destroy(&q->lock);
+    return EMBEDJSON_THREAD_ERROR;
+  }
+  q->nslots = 2 * nthreads;
+  q->slots = calloc(q->nslots, sizeof(parallel_slot));
+  parallel_worker* workers = calloc(nthreads, sizeof(parallel_worker));
+  pthread_t* threads = calloc(nthreads, sizeof(pthread_t));
+  unsigned nstarted = 0;
+  if (q->slots && workers && threads) {
+    for (; nstarted < nthreads; ++nstarted) {
+      workers[nstarted].queue = q;
+      workers[nstarted].userdata = userdata ? userdata[nstarted] : NULL;
+      if (pthread_create(threads + nstarted, NULL, worker_main,
+            workers + nstarted)) {
+        break;
+      }
+    }
+  }
+
+  int err = nstarted ? 0 : EMBEDJSON_THREAD_ERROR;
+  for (embedjson_size_t i = 0; !err && i < q->nbatches; ++i) {
+    parallel_slot* slot = q->slots + i % q->nslots;
+    pthread_mutex_lock(&q->lock);
+    while (slot->ready != i + 1) {
+      pthread_cond_wait(&q->batch_ready, &q->lock);
+    }
+    pthread_mutex_unlock(&q->lock);
+    if (slot->failed) {
+      err = EMBEDJSON_THREAD_ERROR;
+      break;
+    }
+    for (embedjson_size_t j = 0; !err && j < slot->nrecords; ++j) {
+      const parallel_record* r = slot->records + j;
+      err = embedjson_record_result(r->record, r->size, r->result);
+      if (!err && q->ranges) {
+        err = r->err;
+      }
+    }
+    pthread_mutex_lock(&q->lock);
+    q->delivered = i + 1;
+    pthread_cond_broadcast(&q->batch_delivered);
+    pthread_mutex_unlock(&q->lock);
+  }
+  if (err) {
+    pthread_mutex_lock(&q->lock);
+    q->stop = 1;
+    pthread_cond_broadcast(&q->batch_delivered);
+    pthread_mutex_unlock(&q->lock);
+  }
+
+  for (unsigned i = 0; i < nstarted; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  for (embedjson_size_t i = 0; q->slots && i < q->nslots; ++i) {
+    free(q->slots[i].records);
+  }
+  free(q->slots);
+  free(workers);
+  free(threads);
+  pthread_cond_destroy(&q->batch_delivered);
+  pthread_cond_destroy(&q->batch_ready);
+  pthread_mutex_destroy(&q->lock);
+  return err;
+}
+
+EMBEDJSON_STATIC int embedjson_parallel_ndjson(const char* data,
+    embedjson_size_t size, unsigned nthreads, embedjson_size_t batch_size,
+    void** userdata)
+{
+  if (wide_encoding(data, size)) {
+    return EMBEDJSON_BAD_ENCODING;
+  }
+  parallel_queue q;
+  memset(&q, 0, sizeof(q));
+  q.data = data;
+  q.end = data + size;
+  q.batch_size = batch_size ? batch_size : PARALLEL_BATCH_SIZE;
+  q.nbatches = (size + q.batch_size - 1) / q.batch_size;
+  return parallel_run(&q, nthreads ? nthreads : 1, userdata);
+}
+
+/*
+ * Structural summary of a chunk of a top-level array, see
+ * embedjson_parallel_array. Computed with an assumption on whether
+ * the chunk starts inside a string.
+ */
+typedef struct {
+  const char* begin;
+  const char* end;
+  /* String state at the beginning of the chunk */
+  unsigned char in_string;
+  unsigned char escape;
+  /* String state at the end of the chunk */
+  unsigned char end_in_string;
+  unsigned char end_escape;
+  /* Set if memory allocation failed */
+  unsigned char failed;
+  /* Nesting depth at the end of the chunk, relative to its beginning */
+  long depth;
+  /*
+   * Lowest depth after a closing bracket, and where it was first reached,
+   * or one and NULL if the chunk has no closing brackets
+   */
+  long min_depth;
+  const char* min_position;
+  /* Depth of the shallowest commas, and their positions */
+  long comma_depth;
+  const char** commas;
+  embedjson_size_t ncommas;
+  embedjson_size_t capacity;
+} array_chunk;
+
+typedef struct {
+  array_chunk* chunks;
+  embedjson_size_t nchunks;
+  /* Next chunk to be claimed by a scanning thread */
+  embedjson_size_t next;
+} array_scan;
+
+/*
+ * Guesses if the chunk starts inside a string by looking at the character
+ * that follows its first quote: a closing quote is usually followed
+ * by a colon, a comma or a closing bracket.
+ */
+static unsigned char speculate_in_string(const char* begin, const char* end)
+{
+  const char* quote = begin;
+  for (;;) {
+    quote = memchr(quote, '"', end - quote);
+    if (!quote) {
+      return 0;
+    }
+    if (quote == begin || quote[-1] != '\\') {
+      break;
+    }
+    ++quote;
+  }
+  const char* next = quote + 1;
+  for (; next != end && whitespace(*next); ++next);
+  return next != end
+    && (*next == ':' || *next == ',' || *next == '}' || *next == ']');
+}
+
+static int chunk_append(array_chunk* chunk, const char* comma)
+{
+  if (chunk->ncommas == chunk->capacity) {
+    embedjson_size_t capacity = 2 * chunk->capacity + 16;
+    const char** commas = realloc(chunk->commas, capacity * sizeof(char*));
+    if (!commas) {
+      return -1;
+    }
+    chunk->commas = commas;
+    chunk->capacity = capacity;
+  }
+  chunk->commas[chunk->ncommas++] = comma;
+  return 0;
+}
+
+static void scan_chunk(array_chunk* chunk, unsigned char in_string,
+    unsigned char escape)
+{
+  long depth = 0;
+  chunk->in_string = in_string;
+  chunk->escape = escape;
+  chunk->min_depth = 1;
+  chunk->min_position = NULL;
+  chunk->ncommas = 0;
+  for (const char* p = chunk->begin; p != chunk->end; ++p) {
+    if (in_string) {
+      if (escape) {
+        escape = 0;
+      } else if (*p == '\\') {
+        escape = 1;
+      } else if (*p == '"') {
+        in_string = 0;
+      }
+      continue;
+    }
+    switch (*p) {
+      case '"':
+        in_string = 1;
+        break;
+      case '{':
+      case '[':
+        ++depth;
+        break;
+      case '}':
+      case ']':
+        if (--depth < chunk->min_depth) {
+          chunk->min_depth = depth;
+          chunk->min_position = p;
+        }
+        break;
+      case ',':
+        if (!chunk->ncommas || depth < chunk->comma_depth) {
+          chunk->comma_depth = depth;
+          chunk->ncommas = 0;
+        }
+        if (depth == chunk->comma_depth && chunk_append(chunk, p)) {
+          chunk->failed = 1;
+          return;
+        }
+        break;
+    }
+  }
+  chunk->depth = depth;
+  chunk->end_in_string = in_string;
+  chunk->end_escape = escape;
+}
+
+static void* array_scan_main(void* arg)
+{
+  array_scan* scan = (array_scan*) arg;
+  for (;;) {
+    embedjson_size_t i = __atomic_fetch_add(&scan->next, 1, __ATOMIC_RELAXED);
+    if (i >= scan->nchunks) {
+      break;
+    }
+    array_chunk* chunk = scan->chunks + i;
+    scan_chunk(chunk, i ? speculate_in_string(chunk->begin, chunk->end) : 0,
+        0);
+  }
+  return NULL;
+}
+
+/*
+ * Scans all chunks on nthreads threads, including the calling one
+ */
+static void scan_run(void* (*scan_chunks)(void*), void* scan,
+    unsigned nthreads)
+{
+  pthread_t* threads = calloc(nthreads, sizeof(pthread_t));
+  unsigned nstarted = 0;
+  for (; threads && nstarted + 1 < nthreads; ++nstarted) {
+    if (pthread_create(threads + nstarted, NULL, scan_chunks, scan)) {
+      break;
+    }
+  }
+  scan_chunks(scan);
+  for (unsigned i = 0; i < nstarted; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+}
+
+/*
+ * Resolves string state at the beginning of each chunk, and re-scans
+ * chunks, where speculation has failed. Then collects delimiters of the
+ * top-level array elements - opening bracket, commas at depth one, and
+ * closing bracket.
+ *
+ * Returns 0 on success, 1 if data is not a single well-formed array,
+ * or -1 if memory allocation failed.
+ */
+static int array_delimiters(parallel_queue* q, array_scan* scan,
+    const char* open)
+{
+  unsigned char in_string = 0;
+  unsigned char escape = 0;
+  long depth = 0;
+  const char* close = NULL;
+  embedjson_size_t ncommas = 0;
+  for (embedjson_size_t i = 0; i < scan->nchunks; ++i) {
+    array_chunk* chunk = scan->chunks + i;
+    if (chunk->in_string != in_string || chunk->escape != escape) {
+      scan_chunk(chunk, in_string, escape);
+    }
+    if (chunk->failed) {
+      return -1;
+    }
+    if (close || depth + chunk->comma_depth != 1) {
+      chunk->ncommas = 0;
+    }
+    if (!close) {
+      if (depth + chunk->min_depth < 0) {
+        return 1;
+      }
+      if (chunk->min_position && depth + chunk->min_depth == 0) {
+        close = chunk->min_position;
+      }
+    }
+    ncommas += chunk->ncommas;
+    depth += chunk->depth;
+    in_string = chunk->end_in_string;
+    escape = chunk->end_escape;
+  }
+  if (!close) {
+    return 1;
+  }
+  for (const char* p = close + 1; p != q->end; ++p) {
+    if (!whitespace(*p)) {
+      return 1;
+    }
+  }
+
+  q->delimiters = malloc((ncommas + 2) * sizeof(char*));
+  if (!q->delimiters) {
+    return -1;
+  }
+  q->delimiters[0] = open;
+  q->nelements = 1;
+  for (embedjson_size_t i = 0; i < scan->nchunks; ++i) {
+    const array_chunk* chunk = scan->chunks + i;
+    memcpy(q->delimiters + q->nelements, chunk->commas,
+        chunk->ncommas * sizeof(char*));
+    q->nelements += chunk->ncommas;
+  }
+  q->delimiters[q->nelements] = close;
+  if (q->nelements == 1) {
+    /* Empty array */
+    const char* p = open + 1;
+    for (; p != close && whitespace(*p); ++p);
+    q->nelements = p != close;
+  }
+  return 0;
+}
+
+/*
+ * Parses the whole input as a single record on the calling thread
+ */
+static int parse_whole(const char* data, embedjson_size_t size,
+    void** userdata)
+{
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  parallel_reset(&parser, userdata ? userdata[0] : NULL);
+  int err = embedjson_push(&parser, data, size);
+  if (!err) {
+    err = embedjson_finalize(&parser);
+  }
+  void* result = embedjson_record_end(&parser, data, size, err);
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  return embedjson_record_result(data, size, result);
+}
+
+EMBEDJSON_STATIC int embedjson_parallel_array(const char* data,
+    embedjson_size_t size, unsigned nthreads, embedjson_size_t batch_size,
+    void** userdata)
+{
+  if (wide_encoding(data, size)) {
+    return EMBEDJSON_BAD_ENCODING;
+  }
+  const char* open = data;
+  for (; open != data + size && whitespace(*open); ++open);
+  if (open == data + size || *open != '[') {
+    return parse_whole(data, size, userdata);
+  }
+  batch_size = batch_size ? batch_size : PARALLEL_BATCH_SIZE;
+  nthreads = nthreads ? nthreads : 1;
+
+  array_scan scan;
+  memset(&scan, 0, sizeof(scan));
+  scan.nchunks = (size + batch_size - 1) / batch_size;
+  scan.chunks = calloc(scan.nchunks, sizeof(array_chunk));
+  if (!scan.chunks) {
+    return EMBEDJSON_THREAD_ERROR;
+  }
+  for (embedjson_size_t i = 0; i < scan.nchunks; ++i) {
+    scan.chunks[i].begin = data + i * batch_size;
+    scan.chunks[i].end = i + 1 < scan.nchunks ? data + (i + 1) * batch_size
+      : data + size;
+  }
+  scan_run(array_scan_main, &scan, nthreads);
+
+  parallel_queue q;
+  memset(&q, 0, sizeof(q));
+  q.data = data;
+  q.end = data + size;
+  int err = array_delimiters(&q, &scan, open);
+  for (embedjson_size_t i = 0; i < scan.nchunks; ++i) {
+    free(scan.chunks[i].commas);
+  }
+  free(scan.chunks);
+  if (err) {
+    free(q.delimiters);
+    return err > 0 ? parse_whole(data, size, userdata) : EMBEDJSON_THREAD_ERROR;
+  }
+  if (q.nelements) {
+    /* Batches of about batch_size bytes */
+    embedjson_size_t average = size / q.nelements;
+    q.batch_size = batch_size / (average ? average : 1);
+    q.batch_size = q.batch_size ? q.batch_size : 1;
+    q.nbatches = (q.nelements + q.batch_size - 1) / q.batch_size;
+    err = parallel_run(&q, nthreads, userdata);
+  }
+  free(q.delimiters);
+  return err;
+}
+
+/*
+ * Brackets of a part of a document, that are not matched within the part
+ */
+typedef struct {
+  /* Types of unmatched closing brackets, '{' or '[' */
+  char* closers;
+  embedjson_size_t nclosers;
+  embedjson_size_t closers_capacity;
+  /* Types of unmatched opening brackets */
+  char* openers;
+  embedjson_size_t nopeners;
+  embedjson_size_t openers_capacity;
+} bracket_summary;
+
+/*
+ * Structural summary of a chunk of a document, see
+ * embedjson_parallel_validate. Computed with an assumption on whether
+ * the chunk starts inside a string.
+ */
+typedef struct {
+  const char* begin;
+  const char* end;
+  /* String state at the beginning of the chunk */
+  unsigned char in_string;
+  unsigned char escape;
+  /* String state at the end of the chunk */
+  unsigned char end_in_string;
+  unsigned char end_escape;
+  /* Set if memory allocation failed */
+  unsigned char failed;
+  /* Position right after the first comma outside strings, or NULL */
+  const char* cut;
+  /* Brackets before and after the cut */
+  bracket_summary head;
+  bracket_summary tail;
+} validate_chunk;
+
+typedef struct {
+  validate_chunk* chunks;
+  embedjson_size_t nchunks;
+  /* Next chunk to be claimed by a scanning thread */
+  embedjson_size_t next;
+} validate_scan;
+
+static int buffer_append(char** data, embedjson_size_t* size,
+    embedjson_size_t* capacity, const char* chars, embedjson_size_t n)
+{
+  if (*size + n > *capacity) {
+    embedjson_size_t new_capacity = 2 * *capacity + n + 16;
+    char* new_data = realloc(*data, new_capacity);
+    if (!new_data) {
+      return -1;
+    }
+    *data = new_data;
+    *capacity = new_capacity;
+  }
+  memcpy(*data + *size, chars, n);
+  *size += n;
+  return 0;
+}
+
+static void summarize_chunk(validate_chunk* chunk, unsigned char in_string,
+    unsigned char escape)
+{
+  bracket_summary* summary = &chunk->head;
+  chunk->in_string = in_string;
+  chunk->escape = escape;
+  chunk->cut = NULL;
+  chunk->head.nclosers = chunk->head.nopeners = 0;
+  chunk->tail.nclosers = chunk->tail.nopeners = 0;
+  for (const char* p = chunk->begin; p != chunk->end; ++p) {
+    if (in_string) {
+      if (escape) {
+        escape = 0;
+      } else if (*p == '\\') {
+        escape = 1;
+      } else if (*p == '"') {
+        in_string = 0;
+      }
+      continue;
+    }
+    char type = 0;
+    switch (*p) {
+      case '"':
+        in_string = 1;
+        break;
+      case '{':
+      case '[':
+        if (buffer_append(&summary->openers, &summary->nopeners,
+              &summary->openers_capacity, p, 1)) {
+          chunk->failed = 1;
+          return;
+        }
+        break;
+      case '}':
+      case ']':
+        /* Mismatched brackets are reported by the parser */
+        if (summary->nopeners) {
+          summary->nopeners--;
+          break;
+        }
+        type = *p == '}' ? '{' : '[';
+        if (buffer_append(&summary->closers, &summary->nclosers,
+              &summary->closers_capacity, &type, 1)) {
+          chunk->failed = 1;
+          return;
+        }
+        break;
+      case ',':
+        if (!chunk->cut) {
+          chunk->cut = p + 1;
+          summary = &chunk->tail;
+        }
+        break;
+    }
+  }
+  chunk->end_in_string = in_string;
+  chunk->end_escape = escape;
+}
+
+static void* summarize_main(void* arg)
+{
+  validate_scan* scan = (validate_scan*) arg;
+  for (;;) {
+    embedjson_size_t i = __atomic_fetch_add(&scan->next, 1, __ATOMIC_RELAXED);
+    if (i >= scan->nchunks) {
+      break;
+    }
+    validate_chunk* chunk = scan->chunks + i;
+    summarize_chunk(chunk,
+        i ? speculate_in_string(chunk->begin, chunk->end) : 0, 0);
+  }
+  return NULL;
+}
+
+/*
+ * Applies brackets of a part of the document to the stack of enclosing
+ * objects and arrays. Returns 1 if there are more closing brackets than
+ * enclosing objects and arrays, or -1 if memory allocation failed.
+ */
+static int stack_apply(char** stack, embedjson_size_t* depth,
+    embedjson_size_t* capacity, const bracket_summary* summary)
+{
+  if (summary->nclosers > *depth) {
+    return 1;
+  }
+  *depth -= summary->nclosers;
+  return buffer_append(stack, depth, capacity, summary->openers,
+      summary->nopeners);
+}
+
+/*
+ * Resolves string state at the beginning of each chunk, re-scanning
+ * chunks where speculation has failed, and combines summaries of chunks
+ * into ranges to be validated independently. A range starts at the first
+ * cut of a chunk, and its parser is seeded with objects and arrays that
+ * enclose the cut.
+ *
+ * Once closing brackets do not match anything, the rest of the document
+ * is left in the last range, which is invalid anyway.
+ *
+ * Returns the number of ranges, or zero if memory allocation failed.
+ */
+static embedjson_size_t validate_ranges(parallel_queue* q,
+    validate_scan* scan)
+{
+  unsigned char in_string = 0;
+  unsigned char escape = 0;
+  char* stack = NULL;
+  embedjson_size_t depth = 0;
+  embedjson_size_t capacity = 0;
+  embedjson_size_t nranges = 1;
+  q->ranges = calloc(scan->nchunks, sizeof(parallel_range));
+  if (!q->ranges) {
+    return 0;
+  }
+  q->ranges[0].begin = q->data;
+  for (embedjson_size_t i = 0; i < scan->nchunks; ++i) {
+    validate_chunk* chunk = scan->chunks + i;
+    if (chunk->in_string != in_string || chunk->escape != escape) {
+      summarize_chunk(chunk, in_string, escape);
+    }
+    if (chunk->failed) {
+      nranges = 0;
+      break;
+    }
+    int err = stack_apply(&stack, &depth, &capacity, &chunk->head);
+    if (!err && i && chunk->cut && depth) {
+      parallel_range* range = q->ranges + nranges++;
+      range->begin = chunk->cut;
+      range->depth = depth;
+      range->containers = malloc(depth);
+      if (!range->containers) {
+        err = -1;
+      } else {
+        memcpy(range->containers, stack, depth);
+      }
+    }
+    if (!err) {
+      err = stack_apply(&stack, &depth, &capacity, &chunk->tail);
+    }
+    if (err) {
+      nranges = err > 0 ? nranges : 0;
+      break;
+    }
+    in_string = chunk->end_in_string;
+    escape = chunk->end_escape;
+  }
+  free(stack);
+  return nranges;
+}
+
+EMBEDJSON_STATIC int embedjson_parallel_validate(const char* data,
+    embedjson_size_t size, unsigned nthreads, embedjson_size_t batch_size,
+    void** userdata)
+{
+  batch_size = batch_size ? batch_size : PARALLEL_BATCH_SIZE;
+  nthreads = nthreads ? nthreads : 1;
+  validate_scan scan;
+  memset(&scan, 0, sizeof(scan));
+  scan.nchunks = size ? (size + batch_size - 1) / batch_size : 1;
+  /* Structure of UTF-16 and UTF-32 documents is not scanned */
+  if (wide_encoding(data, size)) {
+    scan.nchunks = 1;
+  }
+  scan.chunks = calloc(scan.nchunks, sizeof(validate_chunk));
+  if (!scan.chunks) {
+    return EMBEDJSON_THREAD_ERROR;
+  }
+  for (embedjson_size_t i = 0; i < scan.nchunks; ++i) {
+    scan.chunks[i].begin = data + i * batch_size;
+    scan.chunks[i].end = i + 1 < scan.nchunks ? data + (i + 1) * batch_size
+      : data + size;
+  }
+  scan_run(summarize_main, &scan, nthreads);
+
+  parallel_queue q;
+  memset(&q, 0, sizeof(q));
+  q.data = data;
+  q.end = data + size;
+  q.nbatches = validate_ranges(&q, &scan);
+  for (embedjson_size_t i = 0; i < scan.nchunks; ++i) {
+    free(scan.chunks[i].head.closers);
+    free(scan.chunks[i].head.openers);
+    free(scan.chunks[i].tail.closers);
+    free(scan.chunks[i].tail.openers);
+  }
+  free(scan.chunks);
+  int err = q.nbatches ? parallel_run(&q, nthreads, userdata)
+    : EMBEDJSON_THREAD_ERROR;
+  for (embedjson_size_t i = 0; q.ranges && i < scan.nchunks; ++i) {
+    free(q.ranges[i].containers);
+  }
+  free(q.ranges);
+  return err;
+}
+
+#endif /* EMBEDJSON_PARALLEL */
@@ -0,0 +1,120 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+#pragma once
+#include "common.h"
+#include "parser.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_PARALLEL
+
+/**
+ * Parses newline-delimited JSON documents (records) from data[0..size)
+ * on nthreads worker threads.
+ *
+ * Input is split into batches of about batch_size bytes (zero means
+ * 1 MiB), cut at newlines. Each worker parses whole batches with its own
+ * embedjson_parser, whose userdata is set to userdata[i] (or NULL if
+ * userdata is NULL). Empty and whitespace-only lines are skipped.
+ *
+ * Parsing callbacks, embedjson_error and embedjson_record_end are called
+ * on worker threads, concurrently for different records. Record results
+ * are delivered with embedjson_record_result on the calling thread,
+ * in input order.
+ *
+ * Returns 0 on success, non-zero value returned from
+ * embedjson_record_result, or EMBEDJSON_THREAD_ERROR if threads or memory
+ * could not be allocated.
+ *
+ * Input should be UTF-8, since records are cut at 0x0A bytes. UTF-16 and
+ * UTF-32 input is rejected with EMBEDJSON_BAD_ENCODING.
+ *
+ * @note Requires libc and POSIX threads. Worker parsers' dynamic stacks
+ * (see EMBEDJSON_DYNAMIC_STACK) are released with free().
+ */
+EMBEDJSON_STATIC int embedjson_parallel_ndjson(const char* data,
+    embedjson_size_t size, unsigned nthreads, embedjson_size_t batch_size,
+    void** userdata);
+
+/**
+ * Parses elements of a single top-level JSON array from data[0..size)
+ * on nthreads worker threads, each element is reported as a record.
+ *
+ * Input is cut into chunks of batch_size bytes (zero means 1 MiB), which
+ * are scanned in parallel to find commas that separate array elements.
+ * Whether a chunk starts inside a string is guessed from its content, and
+ * chunks with a wrong guess are re-scanned sequentially. Elements are then
+ * parsed in batches of about batch_size bytes by parsers prepared with
+ * embedjson_seed_array, so callbacks see each element as if it was
+ * a top-level value. Records passed to callbacks do not include
+ * surrounding whitespace.
+ *
+ * Input that is not a single array is parsed sequentially on the calling
+ * thread as a single record, so errors are reported as usual.
+ * Otherwise, callbacks are called as described for
+ * embedjson_parallel_ndjson, and the same values are returned.
+ *
+ * Input should be UTF-8, UTF-16 and UTF-32 input is rejected with
+ * EMBEDJSON_BAD_ENCODING.
+ */
+EMBEDJSON_STATIC int embedjson_parallel_array(const char* data,
+    embedjson_size_t size, unsigned nthreads, embedjson_size_t batch_size,
+    void** userdata);
+
+/**
+ * Validates a single JSON document data[0..size) on nthreads worker
+ * threads, reaching the same verdict as sequential parsing.
+ *
+ * Input is cut into chunks of batch_size bytes (zero means 1 MiB), which
+ * are summarized in parallel: string state at the end of the chunk, the
+ * first comma outside strings, and brackets not matched within the chunk
+ * before and after that comma. Summaries are combined in input order,
+ * re-scanning chunks whose string state was guessed wrong, to find
+ * objects and arrays that enclose each chunk's first comma. The document
+ * is then split into ranges at these commas, and each range is parsed
+ * by a worker with a parser prepared by embedjson_seed.
+ *
+ * Each range is reported as a record: embedjson_record_end on the worker,
+ * and embedjson_record_result on the calling thread in input order.
+ * Delivery stops at the first invalid range, whose error is the error of
+ * sequential parsing. Errors of later ranges may be spurious, so
+ * embedjson_error should store the error position for
+ * embedjson_record_end to return it as the record's result.
+ *
+ * Returns 0 if the document is valid, the error of the first invalid
+ * range, non-zero value returned from embedjson_record_result, or
+ * EMBEDJSON_THREAD_ERROR if threads or memory could not be allocated.
+ *
+ * @note Callbacks should not return EMBEDJSON_SKIP, EMBEDJSON_DONE, or
+ * EMBEDJSON_PAUSE, since ranges are not aware of each other
+ */
+EMBEDJSON_STATIC int embedjson_parallel_validate(const char* data,
+    embedjson_size_t size, unsigned nthreads, embedjson_size_t batch_size,
+    void** userdata);
+
+/**
+ * Called on a worker thread when a record is parsed.
+ *
+ * err is zero if the record is valid, or the error returned from
+ * embedjson_push / embedjson_finalize. Returns record's result to be passed
+ * to embedjson_record_result.
+ */
+EMBEDJSON_STATIC void* embedjson_record_end(embedjson_parser* parser,
+    const char* record, embedjson_size_t size, int err);
+
+/**
+ * Called on the calling thread for each record in input order.
+ *
+ * Non-zero return code stops parsing and is returned
+ * from embedjson_parallel_ndjson, embedjson_parallel_array, or
+ * embedjson_parallel_validate.
+ */
+EMBEDJSON_STATIC int embedjson_record_result(const char* record,
+    embedjson_size_t size, void* result);
+
+#endif /* EMBEDJSON_PARALLEL */
@@ -74,17 +74,20 @@ static unsigned char stack_empty(embedjson_parser* parser)
 
 static unsigned char stack_full(embedjson_parser* parser)
 {
-  const unsigned char max_size = 8 * sizeof(char) * EMBEDJSON_STACK_CAPACITY(parser);
+  const embedjson_size_t max_size = 8 * sizeof(char)
+    * EMBEDJSON_STACK_CAPACITY(parser);
   return parser->stack_size == max_size;
 }
 
-static int stack_push(embedjson_parser* parser, unsigned char value)
+static int stack_push(embedjson_parser* parser, unsigned char value,
+    const char* position)
 {
+  EMBEDJSON_UNUSED(position);
   if (stack_full(parser)) {
 #if EMBEDJSON_DYNAMIC_STACK
     EMBEDJSON_RETURN_IF(embedjson_stack_overflow(parser));
 #else
-    return embedjson_error_ex(parser, EMBEDJSON_STACK_OVERFLOW, 0);
+    return embedjson_error_ex(parser, EMBEDJSON_STACK_OVERFLOW, position);
 #endif /* EMBEDJSON_DYNAMIC_STACK */
   }
   embedjson_size_t nbucket = parser->stack_size / 8;
@@ -110,8 +113,463 @@ static unsigned char stack_top(embedjson_parser* parser)
   return !!(parser->stack[nbucket] & embedjson_one[nbit]);
 }
 
-EMBEDJSON_STATIC int embedjson_push(embedjson_parser* parser, const char* data, embedjson_size_t size)
+/*
+ * Sets parser's state that follows a complete value, depending on
+ * the enclosing object or array
+ */
+static void complete_value(embedjson_parser* parser)
+{
+  if (stack_empty(parser)) {
+    parser->state = PARSER_STATE_DONE;
+  } else if (stack_top(parser) == STACK_VALUE_CURLY) {
+    parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
+  } else {
+    parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
+  }
+}
+
+/*
+ * Called before each top-level value. In stream mode, starts a new
+ * document if the previous one is complete.
+ */
+static int document_begin(embedjson_parser* parser)
+{
+#if EMBEDJSON_STREAM
+  if (parser->state == PARSER_STATE_DONE) {
+    parser->state = PARSER_STATE_EXPECT_VALUE;
+  }
+  if (parser->state == PARSER_STATE_EXPECT_VALUE) {
+    int err = embedjson_document_begin(parser);
+    return err == EMBEDJSON_PAUSE ? 0 : err;
+  }
+#endif /* EMBEDJSON_STREAM */
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+/*
+ * Called when a value is complete, err is the result of the last callback.
+ * In stream mode, reports the end of the document if the value is
+ * a top-level one.
+ */
+static int document_end(embedjson_parser* parser, int err)
+{
+#if EMBEDJSON_STREAM
+  if (parser->state != PARSER_STATE_DONE
+      || (err && err != EMBEDJSON_PAUSE && err != EMBEDJSON_SKIP)) {
+    return err;
+  }
+  int end_err = embedjson_document_end(parser);
+#if EMBEDJSON_PATH_FILTER
+  /* Paths are looked for in each document anew */
+  parser->filter_found = 0;
+  parser->filter_done = 0;
+#endif /* EMBEDJSON_PATH_FILTER */
+  if (!end_err || (end_err == EMBEDJSON_PAUSE && err == EMBEDJSON_SKIP)) {
+    return err;
+  }
+  return end_err;
+#else
+  EMBEDJSON_UNUSED(parser);
+  return err;
+#endif /* EMBEDJSON_STREAM */
+}
+
+#if EMBEDJSON_PATH_FILTER
+typedef enum {
+  /* Value does not match the filter */
+  FILTER_SKIP,
+  /* Value matches the filter, all parsing events should be reported */
+  FILTER_EMIT,
+  /* Nested values may match the filter */
+  FILTER_DESCEND,
+  /* All paths are found, value should be validated without reporting events */
+  FILTER_VALIDATE
+} embedjson_filter_action;
+
+/*
+ * Returns a mask of all filter's paths
+ */
+static unsigned long filter_all(const embedjson_filter* filter)
+{
+  unsigned long mask = 0;
+  for (unsigned char i = 0; i < filter->npaths; ++i) {
+    mask |= 1ul << i;
+  }
+  return mask;
+}
+
+/*
+ * Returns paths, that may match the value that is about to begin
+ */
+static unsigned long filter_candidates(embedjson_parser* parser)
+{
+  const embedjson_filter* filter = parser->filter;
+  embedjson_size_t level = parser->stack_size;
+  if (!level) {
+    return filter_all(filter);
+  }
+  if (stack_top(parser) == STACK_VALUE_CURLY) {
+    return parser->filter_key_mask;
+  }
+  return embedjson_filter_index(filter, parser->filter_mask[level], level - 1,
+      parser->filter_index[level]);
+}
+
+/*
+ * Returns non-zero if parsing is stopped since all paths are found.
+ *
+ * In stream mode, the end of the document is not known in advance,
+ * so the rest of it is skipped instead (see filter_begin).
+ */
+static int filter_stopped(const embedjson_parser* parser)
+{
+#if EMBEDJSON_STREAM
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+#else
+  return parser->filter_done
+    && parser->filter_stop == EMBEDJSON_FILTER_STOP_TRUST;
+#endif /* EMBEDJSON_STREAM */
+}
+
+/*
+ * Decides what to do with the value that is about to begin
+ */
+static unsigned char filter_begin(embedjson_parser* parser)
+{
+  const embedjson_filter* filter = parser->filter;
+  if (!filter || parser->filter_match) {
+    return FILTER_EMIT;
+  }
+  if (parser->filter_done) {
+    return EMBEDJSON_STREAM
+      && parser->filter_stop == EMBEDJSON_FILTER_STOP_TRUST
+      ? FILTER_SKIP : FILTER_VALIDATE;
+  }
+  unsigned long mask = filter_candidates(parser);
+  for (unsigned char i = 0; i < filter->npaths; ++i) {
+    if ((mask & (1ul << i)) && filter->length[i] == parser->stack_size) {
+      parser->filter_path = i;
+      return FILTER_EMIT;
+    }
+  }
+  if (mask) {
+    parser->filter_mask[parser->stack_size + 1] = mask;
+    return FILTER_DESCEND;
+  }
+  return FILTER_SKIP;
+}
+
+/*
+ * Called when a matching string, object or array begins
+ */
+static void filter_match_begin(embedjson_parser* parser)
+{
+  if (parser->filter && !parser->filter_match) {
+    parser->filter_match = parser->stack_size + 1;
+  }
+}
+
+/*
+ * Called when a value that matches parser->filter_path is complete.
+ *
+ * Returns EMBEDJSON_DONE if parsing should be stopped.
+ */
+static int filter_found(embedjson_parser* parser)
+{
+  const embedjson_filter* filter = parser->filter;
+  parser->filter_found |= filter->exact & (1ul << parser->filter_path);
+  if (parser->filter_stop == EMBEDJSON_FILTER_STOP_NEVER
+      || parser->filter_found != filter_all(filter)) {
+    return 0;
+  }
+  parser->filter_done = 1;
+  return filter_stopped(parser) ? EMBEDJSON_DONE : 0;
+}
+
+/*
+ * Called when a string, object or array is complete
+ */
+static int filter_match_end(embedjson_parser* parser)
+{
+  if (parser->filter_match == parser->stack_size + 1) {
+    parser->filter_match = 0;
+    return filter_found(parser);
+  }
+  return 0;
+}
+
+/*
+ * Called when a primitive value is reported, err is the callback's result
+ */
+static int filter_value_end(embedjson_parser* parser, int err)
+{
+  if ((err && err != EMBEDJSON_PAUSE) || !parser->filter
+      || parser->filter_match) {
+    return err;
+  }
+  EMBEDJSON_RETURN_IF(filter_found(parser));
+  return err;
+}
+
+/* Evaluates expression (f) only if events of the current value are reported */
+#define EMBEDJSON_EMIT(parser, f) \
+  (!(parser)->filter || (parser)->filter_match ? (f) : 0)
+
+/* Evaluates expression (f) only if primitive value matches the filter */
+#define EMBEDJSON_EMIT_VALUE(parser, f) \
+  (filter_begin(parser) == FILTER_EMIT ? filter_value_end(parser, (f)) : 0)
+#else
+#define EMBEDJSON_EMIT(parser, f) (f)
+#define EMBEDJSON_EMIT_VALUE(parser, f) (f)
+#endif /* EMBEDJSON_PATH_FILTER */
+
+static int object_begin(embedjson_parser* parser, const char* position)
+{
+#if EMBEDJSON_PATH_FILTER
+  unsigned char action = filter_begin(parser);
+  if (action == FILTER_SKIP) {
+    complete_value(parser);
+    return document_end(parser, EMBEDJSON_SKIP);
+  }
+  if (action == FILTER_DESCEND || action == FILTER_VALIDATE) {
+    EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_CURLY, position));
+    parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
+    return 0;
+  }
+  filter_match_begin(parser);
+#endif /* EMBEDJSON_PATH_FILTER */
+  EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_CURLY, position));
+  int err = embedjson_object_begin(parser);
+  if (err == EMBEDJSON_SKIP) {
+    stack_pop(parser);
+    complete_value(parser);
+#if EMBEDJSON_PATH_FILTER
+    EMBEDJSON_RETURN_IF(filter_match_end(parser));
+#endif /* EMBEDJSON_PATH_FILTER */
+  } else if (!err || err == EMBEDJSON_PAUSE) {
+    parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
+  }
+  return document_end(parser, err);
+}
+
+static int array_begin(embedjson_parser* parser, const char* position)
 {
+#if EMBEDJSON_PATH_FILTER
+  unsigned char action = filter_begin(parser);
+  if (action == FILTER_SKIP) {
+    complete_value(parser);
+    return document_end(parser, EMBEDJSON_SKIP);
+  }
+  if (action == FILTER_DESCEND || action == FILTER_VALIDATE) {
+    EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_SQUARE, position));
+    if (action == FILTER_DESCEND) {
+      parser->filter_index[parser->stack_size] = 0;
+    }
+    parser->state = PARSER_STATE_MAYBE_ARRAY_VALUE;
+    return 0;
+  }
+  filter_match_begin(parser);
+#endif /* EMBEDJSON_PATH_FILTER */
+  EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_SQUARE, position));
+  int err = embedjson_array_begin(parser);
+  if (err == EMBEDJSON_SKIP) {
+    stack_pop(parser);
+    complete_value(parser);
+#if EMBEDJSON_PATH_FILTER
+    EMBEDJSON_RETURN_IF(filter_match_end(parser));
+#endif /* EMBEDJSON_PATH_FILTER */
+  } else if (!err || err == EMBEDJSON_PAUSE) {
+    parser->state = PARSER_STATE_MAYBE_ARRAY_VALUE;
+  }
+  return document_end(parser, err);
+}
+
+static int object_end(embedjson_parser* parser)
+{
+  int err = EMBEDJSON_EMIT(parser, embedjson_object_end(parser));
+  if (err && err != EMBEDJSON_PAUSE) {
+    return err;
+  }
+  stack_pop(parser);
+  complete_value(parser);
+#if EMBEDJSON_PATH_FILTER
+  EMBEDJSON_RETURN_IF(filter_match_end(parser));
+#endif /* EMBEDJSON_PATH_FILTER */
+  return document_end(parser, err);
+}
+
+static int array_end(embedjson_parser* parser)
+{
+  int err = EMBEDJSON_EMIT(parser, embedjson_array_end(parser));
+  if (err && err != EMBEDJSON_PAUSE) {
+    return err;
+  }
+  stack_pop(parser);
+  complete_value(parser);
+#if EMBEDJSON_PATH_FILTER
+  EMBEDJSON_RETURN_IF(filter_match_end(parser));
+#endif /* EMBEDJSON_PATH_FILTER */
+  return document_end(parser, err);
+}
+
+#if EMBEDJSON_UTF16_STRINGS
+/* Maximum number of code units reported per embedjson_string_chunk16 call */
+#define UTF16_CHUNK_SIZE 256
+
+/*
+ * Reports out[0..*size) and clears it. EMBEDJSON_PAUSE returned from the
+ * callback is remembered in *paused, since the rest of the converted
+ * chunk should be reported anyway.
+ */
+static int utf16_flush(embedjson_parser* parser, embedjson_char16_t* out,
+    embedjson_size_t* size, int* paused)
+{
+  int err = embedjson_string_chunk16(parser, out, *size);
+  *size = 0;
+  if (err == EMBEDJSON_PAUSE) {
+    *paused = 1;
+    return 0;
+  }
+  return err;
+}
+
+/*
+ * Converts UTF-8 string chunk into UTF-16 and reports it. A code point
+ * split between chunks is completed with the next chunk. Malformed
+ * sequences (possible only if EMBEDJSON_VALIDATE_UTF8 is disabled) are
+ * replaced with U+FFFD.
+ */
+static int utf16_chunk(embedjson_parser* parser, const char* data,
+    embedjson_size_t size)
+{
+  embedjson_char16_t out[UTF16_CHUNK_SIZE];
+  embedjson_size_t n = 0;
+  int paused = 0;
+  const unsigned char* p = (const unsigned char*) data;
+  const unsigned char* end = p + size;
+  unsigned long cp = parser->utf16_cp;
+  unsigned char need = parser->utf16_need;
+  while (p != end) {
+    if (n > UTF16_CHUNK_SIZE - 2) {
+      EMBEDJSON_RETURN_IF(utf16_flush(parser, out, &n, &paused));
+    }
+    if (!need) {
+      /* ASCII fast path, no per-byte state */
+      while (p != end && !(*p & 0x80) && n != UTF16_CHUNK_SIZE) {
+        out[n++] = *p++;
+      }
+      if (p == end || n > UTF16_CHUNK_SIZE - 2) {
+        continue;
+      }
+      if ((*p & 0xe0) == 0xc0) {
+        cp = *p & 0x1f;
+        need = 1;
+      } else if ((*p & 0xf0) == 0xe0) {
+        cp = *p & 0x0f;
+        need = 2;
+      } else if ((*p & 0xf8) == 0xf0) {
+        cp = *p & 0x07;
+        need = 3;
+      } else {
+        out[n++] = 0xfffd;
+      }
+      p++;
+      continue;
+    }
+    if ((*p & 0xc0) != 0x80) {
+      out[n++] = 0xfffd;
+      need = 0;
+      continue;
+    }
+    cp = cp << 6 | (*p++ & 0x3f);
+    if (!--need) {
+      if (cp >= 0x10000) {
+        out[n++] = (embedjson_char16_t) (0xd800 | (cp - 0x10000) >> 10);
+        out[n++] = (embedjson_char16_t) (0xdc00 | (cp & 0x3ff));
+      } else {
+        out[n++] = (embedjson_char16_t) cp;
+      }
+    }
+  }
+  parser->utf16_cp = cp;
+  parser->utf16_need = need;
+  if (n) {
+    EMBEDJSON_RETURN_IF(utf16_flush(parser, out, &n, &paused));
+  }
+  return paused ? EMBEDJSON_PAUSE : 0;
+}
+
+/* Reports a code point truncated at the end of the string as U+FFFD */
+static int utf16_end(embedjson_parser* parser)
+{
+  static const embedjson_char16_t replacement = 0xfffd;
+  if (!parser->utf16_need) {
+    return 0;
+  }
+  parser->utf16_need = 0;
+  parser->utf16_cp = 0;
+  return embedjson_string_chunk16(parser, &replacement, 1);
+}
+#endif /* EMBEDJSON_UTF16_STRINGS */
+
+/* Reports string chunk in the configured encoding */
+#if EMBEDJSON_UTF16_STRINGS
+#define STRING_CHUNK(parser, data, size) utf16_chunk((parser), (data), (size))
+#else
+#define STRING_CHUNK(parser, data, size) \
+  embedjson_string_chunk((parser), (data), (size))
+#endif /* EMBEDJSON_UTF16_STRINGS */
+
+#if EMBEDJSON_STRING_BUFFER_SIZE
+/* Reports and clears parser->string_buffer */
+static int string_buffer_flush(embedjson_parser* parser)
+{
+  embedjson_size_t size = parser->string_buffer_size;
+  if (!size) {
+    return 0;
+  }
+  parser->string_buffer_size = 0;
+  return STRING_CHUNK(parser, parser->string_buffer, size);
+}
+
+/*
+ * Copies string chunk into parser->string_buffer, so that slices of input
+ * between escape sequences and decoded escape sequences are reported
+ * with a few large chunks. Chunks larger than the buffer are reported
+ * directly.
+ */
+static int string_buffer_push(embedjson_parser* parser, const char* data,
+    embedjson_size_t size)
+{
+  int paused = 0;
+  if (size > EMBEDJSON_STRING_BUFFER_SIZE - parser->string_buffer_size) {
+    paused = string_buffer_flush(parser);
+    if (paused && paused != EMBEDJSON_PAUSE) {
+      return paused;
+    }
+    if (size >= EMBEDJSON_STRING_BUFFER_SIZE) {
+      int err = STRING_CHUNK(parser, data, size);
+      return err ? err : paused;
+    }
+  }
+  char* out = parser->string_buffer + parser->string_buffer_size;
+  for (const char* end = data + size; data != end; ++data) {
+    *out++ = *data;
+  }
+  parser->string_buffer_size += size;
+  return paused;
+}
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
+
+/*
+ * Checks performed before parsing each chunk of data
+ */
+static int push_prologue(embedjson_parser* parser, const char* data)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(data);
 #if EMBEDJSON_DEBUG
   /**
    * We can not implement this check in compile time.
@@ -123,16 +581,279 @@ EMBEDJSON_STATIC int embedjson_push(embedjson_parser* parser, const char* data,
     return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, data);
   }
 #endif /* EMBEDJSON_DEBUG */
-  return embedjson_lexer_push(&parser->lexer, data, size);
+#if EMBEDJSON_PATH_FILTER
+  if (filter_stopped(parser)) {
+    return EMBEDJSON_DONE;
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+  return 0;
+}
+
+/*
+ * Completes each push call, err is the result of parsing the chunk
+ */
+static int push_epilogue(embedjson_parser* parser, int err)
+{
+  EMBEDJSON_UNUSED(parser);
+#if EMBEDJSON_STRING_BUFFER_SIZE
+  /*
+   * Buffered chunks of an unfinished string are not kept between calls,
+   * so that checkpoints never need to hold them
+   */
+  if (!err || err == EMBEDJSON_PAUSE) {
+    int flush_err = string_buffer_flush(parser);
+    err = flush_err ? flush_err : err;
+  }
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
+  return err;
+}
+
+#if EMBEDJSON_STREAM
+/*
+ * Returned from embedjson_stream_error to stop the tokenizer,
+ * never reported to the application
+ */
+#define STREAM_RECOVER (-103)
+
+EMBEDJSON_STATIC int embedjson_stream_error(struct embedjson_parser* parser,
+    const char* position)
+{
+  parser->stream_recover = 1;
+  parser->stream_position = position;
+  return STREAM_RECOVER;
+}
+
+/*
+ * Discards the document being parsed
+ */
+static void stream_reset(embedjson_parser* parser)
+{
+  embedjson_lexer_reset(&parser->lexer);
+  parser->state = PARSER_STATE_EXPECT_VALUE;
+  parser->skip_value = 0;
+  parser->stack_size = 0;
+#if EMBEDJSON_PATH_FILTER
+  parser->filter_found = 0;
+  parser->filter_done = 0;
+  parser->filter_key = 0;
+  parser->filter_match = 0;
+#endif /* EMBEDJSON_PATH_FILTER */
+#if EMBEDJSON_UTF16_STRINGS
+  parser->utf16_cp = 0;
+  parser->utf16_need = 0;
+#endif /* EMBEDJSON_UTF16_STRINGS */
+#if EMBEDJSON_STRING_BUFFER_SIZE
+  parser->string_buffer_size = 0;
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
+  parser->stream_recover = 0;
+}
+
+/*
+ * Pushes data to the tokenizer, and skips malformed documents
+ * up to the next newline or record separator
+ */
+static int stream_push(embedjson_parser* parser, const char* data,
+    embedjson_size_t size, embedjson_size_t max_events,
+    embedjson_size_t* consumed)
+{
+  const char* begin = data;
+  const char* end = data + size;
+  for (;;) {
+    if (parser->stream_recover) {
+      data = embedjson_lexer_skip_line(&parser->lexer, data, end);
+      if (!data) {
+        return 0;
+      }
+      stream_reset(parser);
+    }
+    embedjson_size_t n = 0;
+    int err = embedjson_lexer_push_ex(&parser->lexer, data, end - data,
+        max_events, &n);
+    if (!parser->stream_recover) {
+      if (consumed) {
+        *consumed = data + n - begin;
+      }
+      return err;
+    }
+    const char* position = parser->stream_position;
+    data = data <= position && position < end ? position : end;
+  }
+}
+#endif /* EMBEDJSON_STREAM */
+
+EMBEDJSON_STATIC int embedjson_push(embedjson_parser* parser, const char* data, embedjson_size_t size)
+{
+  EMBEDJSON_RETURN_IF(push_prologue(parser, data));
+#if EMBEDJSON_STREAM
+  int err = stream_push(parser, data, size, 0, 0);
+#else
+  int err = embedjson_lexer_push(&parser->lexer, data, size);
+#endif /* EMBEDJSON_STREAM */
+  return push_epilogue(parser, err);
+}
+
+EMBEDJSON_STATIC int embedjson_pushv(embedjson_parser* parser,
+    const embedjson_iovec* iov, embedjson_size_t iovcnt)
+{
+  if (!iovcnt) {
+    return 0;
+  }
+  EMBEDJSON_RETURN_IF(push_prologue(parser, iov->iov_base));
+#if EMBEDJSON_STREAM
+  /* Malformed documents are skipped within a single segment */
+  int err = 0;
+  for (embedjson_size_t i = 0; i < iovcnt && !err; ++i) {
+    err = stream_push(parser, iov[i].iov_base, iov[i].iov_len, 0, 0);
+  }
+#else
+  int err = embedjson_lexer_pushv(&parser->lexer, iov, iovcnt);
+#endif /* EMBEDJSON_STREAM */
+  return push_epilogue(parser, err);
+}
+
+EMBEDJSON_STATIC int embedjson_push_padded(embedjson_parser* parser,
+    const char* data, embedjson_size_t size)
+{
+  EMBEDJSON_RETURN_IF(push_prologue(parser, data));
+#if EMBEDJSON_STREAM
+  int err = stream_push(parser, data, size, 0, 0);
+#else
+  int err = embedjson_lexer_push_padded(&parser->lexer, data, size);
+#endif /* EMBEDJSON_STREAM */
+  return push_epilogue(parser, err);
+}
+
+EMBEDJSON_STATIC int embedjson_parse_complete(embedjson_parser* parser,
+    const char* data, embedjson_size_t size)
+{
+  EMBEDJSON_RETURN_IF(push_prologue(parser, data));
+#if EMBEDJSON_STREAM
+  int err = stream_push(parser, data, size, 0, 0);
+#else
+  int err = embedjson_lexer_parse_complete(&parser->lexer, data, size);
+#endif /* EMBEDJSON_STREAM */
+  err = push_epilogue(parser, err);
+  return err ? err : embedjson_finalize(parser);
+}
+
+EMBEDJSON_STATIC int embedjson_push_ex(embedjson_parser* parser,
+    const char* data, embedjson_size_t size, embedjson_size_t max_events,
+    embedjson_size_t* consumed)
+{
+  if (consumed) {
+    *consumed = 0;
+  }
+  EMBEDJSON_RETURN_IF(push_prologue(parser, data));
+#if EMBEDJSON_STREAM
+  int err = stream_push(parser, data, size, max_events, consumed);
+#else
+  int err = embedjson_lexer_push_ex(&parser->lexer, data, size, max_events,
+      consumed);
+#endif /* EMBEDJSON_STREAM */
+  return push_epilogue(parser, err);
 }
 
 EMBEDJSON_STATIC int embedjson_finalize(embedjson_parser* parser)
 {
-  EMBEDJSON_RETURN_IF(embedjson_lexer_finalize(&parser->lexer));
+#if EMBEDJSON_PATH_FILTER
+  if (filter_stopped(parser)) {
+    return 0;
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+#if EMBEDJSON_STREAM
+  /*
+   * Error of the last document has already been reported.
+   * Empty stream, and whitespace after the last document are allowed.
+   */
+  int err = parser->stream_recover ? 0
+    : embedjson_lexer_finalize(&parser->lexer);
+  if ((!err || err == EMBEDJSON_PAUSE) && !parser->stream_recover
+      && parser->state != PARSER_STATE_DONE
+      && parser->state != PARSER_STATE_EXPECT_VALUE) {
+    err = embedjson_error_ex(parser, EMBEDJSON_INSUFFICIENT_INPUT, 0);
+  }
+  if (parser->stream_recover) {
+    stream_reset(parser);
+    return 0;
+  }
+  return err == EMBEDJSON_PAUSE ? 0 : err;
+#else
+  int err = embedjson_lexer_finalize(&parser->lexer);
+  if (err && err != EMBEDJSON_PAUSE) {
+    return err;
+  }
   if (parser->state != PARSER_STATE_DONE) {
     return embedjson_error_ex(parser, EMBEDJSON_INSUFFICIENT_INPUT, 0);
   }
   return 0;
+#endif /* EMBEDJSON_STREAM */
+}
+
+EMBEDJSON_STATIC int embedjson_seed(embedjson_parser* parser,
+    const char* containers, embedjson_size_t depth)
+{
+  for (embedjson_size_t i = 0; i < depth; ++i) {
+    EMBEDJSON_RETURN_IF(stack_push(parser, containers[i] == '{'
+          ? STACK_VALUE_CURLY : STACK_VALUE_SQUARE, 0));
+  }
+  if (!depth) {
+    parser->state = PARSER_STATE_EXPECT_VALUE;
+  } else if (containers[depth - 1] == '{') {
+    parser->state = PARSER_STATE_EXPECT_OBJECT_KEY;
+  } else {
+    parser->state = PARSER_STATE_EXPECT_ARRAY_VALUE;
+  }
+  return 0;
+}
+
+EMBEDJSON_STATIC int embedjson_seed_array(embedjson_parser* parser,
+    embedjson_size_t index)
+{
+#if EMBEDJSON_PATH_FILTER
+  unsigned char action = filter_begin(parser);
+  if (action == FILTER_SKIP) {
+    return EMBEDJSON_SKIP;
+  }
+  if (action == FILTER_EMIT) {
+    filter_match_begin(parser);
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+  EMBEDJSON_RETURN_IF(embedjson_seed(parser, "[", 1));
+#if EMBEDJSON_PATH_FILTER
+  if (action == FILTER_DESCEND) {
+    parser->filter_index[parser->stack_size] = index;
+    if (!filter_candidates(parser)) {
+      return EMBEDJSON_SKIP;
+    }
+  }
+#else
+  EMBEDJSON_UNUSED(index);
+#endif /* EMBEDJSON_PATH_FILTER */
+  return 0;
+}
+
+EMBEDJSON_STATIC int embedjson_finalize_element(embedjson_parser* parser)
+{
+#if EMBEDJSON_PATH_FILTER
+  if (filter_stopped(parser)) {
+    return 0;
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+#if EMBEDJSON_STREAM
+  /* Error has already been reported */
+  if (parser->stream_recover) {
+    return 0;
+  }
+#endif /* EMBEDJSON_STREAM */
+  int err = embedjson_lexer_finalize(&parser->lexer);
+  if (err && err != EMBEDJSON_PAUSE) {
+    return err;
+  }
+  if (parser->state != PARSER_STATE_MAYBE_ARRAY_COMMA
+      || parser->stack_size != 1) {
+    return embedjson_error_ex(parser, EMBEDJSON_INSUFFICIENT_INPUT, 0);
+  }
+  return 0;
 }
 
 EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
@@ -143,22 +864,17 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
    * going on below.
    */
   embedjson_parser* parser = (embedjson_parser*) lexer;
+  EMBEDJSON_RETURN_IF(document_begin(parser));
   switch (parser->state) {
     case PARSER_STATE_EXPECT_VALUE:
       switch (token) {
         case EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_CURLY));
-          EMBEDJSON_RETURN_IF(embedjson_object_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
-          break;
+          return object_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_CURLY,
               position);
         case EMBEDJSON_TOKEN_OPEN_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_SQUARE));
-          EMBEDJSON_RETURN_IF(embedjson_array_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_ARRAY_VALUE;
-          break;
+          return array_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_BRACKET,
               position);
@@ -167,17 +883,17 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
         case EMBEDJSON_TOKEN_COLON:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_COLON, position);
         case EMBEDJSON_TOKEN_TRUE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 1));
           parser->state = PARSER_STATE_DONE;
-          break;
+          return document_end(parser, EMBEDJSON_EMIT_VALUE(parser,
+                embedjson_bool(parser, 1)));
         case EMBEDJSON_TOKEN_FALSE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 0));
           parser->state = PARSER_STATE_DONE;
-          break;
+          return document_end(parser, EMBEDJSON_EMIT_VALUE(parser,
+                embedjson_bool(parser, 0)));
         case EMBEDJSON_TOKEN_NULL:
-          EMBEDJSON_RETURN_IF(embedjson_null(parser));
           parser->state = PARSER_STATE_DONE;
-          break;
+          return document_end(parser, EMBEDJSON_EMIT_VALUE(parser,
+                embedjson_null(parser)));
         default:
           return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, position);
       }
@@ -189,15 +905,7 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
           return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, position);
         }
 #endif /* EMBEDJSON_DEBUG */
-        EMBEDJSON_RETURN_IF(embedjson_object_end(parser));
-        stack_pop(parser);
-        if (stack_empty(parser)) {
-          parser->state = PARSER_STATE_DONE;
-        } else if (stack_top(parser) == STACK_VALUE_CURLY) {
-          parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-        } else {
-          parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-        }
+        return object_end(parser);
       } else {
         return embedjson_error_ex(parser, EMBEDJSON_EXP_OBJECT_KEY, position);
       }
@@ -208,6 +916,11 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
       if (token != EMBEDJSON_TOKEN_COLON) {
         return embedjson_error_ex(parser, EMBEDJSON_EXP_COLON, position);
       }
+      if (parser->skip_value) {
+        parser->skip_value = 0;
+        parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
+        return EMBEDJSON_SKIP;
+      }
       parser->state = PARSER_STATE_EXPECT_OBJECT_VALUE;
       break;
     case PARSER_STATE_MAYBE_OBJECT_COMMA:
@@ -219,15 +932,7 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
           return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, position);
         }
 #endif /* EMBEDJSON_DEBUG */
-        EMBEDJSON_RETURN_IF(embedjson_object_end(parser));
-        stack_pop(parser);
-        if (stack_empty(parser)) {
-          parser->state = PARSER_STATE_DONE;
-        } else if (stack_top(parser) == STACK_VALUE_CURLY) {
-          parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-        } else {
-          parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-        }
+        return object_end(parser);
       } else {
         return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_CURLY, position);
       }
@@ -235,17 +940,11 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
     case PARSER_STATE_EXPECT_OBJECT_VALUE:
       switch (token) {
         case EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_CURLY));
-          EMBEDJSON_RETURN_IF(embedjson_object_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
-          break;
+          return object_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_CURLY, position);
         case EMBEDJSON_TOKEN_OPEN_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_SQUARE));
-          EMBEDJSON_RETURN_IF(embedjson_array_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_ARRAY_VALUE;
-          break;
+          return array_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_BRACKET, position);
         case EMBEDJSON_TOKEN_COMMA:
@@ -253,33 +952,25 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
         case EMBEDJSON_TOKEN_COLON:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_COLON, position);
         case EMBEDJSON_TOKEN_TRUE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 1));
           parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_bool(parser, 1));
         case EMBEDJSON_TOKEN_FALSE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 0));
           parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_bool(parser, 0));
         case EMBEDJSON_TOKEN_NULL:
-          EMBEDJSON_RETURN_IF(embedjson_null(parser));
           parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_null(parser));
       }
       break;
     case PARSER_STATE_MAYBE_ARRAY_VALUE:
       switch (token) {
         case EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_CURLY));
-          EMBEDJSON_RETURN_IF(embedjson_object_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
-          break;
+          return object_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_CURLY,
               position);
         case EMBEDJSON_TOKEN_OPEN_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_SQUARE));
-          EMBEDJSON_RETURN_IF(embedjson_array_begin(parser));
-          break;
+          return array_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_BRACKET:
 #if EMBEDJSON_DEBUG
           if (stack_empty(parser) || stack_top(parser) == STACK_VALUE_CURLY) {
@@ -287,32 +978,20 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
                 position);
           }
 #endif /* EMBEDJSON_DEBUG */
-          EMBEDJSON_RETURN_IF(embedjson_array_end(parser));
-          stack_pop(parser);
-          if (stack_empty(parser)) {
-            parser->state = PARSER_STATE_DONE;
-          } else if (stack_top(parser) == STACK_VALUE_CURLY) {
-            parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
-          } else {
-            parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          }
-          break;
+          return array_end(parser);
         case EMBEDJSON_TOKEN_COMMA:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_COMMA, position);
         case EMBEDJSON_TOKEN_COLON:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_COLON, position);
         case EMBEDJSON_TOKEN_TRUE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 1));
           parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_bool(parser, 1));
         case EMBEDJSON_TOKEN_FALSE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 0));
           parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_bool(parser, 0));
         case EMBEDJSON_TOKEN_NULL:
-          EMBEDJSON_RETURN_IF(embedjson_null(parser));
           parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_null(parser));
         default:
           return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, position);
       }
@@ -320,18 +999,12 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
     case PARSER_STATE_EXPECT_ARRAY_VALUE:
       switch (token) {
         case EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_CURLY));
-          EMBEDJSON_RETURN_IF(embedjson_object_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_OBJECT_KEY;
-          break;
+          return object_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_CURLY,
               position);
         case EMBEDJSON_TOKEN_OPEN_BRACKET:
-          EMBEDJSON_RETURN_IF(stack_push(parser, STACK_VALUE_SQUARE));
-          EMBEDJSON_RETURN_IF(embedjson_array_begin(parser));
-          parser->state = PARSER_STATE_MAYBE_ARRAY_VALUE;
-          break;
+          return array_begin(parser, position);
         case EMBEDJSON_TOKEN_CLOSE_BRACKET:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_CLOSE_BRACKET,
               position);
@@ -340,17 +1013,14 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
         case EMBEDJSON_TOKEN_COLON:
           return embedjson_error_ex(parser, EMBEDJSON_UNEXP_COLON, position);
         case EMBEDJSON_TOKEN_TRUE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 1));
           parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_bool(parser, 1));
         case EMBEDJSON_TOKEN_FALSE:
-          EMBEDJSON_RETURN_IF(embedjson_bool(parser, 0));
           parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_bool(parser, 0));
         case EMBEDJSON_TOKEN_NULL:
-          EMBEDJSON_RETURN_IF(embedjson_null(parser));
           parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-          break;
+          return EMBEDJSON_EMIT_VALUE(parser, embedjson_null(parser));
         default:
           return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, position);
       }
@@ -358,21 +1028,22 @@ EMBEDJSON_STATIC int embedjson_token(embedjson_lexer* lexer,
     case PARSER_STATE_MAYBE_ARRAY_COMMA:
       if (token == EMBEDJSON_TOKEN_COMMA) {
         parser->state = PARSER_STATE_EXPECT_ARRAY_VALUE;
+#if EMBEDJSON_PATH_FILTER
+        if (parser->filter && !parser->filter_match && !parser->filter_done) {
+          parser->filter_index[parser->stack_size]++;
+          if (!filter_candidates(parser)) {
+            parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
+            return EMBEDJSON_SKIP;
+          }
+        }
+#endif /* EMBEDJSON_PATH_FILTER */
       } else if (token == EMBEDJSON_TOKEN_CLOSE_BRACKET) {
 #if EMBEDJSON_DEBUG
         if (stack_empty(parser) || stack_top(parser) != STACK_VALUE_SQUARE) {
           return embedjson_error_ex(parser, EMBEDJSON_INTERNAL_ERROR, position);
         }
 #endif /* EMBEDJSON_DEBUG */
-        EMBEDJSON_RETURN_IF(embedjson_array_end(parser));
-        stack_pop(parser);
-        if (stack_empty(parser)) {
-          parser->state = PARSER_STATE_DONE;
-        } else if (stack_top(parser) == STACK_VALUE_CURLY) {
-          parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-        } else {
-          parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-        }
+        return array_end(parser);
       } else {
         return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_BRACKET, position);
       }
@@ -393,17 +1064,32 @@ EMBEDJSON_STATIC int embedjson_tokenc(embedjson_lexer* lexer, const char* data,
 {
   embedjson_parser* parser = (embedjson_parser*) lexer;
   EMBEDJSON_CHECK_STATE(parser, data);
-  return embedjson_string_chunk(parser, data, size);
+#if EMBEDJSON_PATH_FILTER
+  if (parser->filter_key) {
+    parser->filter_key_mask = embedjson_filter_key_chunk(parser->filter,
+        parser->filter_key_mask, parser->stack_size - 1,
+        parser->filter_key_size, data, size);
+    parser->filter_key_size += size;
+    return 0;
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+#if EMBEDJSON_STRING_BUFFER_SIZE
+  return EMBEDJSON_EMIT(parser, string_buffer_push(parser, data, size));
+#else
+  return EMBEDJSON_EMIT(parser, STRING_CHUNK(parser, data, size));
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
 }
 
 EMBEDJSON_STATIC int embedjson_tokeni(embedjson_lexer* lexer, embedjson_int_t value,
     const char* position)
 {
   embedjson_parser* parser = (embedjson_parser*) lexer;
+  EMBEDJSON_RETURN_IF(document_begin(parser));
   switch (parser->state) {
     case PARSER_STATE_EXPECT_VALUE:
       parser->state = PARSER_STATE_DONE;
-      return embedjson_int(parser, value);
+      return document_end(parser, EMBEDJSON_EMIT_VALUE(parser,
+            embedjson_int(parser, value)));
     case PARSER_STATE_MAYBE_OBJECT_KEY:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_OBJECT_KEY_OR_CLOSE_CURLY, position);
     case PARSER_STATE_EXPECT_OBJECT_KEY:
@@ -414,11 +1100,11 @@ EMBEDJSON_STATIC int embedjson_tokeni(embedjson_lexer* lexer, embedjson_int_t va
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_BRACKET, position);
     case PARSER_STATE_EXPECT_OBJECT_VALUE:
       parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-      return embedjson_int(parser, value);
+      return EMBEDJSON_EMIT_VALUE(parser, embedjson_int(parser, value));
     case PARSER_STATE_MAYBE_ARRAY_VALUE:
     case PARSER_STATE_EXPECT_ARRAY_VALUE:
       parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-      return embedjson_int(parser, value);
+      return EMBEDJSON_EMIT_VALUE(parser, embedjson_int(parser, value));
     case PARSER_STATE_MAYBE_ARRAY_COMMA:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_CURLY, position);
     case PARSER_STATE_DONE:
@@ -436,10 +1122,12 @@ EMBEDJSON_STATIC int embedjson_tokenf(embedjson_lexer* lexer, double value,
     const char* position)
 {
   embedjson_parser* parser = (embedjson_parser*) lexer;
+  EMBEDJSON_RETURN_IF(document_begin(parser));
   switch (parser->state) {
     case PARSER_STATE_EXPECT_VALUE:
       parser->state = PARSER_STATE_DONE;
-      return embedjson_double(parser, value);
+      return document_end(parser, EMBEDJSON_EMIT_VALUE(parser,
+            embedjson_double(parser, value)));
     case PARSER_STATE_MAYBE_OBJECT_KEY:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_OBJECT_KEY_OR_CLOSE_CURLY, position);
     case PARSER_STATE_EXPECT_OBJECT_KEY:
@@ -450,11 +1138,11 @@ EMBEDJSON_STATIC int embedjson_tokenf(embedjson_lexer* lexer, double value,
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_BRACKET, position);
     case PARSER_STATE_EXPECT_OBJECT_VALUE:
       parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-      return embedjson_double(parser, value);
+      return EMBEDJSON_EMIT_VALUE(parser, embedjson_double(parser, value));
     case PARSER_STATE_MAYBE_ARRAY_VALUE:
     case PARSER_STATE_EXPECT_ARRAY_VALUE:
       parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-      return embedjson_double(parser, value);
+      return EMBEDJSON_EMIT_VALUE(parser, embedjson_double(parser, value));
     case PARSER_STATE_MAYBE_ARRAY_COMMA:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_CURLY, position);
     case PARSER_STATE_DONE:
@@ -472,18 +1160,35 @@ EMBEDJSON_STATIC int embedjson_tokenc_begin(embedjson_lexer* lexer,
     const char* position)
 {
   embedjson_parser* parser = (embedjson_parser*) lexer;
+  EMBEDJSON_RETURN_IF(document_begin(parser));
   switch (parser->state) {
-    case PARSER_STATE_EXPECT_VALUE:
     case PARSER_STATE_MAYBE_OBJECT_KEY:
     case PARSER_STATE_EXPECT_OBJECT_KEY:
+#if EMBEDJSON_PATH_FILTER
+      if (parser->filter && !parser->filter_match) {
+        if (!parser->filter_done) {
+          parser->filter_key = 1;
+          parser->filter_key_mask = parser->filter_mask[parser->stack_size];
+          parser->filter_key_size = 0;
+        }
+        return 0;
+      }
+#endif /* EMBEDJSON_PATH_FILTER */
       return embedjson_string_begin(parser);
     case PARSER_STATE_EXPECT_COLON:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COLON, position);
     case PARSER_STATE_MAYBE_OBJECT_COMMA:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_CURLY, position);
+    case PARSER_STATE_EXPECT_VALUE:
     case PARSER_STATE_EXPECT_OBJECT_VALUE:
     case PARSER_STATE_MAYBE_ARRAY_VALUE:
     case PARSER_STATE_EXPECT_ARRAY_VALUE:
+#if EMBEDJSON_PATH_FILTER
+      if (filter_begin(parser) != FILTER_EMIT) {
+        return 0;
+      }
+      filter_match_begin(parser);
+#endif /* EMBEDJSON_PATH_FILTER */
       return embedjson_string_begin(parser);
     case PARSER_STATE_MAYBE_ARRAY_COMMA:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_BRACKET, position);
@@ -518,18 +1223,68 @@ EMBEDJSON_STATIC int embedjson_tokenc_end(embedjson_lexer* lexer,
   EMBEDJSON_CHECK_STATE(parser, position);
   parser->state = next_state[parser->state];
   EMBEDJSON_CHECK_STATE(parser, position);
-  return embedjson_string_end(parser);
+#if EMBEDJSON_PATH_FILTER
+  if (parser->filter_key) {
+    parser->filter_key = 0;
+    parser->filter_key_mask = embedjson_filter_key_end(parser->filter,
+        parser->filter_key_mask, parser->stack_size - 1,
+        parser->filter_key_size);
+    parser->skip_value = !parser->filter_key_mask;
+    return 0;
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+  int paused = 0;
+#if EMBEDJSON_STRING_BUFFER_SIZE
+  paused = EMBEDJSON_EMIT(parser, string_buffer_flush(parser));
+  if (paused && paused != EMBEDJSON_PAUSE) {
+    return paused;
+  }
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
+#if EMBEDJSON_UTF16_STRINGS
+  int tail = EMBEDJSON_EMIT(parser, utf16_end(parser));
+  if (tail && tail != EMBEDJSON_PAUSE) {
+    return tail;
+  }
+  paused = paused ? paused : tail;
+#endif /* EMBEDJSON_UTF16_STRINGS */
+  int err = EMBEDJSON_EMIT(parser, embedjson_string_end(parser));
+  if (!err) {
+    err = paused;
+  }
+  if (err == EMBEDJSON_SKIP) {
+    /* Only a value that follows an object key can be skipped */
+    parser->skip_value = parser->state == PARSER_STATE_EXPECT_COLON;
+    err = 0;
+  }
+#if EMBEDJSON_PATH_FILTER
+  if (!err || err == EMBEDJSON_PAUSE) {
+    EMBEDJSON_RETURN_IF(filter_match_end(parser));
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+  return document_end(parser, err);
 }
 
 #if EMBEDJSON_BIGNUM
+static int bignum_begin(embedjson_parser* parser, embedjson_int_t initial_value)
+{
+#if EMBEDJSON_PATH_FILTER
+  if (filter_begin(parser) != FILTER_EMIT) {
+    return 0;
+  }
+  filter_match_begin(parser);
+#endif /* EMBEDJSON_PATH_FILTER */
+  return embedjson_bignum_begin(parser, initial_value);
+}
+
 EMBEDJSON_STATIC int embedjson_tokenbn_begin(embedjson_lexer* lexer,
     const char* position, embedjson_int_t initial_value)
 {
   embedjson_parser* parser = (embedjson_parser*) lexer;
+  EMBEDJSON_RETURN_IF(document_begin(parser));
   switch (parser->state) {
     case PARSER_STATE_EXPECT_VALUE:
       parser->state = PARSER_STATE_DONE;
-      return embedjson_bignum_begin(parser, initial_value);
+      return bignum_begin(parser, initial_value);
     case PARSER_STATE_MAYBE_OBJECT_KEY:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_OBJECT_KEY_OR_CLOSE_CURLY, position);
     case PARSER_STATE_EXPECT_OBJECT_KEY:
@@ -540,11 +1295,11 @@ EMBEDJSON_STATIC int embedjson_tokenbn_begin(embedjson_lexer* lexer,
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_BRACKET, position);
     case PARSER_STATE_EXPECT_OBJECT_VALUE:
       parser->state = PARSER_STATE_MAYBE_OBJECT_COMMA;
-      return embedjson_bignum_begin(parser, initial_value);
+      return bignum_begin(parser, initial_value);
     case PARSER_STATE_MAYBE_ARRAY_VALUE:
     case PARSER_STATE_EXPECT_ARRAY_VALUE:
       parser->state = PARSER_STATE_MAYBE_ARRAY_COMMA;
-      return embedjson_bignum_begin(parser, initial_value);
+      return bignum_begin(parser, initial_value);
     case PARSER_STATE_MAYBE_ARRAY_COMMA:
       return embedjson_error_ex(parser, EMBEDJSON_EXP_COMMA_OR_CLOSE_CURLY, position);
     case PARSER_STATE_DONE:
@@ -563,7 +1318,7 @@ EMBEDJSON_STATIC int embedjson_tokenbn(embedjson_lexer* lexer, const char* data,
 {
   embedjson_parser* parser = (embedjson_parser*) lexer;
   EMBEDJSON_CHECK_STATE(parser, data);
-  return embedjson_bignum_chunk(parser, data, size);
+  return EMBEDJSON_EMIT(parser, embedjson_bignum_chunk(parser, data, size));
 }
 
 EMBEDJSON_STATIC int embedjson_tokenbn_end(embedjson_lexer* lexer,
@@ -586,6 +1341,355 @@ EMBEDJSON_STATIC int embedjson_tokenbn_end(embedjson_lexer* lexer,
   EMBEDJSON_CHECK_STATE(parser, position);
   parser->state = next_state[parser->state];
   EMBEDJSON_CHECK_STATE(parser, position);
-  return embedjson_bignum_end(parser);
+  int err = EMBEDJSON_EMIT(parser, embedjson_bignum_end(parser));
+  if (err && err != EMBEDJSON_PAUSE) {
+    return err;
+  }
+#if EMBEDJSON_PATH_FILTER
+  EMBEDJSON_RETURN_IF(filter_match_end(parser));
+#endif /* EMBEDJSON_PATH_FILTER */
+  return err;
 }
 #endif /* EMBEDJSON_BIGNUM */
+
+/*
+ * Checkpoint layout (see EMBEDJSON_CHECKPOINT_VERSION):
+ * @li header: layout version, configuration flags, sizeof(embedjson_int_t);
+ * @li lexer state;
+ * @li parser state and stack, stream recovery flag if EMBEDJSON_STREAM
+ * is enabled, UTF-16 conversion state if EMBEDJSON_UTF16_STRINGS
+ * is enabled;
+ * @li path filter state, if EMBEDJSON_PATH_FILTER is enabled.
+ *
+ * Integers are stored as LEB128 variable-length numbers.
+ */
+#if EMBEDJSON_VALIDATE_UTF8
+#define CHECKPOINT_VALIDATE_UTF8 0x01
+#else
+#define CHECKPOINT_VALIDATE_UTF8 0
+#endif /* EMBEDJSON_VALIDATE_UTF8 */
+#if EMBEDJSON_BIGNUM
+#define CHECKPOINT_BIGNUM 0x02
+#else
+#define CHECKPOINT_BIGNUM 0
+#endif /* EMBEDJSON_BIGNUM */
+#if EMBEDJSON_PATH_FILTER
+#define CHECKPOINT_PATH_FILTER 0x04
+#else
+#define CHECKPOINT_PATH_FILTER 0
+#endif /* EMBEDJSON_PATH_FILTER */
+#if EMBEDJSON_STREAM
+#define CHECKPOINT_STREAM 0x08
+#else
+#define CHECKPOINT_STREAM 0
+#endif /* EMBEDJSON_STREAM */
+#if EMBEDJSON_TRANSCODE
+#define CHECKPOINT_TRANSCODE 0x10
+#else
+#define CHECKPOINT_TRANSCODE 0
+#endif /* EMBEDJSON_TRANSCODE */
+#if EMBEDJSON_UTF16_STRINGS
+#define CHECKPOINT_UTF16_STRINGS 0x20
+#else
+#define CHECKPOINT_UTF16_STRINGS 0
+#endif /* EMBEDJSON_UTF16_STRINGS */
+
+/* Configuration options that affect checkpoint layout */
+#define CHECKPOINT_CONFIG \
+  (CHECKPOINT_VALIDATE_UTF8 | CHECKPOINT_BIGNUM | CHECKPOINT_PATH_FILTER \
+   | CHECKPOINT_STREAM | CHECKPOINT_TRANSCODE | CHECKPOINT_UTF16_STRINGS)
+
+typedef struct {
+  /* Output buffer, or NULL if only checkpoint size is computed */
+  char* data;
+  embedjson_size_t capacity;
+  embedjson_size_t size;
+} checkpoint_writer;
+
+typedef struct {
+  const char* data;
+  const char* end;
+  /* Set if checkpoint is truncated or malformed */
+  unsigned char bad;
+} checkpoint_reader;
+
+static void put_byte(checkpoint_writer* w, unsigned char value)
+{
+  if (w->data && w->size < w->capacity) {
+    w->data[w->size] = (char) value;
+  }
+  w->size++;
+}
+
+static void put_varint(checkpoint_writer* w, unsigned long long value)
+{
+  for (; value >= 0x80; value >>= 7) {
+    put_byte(w, (unsigned char) (value & 0x7f) | 0x80);
+  }
+  put_byte(w, (unsigned char) value);
+}
+
+static void put_int(checkpoint_writer* w, embedjson_int_t value)
+{
+  put_byte(w, value < 0);
+  if (value < 0) {
+    value = 0 - value;
+  }
+  for (; value >= 0x80; value >>= 7) {
+    put_byte(w, (unsigned char) (value & 0x7f) | 0x80);
+  }
+  put_byte(w, (unsigned char) value);
+}
+
+static unsigned char get_byte(checkpoint_reader* r)
+{
+  if (r->data == r->end) {
+    r->bad = 1;
+    return 0;
+  }
+  return (unsigned char) *r->data++;
+}
+
+static unsigned long long get_varint(checkpoint_reader* r)
+{
+  unsigned long long value = 0;
+  unsigned char byte;
+  unsigned shift = 0;
+  do {
+    byte = get_byte(r);
+    if (shift >= 8 * sizeof(value)) {
+      r->bad = 1;
+      return 0;
+    }
+    value |= (unsigned long long) (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+static embedjson_int_t get_int(checkpoint_reader* r)
+{
+  embedjson_int_t value = 0;
+  unsigned char byte;
+  unsigned shift = 0;
+  unsigned char minus = get_byte(r);
+  do {
+    byte = get_byte(r);
+    if (shift > 8 * sizeof(value) - 8) {
+      r->bad = 1;
+      return 0;
+    }
+    value |= (embedjson_int_t) (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return minus ? 0 - value : value;
+}
+
+static void checkpoint_write(const embedjson_parser* parser,
+    checkpoint_writer* w)
+{
+  const embedjson_lexer* lexer = &parser->lexer;
+  put_byte(w, EMBEDJSON_CHECKPOINT_VERSION);
+  put_byte(w, CHECKPOINT_CONFIG);
+  put_byte(w, sizeof(embedjson_int_t));
+
+  put_byte(w, lexer->state);
+  put_byte(w, lexer->offset);
+  put_byte(w, lexer->unicode_cp[0]);
+  put_byte(w, lexer->unicode_cp[1]);
+  put_varint(w, lexer->unicode_high);
+  put_byte(w, lexer->encoding);
+  put_byte(w, lexer->magic_bytes_read);
+  put_byte(w, (lexer->minus ? 0x01 : 0)
+      | (lexer->exp_minus ? 0x02 : 0)
+      | (lexer->exp_not_empty ? 0x04 : 0)
+      | (lexer->skip_in_string ? 0x08 : 0)
+      | (lexer->skip_escape ? 0x10 : 0)
+      | (lexer->skip_primitive ? 0x20 : 0)
+      | (lexer->skip_expect_value ? 0x40 : 0));
+  for (int i = 0; i < 4; ++i) {
+    put_byte(w, lexer->magic.as_char[i]);
+  }
+  put_int(w, lexer->int_value);
+  put_varint(w, lexer->frac_value);
+  put_varint(w, lexer->frac_power);
+  put_varint(w, lexer->exp_value);
+  put_varint(w, lexer->skip_depth);
+#if EMBEDJSON_VALIDATE_UTF8
+  put_byte(w, lexer->nb);
+  put_byte(w, lexer->cc);
+#endif /* EMBEDJSON_VALIDATE_UTF8 */
+#if EMBEDJSON_TRANSCODE
+  put_byte(w, lexer->unit_size);
+  for (unsigned char i = 0; i < lexer->unit_size; ++i) {
+    put_byte(w, lexer->unit[i]);
+  }
+#endif /* EMBEDJSON_TRANSCODE */
+
+  put_byte(w, parser->state);
+  put_byte(w, parser->skip_value);
+#if EMBEDJSON_STREAM
+  put_byte(w, parser->stream_recover);
+#endif /* EMBEDJSON_STREAM */
+#if EMBEDJSON_UTF16_STRINGS
+  put_varint(w, parser->utf16_cp);
+  put_byte(w, parser->utf16_need);
+#endif /* EMBEDJSON_UTF16_STRINGS */
+  put_varint(w, parser->stack_size);
+  for (embedjson_size_t i = 0; i < (parser->stack_size + 7) / 8; ++i) {
+    put_byte(w, parser->stack[i]);
+  }
+
+#if EMBEDJSON_PATH_FILTER
+  put_byte(w, parser->filter_path);
+  put_byte(w, parser->filter_stop);
+  put_byte(w, parser->filter_done);
+  put_byte(w, parser->filter_key);
+  put_varint(w, parser->filter_match);
+  put_varint(w, parser->filter_key_mask);
+  put_varint(w, parser->filter_key_size);
+  put_varint(w, parser->filter_found);
+  embedjson_size_t nlevels = parser->stack_size < EMBEDJSON_FILTER_MAX_DEPTH
+    ? parser->stack_size + 1 : EMBEDJSON_FILTER_MAX_DEPTH + 1;
+  put_varint(w, nlevels);
+  for (embedjson_size_t i = 0; i < nlevels; ++i) {
+    put_varint(w, parser->filter_mask[i]);
+    put_varint(w, parser->filter_index[i]);
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+}
+
+EMBEDJSON_STATIC embedjson_size_t embedjson_checkpoint_size(
+    const embedjson_parser* parser)
+{
+  checkpoint_writer w = {0, 0, 0};
+  checkpoint_write(parser, &w);
+  return w.size;
+}
+
+EMBEDJSON_STATIC embedjson_error_code embedjson_checkpoint(
+    const embedjson_parser* parser, char* data, embedjson_size_t size,
+    embedjson_size_t* written)
+{
+  checkpoint_writer w = {data, size, 0};
+  checkpoint_write(parser, &w);
+  if (w.size > size) {
+    return EMBEDJSON_CHECKPOINT_OVERFLOW;
+  }
+  if (written) {
+    *written = w.size;
+  }
+  return EMBEDJSON_OK;
+}
+
+EMBEDJSON_STATIC embedjson_error_code embedjson_restore(
+    embedjson_parser* parser, const char* data, embedjson_size_t size)
+{
+  checkpoint_reader r = {data, data + size, 0};
+  embedjson_parser p = *parser;
+  embedjson_lexer* lexer = &p.lexer;
+  if (get_byte(&r) != EMBEDJSON_CHECKPOINT_VERSION
+      || get_byte(&r) != CHECKPOINT_CONFIG
+      || get_byte(&r) != sizeof(embedjson_int_t)) {
+    return EMBEDJSON_BAD_CHECKPOINT;
+  }
+
+  lexer->state = get_byte(&r);
+  lexer->offset = get_byte(&r);
+  lexer->unicode_cp[0] = (char) get_byte(&r);
+  lexer->unicode_cp[1] = (char) get_byte(&r);
+  lexer->unicode_high = (unsigned short) get_varint(&r);
+  lexer->encoding = get_byte(&r);
+  lexer->magic_bytes_read = get_byte(&r);
+  unsigned char flags = get_byte(&r);
+  lexer->minus = flags & 0x01 ? ~0 : 0;
+  lexer->exp_minus = flags & 0x02 ? ~0 : 0;
+  lexer->exp_not_empty = flags & 0x04 ? ~0 : 0;
+  lexer->skip_in_string = !!(flags & 0x08);
+  lexer->skip_escape = !!(flags & 0x10);
+  lexer->skip_primitive = !!(flags & 0x20);
+  lexer->skip_expect_value = !!(flags & 0x40);
+  for (int i = 0; i < 4; ++i) {
+    lexer->magic.as_char[i] = (char) get_byte(&r);
+  }
+  lexer->int_value = get_int(&r);
+  lexer->frac_value = get_varint(&r);
+  lexer->frac_power = (unsigned short) get_varint(&r);
+  lexer->exp_value = (unsigned short) get_varint(&r);
+  lexer->skip_depth = get_varint(&r);
+#if EMBEDJSON_VALIDATE_UTF8
+  lexer->nb = get_byte(&r);
+  lexer->cc = get_byte(&r);
+#endif /* EMBEDJSON_VALIDATE_UTF8 */
+#if EMBEDJSON_TRANSCODE
+  lexer->unit_size = get_byte(&r);
+  if (lexer->unit_size > sizeof(lexer->unit)) {
+    return EMBEDJSON_BAD_CHECKPOINT;
+  }
+  for (unsigned char i = 0; i < lexer->unit_size; ++i) {
+    lexer->unit[i] = get_byte(&r);
+  }
+#endif /* EMBEDJSON_TRANSCODE */
+
+  p.state = get_byte(&r);
+  p.skip_value = get_byte(&r);
+#if EMBEDJSON_STREAM
+  p.stream_recover = get_byte(&r);
+#endif /* EMBEDJSON_STREAM */
+#if EMBEDJSON_UTF16_STRINGS
+  p.utf16_cp = get_varint(&r);
+  p.utf16_need = get_byte(&r);
+  if (p.utf16_need > 3) {
+    return EMBEDJSON_BAD_CHECKPOINT;
+  }
+#endif /* EMBEDJSON_UTF16_STRINGS */
+  p.stack_size = get_varint(&r);
+  const char* stack = r.data;
+  embedjson_size_t nbytes = (p.stack_size + 7) / 8;
+  if (r.bad || p.state >= PARSER_STATE_INVALID
+      || nbytes > (embedjson_size_t) (r.end - r.data)) {
+    return EMBEDJSON_BAD_CHECKPOINT;
+  }
+  r.data += nbytes;
+
+#if EMBEDJSON_PATH_FILTER
+  p.filter_path = get_byte(&r);
+  p.filter_stop = get_byte(&r);
+  p.filter_done = get_byte(&r);
+  p.filter_key = get_byte(&r);
+  p.filter_match = get_varint(&r);
+  p.filter_key_mask = get_varint(&r);
+  p.filter_key_size = get_varint(&r);
+  p.filter_found = get_varint(&r);
+  embedjson_size_t nlevels = get_varint(&r);
+  if (nlevels > EMBEDJSON_FILTER_MAX_DEPTH + 1) {
+    return EMBEDJSON_BAD_CHECKPOINT;
+  }
+  for (embedjson_size_t i = 0; i < nlevels; ++i) {
+    p.filter_mask[i] = get_varint(&r);
+    p.filter_index[i] = get_varint(&r);
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+
+  if (r.bad || r.data != r.end) {
+    return EMBEDJSON_BAD_CHECKPOINT;
+  }
+  while (8 * EMBEDJSON_STACK_CAPACITY(parser) < p.stack_size) {
+#if EMBEDJSON_DYNAMIC_STACK
+    embedjson_size_t capacity = parser->stack_capacity;
+    if (embedjson_stack_overflow(parser)
+        || parser->stack_capacity <= capacity) {
+      return EMBEDJSON_STACK_OVERFLOW;
+    }
+    p.stack = parser->stack;
+    p.stack_capacity = parser->stack_capacity;
+#else
+    return EMBEDJSON_STACK_OVERFLOW;
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  }
+  for (embedjson_size_t i = 0; i < nbytes; ++i) {
+    p.stack[i] = stack[i];
+  }
+  *parser = p;
+  return EMBEDJSON_OK;
+}
@@ -9,6 +9,7 @@
 #pragma once
 #include "common.h"
 #include "lexer.h"
+#include "filter.h"
 #endif /* EMBEDJSON_AMALGAMATE */
 
 
@@ -19,6 +20,11 @@ typedef struct embedjson_parser {
    */
   embedjson_lexer lexer;
   unsigned char state;
+  /**
+   * Set if the value of the current object key should be skipped,
+   * see EMBEDJSON_SKIP
+   */
+  unsigned char skip_value;
   embedjson_size_t stack_size;
 #if EMBEDJSON_DYNAMIC_STACK
   char* stack;
@@ -26,6 +32,82 @@ typedef struct embedjson_parser {
 #else
   char stack[EMBEDJSON_STATIC_STACK_SIZE];
 #endif
+#if EMBEDJSON_PATH_FILTER
+  /**
+   * JSON paths to report parsing events for, or NULL to report all events.
+   *
+   * @see embedjson_filter
+   */
+  const embedjson_filter* filter;
+  /**
+   * Index of the filter's path that matches value being reported.
+   *
+   * If several paths match the value, the one that was added first
+   * is reported.
+   */
+  unsigned char filter_path;
+  /**
+   * What to do when each path of the filter has matched a value,
+   * one of embedjson_filter_stop values.
+   *
+   * Paths with wildcards can match an unknown number of values, so
+   * parsing is never stopped if the filter contains such paths.
+   *
+   * In stream mode, EMBEDJSON_FILTER_STOP_TRUST skips the rest of
+   * the document instead of stopping, and paths are looked for again
+   * in the next document.
+   */
+  unsigned char filter_stop;
+  /**
+   * Set when all paths of the filter are found and filter_stop
+   * is not EMBEDJSON_FILTER_STOP_NEVER. In stream mode, cleared
+   * after each document.
+   */
+  unsigned char filter_done;
+  /* Paths that have already matched a value */
+  unsigned long filter_found;
+  /* Set if an object key is being matched against the filter */
+  unsigned char filter_key;
+  /*
+   * Stack size at the beginning of the matching string, object or array
+   * plus one, or zero if no value matches the filter
+   */
+  embedjson_size_t filter_match;
+  /* Paths that match object key being parsed */
+  unsigned long filter_key_mask;
+  /* Number of bytes in the object key being parsed */
+  embedjson_size_t filter_key_size;
+  /* Paths that match enclosing objects and arrays, by stack size */
+  unsigned long filter_mask[EMBEDJSON_FILTER_MAX_DEPTH + 1];
+  /* Current element index of enclosing arrays, by stack size */
+  embedjson_size_t filter_index[EMBEDJSON_FILTER_MAX_DEPTH + 1];
+#endif /* EMBEDJSON_PATH_FILTER */
+#if EMBEDJSON_STREAM
+  /*
+   * Set if the current document is malformed, and input is discarded
+   * up to the next newline or record separator
+   */
+  unsigned char stream_recover;
+  /* Position of the error that started recovery */
+  const char* stream_position;
+#endif /* EMBEDJSON_STREAM */
+#if EMBEDJSON_UTF16_STRINGS
+  /*
+   * UTF-8 to UTF-16 conversion state of the string being reported:
+   * bits of the code point being decoded and number of its continuation
+   * bytes yet to come
+   */
+  unsigned long utf16_cp;
+  unsigned char utf16_need;
+#endif /* EMBEDJSON_UTF16_STRINGS */
+#if EMBEDJSON_STRING_BUFFER_SIZE
+  /*
+   * String chunks copied to be reported at once, flushed at the end
+   * of each string and each embedjson_push call
+   */
+  char string_buffer[EMBEDJSON_STRING_BUFFER_SIZE];
+  embedjson_size_t string_buffer_size;
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
   /* Space for user-defined data, embedjson does not use this field */
   void* userdata;
 } embedjson_parser;
@@ -33,21 +115,143 @@ typedef struct embedjson_parser {
 EMBEDJSON_STATIC int embedjson_push(embedjson_parser* parser, const char* data,
     embedjson_size_t size);
 
+/**
+ * Same as embedjson_push, but with a bounded amount of work.
+ *
+ * Parsing is paused when a callback returns EMBEDJSON_PAUSE, or when
+ * max_events parsing events are reported (zero means no limit). In this
+ * case EMBEDJSON_PAUSE is returned, and the caller should push the remaining
+ * data[*consumed..size) later. To limit the number of bytes parsed per call,
+ * just provide a smaller size.
+ *
+ * @note Events are counted at the tokenizer level, so object keys and values
+ * hidden by embedjson_parser.filter are counted too
+ */
+EMBEDJSON_STATIC int embedjson_push_ex(embedjson_parser* parser,
+    const char* data, embedjson_size_t size, embedjson_size_t max_events,
+    embedjson_size_t* consumed);
+
+/**
+ * Pushes iovcnt segments of input at once, e.g. buffers of a ring or
+ * a scatter list received from the network.
+ *
+ * Events and errors are the same as of embedjson_push called for each
+ * segment in turn, but the lexer state is kept in local variables across
+ * segment boundaries, and per-call checks are performed only once.
+ */
+EMBEDJSON_STATIC int embedjson_pushv(embedjson_parser* parser,
+    const embedjson_iovec* iov, embedjson_size_t iovcnt);
+
+/**
+ * Same as embedjson_push, but the caller guarantees that EMBEDJSON_PADDING
+ * bytes after data + size are readable (their values do not matter).
+ *
+ * Whitespace, strings, numbers and keywords are then scanned a word
+ * at a time, without checking for the end of data before each load.
+ * Events and errors are the same as of embedjson_push.
+ *
+ * @note In stream mode, and for UTF-16/32 input, data is parsed
+ * as with embedjson_push
+ */
+EMBEDJSON_STATIC int embedjson_push_padded(embedjson_parser* parser,
+    const char* data, embedjson_size_t size);
+
+/**
+ * Parses a complete document, e.g. a message received at once.
+ *
+ * Returns the same value as embedjson_push followed by embedjson_finalize
+ * (unless embedjson_push fails), with the same events and errors. Since
+ * no token can continue in the next call, numbers, keywords and strings
+ * are lexed to the end with a simple look-ahead, and the lexer state is
+ * not saved after each byte.
+ *
+ * Parsing stops right after a callback returns EMBEDJSON_PAUSE, and can not
+ * be resumed.
+ *
+ * @note In stream mode, for UTF-16/32 input, and if some data has already
+ * been pushed to the parser, data is parsed as with embedjson_push
+ */
+EMBEDJSON_STATIC int embedjson_parse_complete(embedjson_parser* parser,
+    const char* data, embedjson_size_t size);
+
 EMBEDJSON_STATIC int embedjson_finalize(embedjson_parser* parser);
 
+/**
+ * Prepares a zero-initialized parser to continue parsing right after
+ * a comma, nested into depth objects and arrays.
+ *
+ * containers[i] is '{' or '[' for the i-th enclosing object or array,
+ * starting from the outermost one. Used to validate parts of a large
+ * document independently, see embedjson_parallel_validate.
+ *
+ * @note embedjson_parser.filter is not supported and should be NULL
+ */
+EMBEDJSON_STATIC int embedjson_seed(embedjson_parser* parser,
+    const char* containers, embedjson_size_t depth);
+
+/**
+ * Prepares a zero-initialized parser to parse an element of a top-level
+ * array, as if the opening bracket and index preceding elements were
+ * already pushed.
+ *
+ * Used to parse elements of a large array independently, see
+ * embedjson_parallel_array. Array begin and end events are not reported,
+ * so each element is reported as if it was a top-level value.
+ *
+ * Returns EMBEDJSON_SKIP if the element does not match
+ * embedjson_parser.filter, i.e. the element should not be parsed at all.
+ */
+EMBEDJSON_STATIC int embedjson_seed_array(embedjson_parser* parser,
+    embedjson_size_t index);
+
+/**
+ * Same as embedjson_finalize, for the parser prepared with
+ * embedjson_seed_array.
+ *
+ * Fails with EMBEDJSON_INSUFFICIENT_INPUT unless a complete element
+ * has been pushed.
+ */
+EMBEDJSON_STATIC int embedjson_finalize_element(embedjson_parser* parser);
+
 EMBEDJSON_STATIC int embedjson_null(embedjson_parser* parser);
 EMBEDJSON_STATIC int embedjson_bool(embedjson_parser* parser, char value);
 EMBEDJSON_STATIC int embedjson_int(embedjson_parser* parser, embedjson_int_t value);
 EMBEDJSON_STATIC int embedjson_double(embedjson_parser* parser, double value);
 EMBEDJSON_STATIC int embedjson_string_begin(embedjson_parser* parser);
+#if EMBEDJSON_UTF16_STRINGS
+/**
+ * Called instead of embedjson_string_chunk with size UTF-16 code units
+ * of the string value. Surrogate pairs are never split between chunks.
+ */
+EMBEDJSON_STATIC int embedjson_string_chunk16(embedjson_parser* parser,
+    const embedjson_char16_t* data, embedjson_size_t size);
+#else
 EMBEDJSON_STATIC int embedjson_string_chunk(embedjson_parser* parser,
     const char* data, embedjson_size_t size);
+#endif /* EMBEDJSON_UTF16_STRINGS */
 EMBEDJSON_STATIC int embedjson_string_end(embedjson_parser* parser);
 EMBEDJSON_STATIC int embedjson_object_begin(embedjson_parser* parser);
 EMBEDJSON_STATIC int embedjson_object_end(embedjson_parser* parser);
 EMBEDJSON_STATIC int embedjson_array_begin(embedjson_parser* parser);
 EMBEDJSON_STATIC int embedjson_array_end(embedjson_parser* parser);
 
+#if EMBEDJSON_STREAM
+/**
+ * Called before the first event of each top-level value in the stream.
+ *
+ * Non-zero return code aborts parsing, EMBEDJSON_PAUSE is ignored.
+ */
+EMBEDJSON_STATIC int embedjson_document_begin(embedjson_parser* parser);
+
+/**
+ * Called after the last event of each top-level value in the stream.
+ *
+ * Return EMBEDJSON_PAUSE to process documents one by one
+ * with embedjson_push_ex.
+ */
+EMBEDJSON_STATIC int embedjson_document_end(embedjson_parser* parser);
+#endif /* EMBEDJSON_STREAM */
+
 #if EMBEDJSON_BIGNUM
 EMBEDJSON_STATIC int embedjson_bignum_begin(embedjson_parser* parser,
     embedjson_int_t initial_value);
@@ -56,6 +260,53 @@ EMBEDJSON_STATIC int embedjson_bignum_chunk(embedjson_parser* parser,
 EMBEDJSON_STATIC int embedjson_bignum_end(embedjson_parser* parser);
 #endif /* EMBEDJSON_BIGNUM */
 
+/**
+ * Version of the checkpoint layout.
+ *
+ * Incremented each time the layout of embedjson_checkpoint output
+ * is changed. Checkpoints of other versions are rejected by
+ * embedjson_restore.
+ */
+#define EMBEDJSON_CHECKPOINT_VERSION 2
+
+/**
+ * Returns the number of bytes needed to store the parser's checkpoint
+ */
+EMBEDJSON_STATIC embedjson_size_t embedjson_checkpoint_size(
+    const embedjson_parser* parser);
+
+/**
+ * Stores parser's state into a compact platform-independent form.
+ *
+ * Pointers are not stored, i.e. embedjson_parser.filter and
+ * embedjson_parser.userdata should be restored by the caller. Dynamic stack
+ * content is stored.
+ *
+ * Returns EMBEDJSON_OK on success, or EMBEDJSON_CHECKPOINT_OVERFLOW if size
+ * is less than embedjson_checkpoint_size. Number of bytes written is stored
+ * in *written, unless written is NULL.
+ */
+EMBEDJSON_STATIC embedjson_error_code embedjson_checkpoint(
+    const embedjson_parser* parser, char* data, embedjson_size_t size,
+    embedjson_size_t* written);
+
+/**
+ * Restores parser's state from the checkpoint created by embedjson_checkpoint.
+ *
+ * Pointer members of the parser (userdata, filter, and dynamic stack)
+ * are left intact. If the dynamic stack is too small, it is extended
+ * with embedjson_stack_overflow.
+ *
+ * Returns EMBEDJSON_OK on success, EMBEDJSON_BAD_CHECKPOINT if the
+ * checkpoint is malformed or incompatible, or EMBEDJSON_STACK_OVERFLOW if
+ * the stack is too small. Parser's state is not modified on failure,
+ * except that the dynamic stack may have been extended before
+ * embedjson_stack_overflow failed. Stack content is preserved then, so
+ * the parser can still be used.
+ */
+EMBEDJSON_STATIC embedjson_error_code embedjson_restore(
+    embedjson_parser* parser, const char* data, embedjson_size_t size);
+
 #if EMBEDJSON_DYNAMIC_STACK
 /**
  * Called from embedjson_push, when parser's stack is full and more space
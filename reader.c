@@ -0,0 +1,356 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+/* pread, posix_memalign and syscall */
+#define _GNU_SOURCE
+#include "common.h"
+#include "reader.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_READER
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#ifndef EMBEDJSON_IO_URING
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define EMBEDJSON_IO_URING 1
+#endif
+#endif
+#endif /* EMBEDJSON_IO_URING */
+
+#if EMBEDJSON_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifndef __GNUC__
+#error io_uring support requires GCC-compatible atomic builtins
+#endif /* __GNUC__ */
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+/* user_data of submission queue entries */
+#define READER_READ 1
+#define READER_CANCEL 2
+#endif /* EMBEDJSON_IO_URING */
+
+#define READER_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+  int fd;
+  int flags;
+  /* Offset of the next read, -1 if input is not seekable */
+  off_t offset;
+  size_t buffer_size;
+  char* buffers[2];
+#if EMBEDJSON_IO_URING
+  /* io_uring descriptor, -1 if reads are synchronous */
+  int ring;
+  /* Number of submitted requests that are not complete yet */
+  unsigned inflight;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  struct io_uring_sqe* sqes;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  struct io_uring_cqe* cqes;
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+#endif /* EMBEDJSON_IO_URING */
+} reader_state;
+
+#if EMBEDJSON_IO_URING
+static void* uring_map(int ring, size_t size, off_t offset)
+{
+  void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring,
+      offset);
+  return addr == MAP_FAILED ? NULL : addr;
+}
+
+static void uring_destroy(reader_state* r)
+{
+  if (r->sqes) {
+    munmap(r->sqes, r->sqes_size);
+  }
+  if (r->cq_ring && r->cq_ring != r->sq_ring) {
+    munmap(r->cq_ring, r->cq_ring_size);
+  }
+  if (r->sq_ring) {
+    munmap(r->sq_ring, r->sq_ring_size);
+  }
+  if (r->ring >= 0) {
+    close(r->ring);
+  }
+  r->ring = -1;
+}
+
+/*
+ * Sets up a ring with the submission and completion queues mapped into
+ * memory. Returns non-zero value if io_uring is not available.
+ */
+static int uring_setup(reader_state* r)
+{
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  r->ring = (int) syscall(__NR_io_uring_setup, 4, &p);
+  if (r->ring < 0) {
+    return -1;
+  }
+  /* IORING_OP_READ and reads at the current position need Linux 5.6 */
+  if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+    uring_destroy(r);
+    return -1;
+  }
+  r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_ring_size = p.cq_off.cqes
+    + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cq_ring_size > r->sq_ring_size) {
+      r->sq_ring_size = r->cq_ring_size;
+    }
+    r->cq_ring_size = r->sq_ring_size;
+  }
+  r->sq_ring = uring_map(r->ring, r->sq_ring_size, IORING_OFF_SQ_RING);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    r->cq_ring = r->sq_ring;
+  } else {
+    r->cq_ring = uring_map(r->ring, r->cq_ring_size, IORING_OFF_CQ_RING);
+  }
+  r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = uring_map(r->ring, r->sqes_size, IORING_OFF_SQES);
+  if (!r->sq_ring || !r->cq_ring || !r->sqes) {
+    uring_destroy(r);
+    return -1;
+  }
+  char* sq = r->sq_ring;
+  r->sq_tail = (unsigned*) (sq + p.sq_off.tail);
+  r->sq_mask = (unsigned*) (sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned*) (sq + p.sq_off.array);
+  char* cq = r->cq_ring;
+  r->cq_head = (unsigned*) (cq + p.cq_off.head);
+  r->cq_tail = (unsigned*) (cq + p.cq_off.tail);
+  r->cq_mask = (unsigned*) (cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe*) (cq + p.cq_off.cqes);
+  return 0;
+}
+
+static int uring_submit(reader_state* r, unsigned char opcode,
+    unsigned long long addr, unsigned len, off_t offset,
+    unsigned long long user_data)
+{
+  unsigned tail = *r->sq_tail;
+  unsigned index = tail & *r->sq_mask;
+  struct io_uring_sqe* sqe = r->sqes + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = r->fd;
+  sqe->addr = addr;
+  sqe->len = len;
+  /* All ones for non-seekable input, i.e. read at the current position */
+  sqe->off = (unsigned long long) offset;
+  sqe->user_data = user_data;
+  r->sq_array[index] = index;
+  __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  long n;
+  do {
+    n = syscall(__NR_io_uring_enter, r->ring, 1, 0, 0, NULL, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n < 1) {
+    return -1;
+  }
+  ++r->inflight;
+  return 0;
+}
+
+/*
+ * Waits for the next completion. Returns its result and user_data.
+ */
+static int uring_wait(reader_state* r, unsigned long long* user_data)
+{
+  for (;;) {
+    unsigned head = *r->cq_head;
+    if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe* cqe = r->cqes + (head & *r->cq_mask);
+      int res = cqe->res;
+      *user_data = cqe->user_data;
+      __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+      --r->inflight;
+      return res;
+    }
+    if (syscall(__NR_io_uring_enter, r->ring, 0, 1, IORING_ENTER_GETEVENTS,
+          NULL, 0) < 0 && errno != EINTR) {
+      return -errno;
+    }
+  }
+}
+
+/*
+ * Cancels the pending read, which may never complete for pipes and sockets,
+ * and waits until the kernel releases the buffer
+ */
+static void uring_cancel(reader_state* r)
+{
+  if (!r->inflight) {
+    return;
+  }
+  /* The request to cancel is identified by its user_data */
+  uring_submit(r, IORING_OP_ASYNC_CANCEL, READER_READ, 0, 0, READER_CANCEL);
+  while (r->inflight) {
+    unsigned long long user_data;
+    if (uring_wait(r, &user_data) == -EBADF) {
+      break;
+    }
+  }
+}
+#endif /* EMBEDJSON_IO_URING */
+
+static int reader_init(reader_state* r)
+{
+  if (r->flags & EMBEDJSON_READ_DIRECT) {
+    r->buffer_size = (r->buffer_size + EMBEDJSON_DIRECT_ALIGNMENT - 1)
+      / EMBEDJSON_DIRECT_ALIGNMENT * EMBEDJSON_DIRECT_ALIGNMENT;
+    for (int i = 0; i < 2; ++i) {
+      void* buffer;
+      int err = posix_memalign(&buffer, EMBEDJSON_DIRECT_ALIGNMENT,
+          r->buffer_size);
+      if (err) {
+        errno = err;
+        return -1;
+      }
+      r->buffers[i] = buffer;
+    }
+  } else {
+    for (int i = 0; i < 2; ++i) {
+      r->buffers[i] = malloc(r->buffer_size);
+      if (!r->buffers[i]) {
+        return -1;
+      }
+    }
+  }
+#if EMBEDJSON_IO_URING
+  if (!(r->flags & EMBEDJSON_READ_NO_URING) && uring_setup(r)) {
+    /* Fall back to synchronous reads */
+    r->ring = -1;
+  }
+#endif /* EMBEDJSON_IO_URING */
+  return 0;
+}
+
+static void reader_destroy(reader_state* r)
+{
+  int saved_errno = errno;
+#if EMBEDJSON_IO_URING
+  if (r->ring >= 0) {
+    uring_cancel(r);
+    uring_destroy(r);
+  }
+#endif /* EMBEDJSON_IO_URING */
+  free(r->buffers[0]);
+  free(r->buffers[1]);
+  errno = saved_errno;
+}
+
+/*
+ * Starts reading into the i-th buffer. Synchronous reads are performed
+ * later, by reader_wait.
+ */
+static int reader_submit(reader_state* r, int i)
+{
+#if EMBEDJSON_IO_URING
+  if (r->ring >= 0) {
+    return uring_submit(r, IORING_OP_READ, (unsigned long) r->buffers[i],
+        (unsigned) r->buffer_size, r->offset, READER_READ);
+  }
+#endif /* EMBEDJSON_IO_URING */
+  EMBEDJSON_UNUSED(r);
+  EMBEDJSON_UNUSED(i);
+  return 0;
+}
+
+/*
+ * Returns the number of bytes read into the i-th buffer, zero at the end
+ * of input, or -1 with errno set
+ */
+static ssize_t reader_wait(reader_state* r, int i)
+{
+#if EMBEDJSON_IO_URING
+  if (r->ring >= 0) {
+    unsigned long long user_data;
+    int res = uring_wait(r, &user_data);
+    if (res < 0) {
+      errno = -res;
+      return -1;
+    }
+    return res;
+  }
+#endif /* EMBEDJSON_IO_URING */
+  ssize_t n;
+  do {
+    n = r->offset < 0
+      ? read(r->fd, r->buffers[i], r->buffer_size)
+      : pread(r->fd, r->buffers[i], r->buffer_size, r->offset);
+  } while (n < 0 && errno == EINTR);
+  return n;
+}
+
+EMBEDJSON_STATIC int embedjson_push_fd(embedjson_parser* parser, int fd,
+    embedjson_size_t buffer_size, int flags)
+{
+  reader_state r;
+  memset(&r, 0, sizeof(r));
+  r.fd = fd;
+  r.flags = flags;
+  r.buffer_size = buffer_size ? buffer_size : READER_BUFFER_SIZE;
+  r.offset = lseek(fd, 0, SEEK_CUR);
+#if EMBEDJSON_IO_URING
+  r.ring = -1;
+#endif /* EMBEDJSON_IO_URING */
+  int err = EMBEDJSON_READ_ERROR;
+  if (!reader_init(&r) && !reader_submit(&r, 0)) {
+    for (int i = 0;; i ^= 1) {
+      ssize_t n = reader_wait(&r, i);
+      if (n <= 0) {
+        err = n < 0 ? EMBEDJSON_READ_ERROR : 0;
+        break;
+      }
+      /* Direct reads are not short, unless at the end of file */
+      int last = (flags & EMBEDJSON_READ_DIRECT)
+        && (size_t) n < r.buffer_size;
+      if (r.offset >= 0) {
+        r.offset += n;
+      }
+      if (!last && reader_submit(&r, i ^ 1)) {
+        err = EMBEDJSON_READ_ERROR;
+        break;
+      }
+      err = embedjson_push(parser, r.buffers[i], (embedjson_size_t) n);
+      if (err || last) {
+        break;
+      }
+    }
+  }
+  reader_destroy(&r);
+  return err;
+}
+
+#endif /* EMBEDJSON_READER */
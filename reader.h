@@ -0,0 +1,67 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#ifndef EMBEDJSON_AMALGAMATE
+#pragma once
+#include "common.h"
+#include "parser.h"
+#endif /* EMBEDJSON_AMALGAMATE */
+
+#if EMBEDJSON_READER
+
+/**
+ * Flag of embedjson_push_fd: input is opened with O_DIRECT.
+ *
+ * Buffers are aligned to EMBEDJSON_DIRECT_ALIGNMENT, buffer_size is rounded
+ * up to its multiple, and a short read is regarded as the end of input.
+ * The current file offset should be aligned as well.
+ */
+#define EMBEDJSON_READ_DIRECT 1
+
+/**
+ * Flag of embedjson_push_fd: do not use io_uring, read input with pread
+ * (or read, if input is not seekable) on the calling thread. Reads are
+ * synchronous then, and do not overlap with parsing.
+ */
+#define EMBEDJSON_READ_NO_URING 2
+
+#ifndef EMBEDJSON_DIRECT_ALIGNMENT
+/**
+ * Alignment of buffers, offsets and sizes of reads from files opened
+ * with O_DIRECT
+ */
+#define EMBEDJSON_DIRECT_ALIGNMENT 4096
+#endif
+
+/**
+ * Reads fd from the current position until the end of input, and pushes
+ * the data to the parser with embedjson_push.
+ *
+ * Buffers of buffer_size bytes (zero means 1 MiB) are used. When the kernel
+ * supports io_uring, reads are submitted with it into two buffers: while
+ * one buffer is parsed, the next read fills the other one. Otherwise, or
+ * with EMBEDJSON_READ_NO_URING, the fallback is synchronous: each read is
+ * performed with pread (or read for pipes and sockets) on the calling
+ * thread after the previous buffer is parsed, so I/O does not overlap
+ * with parsing. Offsets of seekable files are passed explicitly, so
+ * the file position is not changed.
+ *
+ * embedjson_finalize is not called, so the rest of the document may be
+ * pushed later, e.g. from another descriptor.
+ *
+ * Returns 0 at the end of input, non-zero value returned from
+ * embedjson_push (including EMBEDJSON_DONE), or EMBEDJSON_READ_ERROR
+ * with errno set if input can not be read or buffers can not be allocated.
+ *
+ * @note Requires libc and POSIX. When the library is amalgamated,
+ * _GNU_SOURCE or _DEFAULT_SOURCE should be defined before any system
+ * header is included.
+ */
+EMBEDJSON_STATIC int embedjson_push_fd(embedjson_parser* parser, int fd,
+    embedjson_size_t buffer_size, int flags);
+
+#endif /* EMBEDJSON_READER */
@@ -50,6 +50,14 @@ EOT
 cat common.h | tail -n +7 >> $out/embedjson.c
 cat common.c | tail -n +7 >> $out/embedjson.c
 cat lexer.h | tail -n +7 >> $out/embedjson.c
+cat filter.h | tail -n +7 >> $out/embedjson.c
 cat parser.h | tail -n +7 >> $out/embedjson.c
+cat parallel.h | tail -n +7 >> $out/embedjson.c
+cat reader.h | tail -n +7 >> $out/embedjson.c
+cat decompress.h | tail -n +7 >> $out/embedjson.c
 cat lexer.c | tail -n +7 >> $out/embedjson.c
+cat filter.c | tail -n +7 >> $out/embedjson.c
 cat parser.c | tail -n +7 >> $out/embedjson.c
+cat parallel.c | tail -n +7 >> $out/embedjson.c
+cat reader.c | tail -n +7 >> $out/embedjson.c
+cat decompress.c | tail -n +7 >> $out/embedjson.c
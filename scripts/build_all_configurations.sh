@@ -1,5 +1,12 @@
 #!/usr/bin/env bash
 # Check compilation for all possible configurations
+#
+# With --bench, compare parse throughput (see embedjson-bench) and code size
+# of Release builds instead: the default configuration, each option changed
+# separately, and configurations given as further arguments, e.g.
+#   scripts/build_all_configurations.sh --bench \
+#     "-DEMBEDJSON_BIGNUM=TRUE -DEMBEDJSON_ENABLE_INT128=TRUE"
+# Arguments of embedjson-bench are taken from EMBEDJSON_BENCH_ARGS.
 
 RED='\033[0;31m'
 GREEN='\033[0;32m'
@@ -7,17 +14,140 @@ RESET='\033[0m'
 
 configurations=()
 
+if [ "$1" == "--bench" ]; then
+  shift
+  configurations=(
+    ""
+    "-DEMBEDJSON_DEBUG=TRUE"
+    "-DEMBEDJSON_DYNAMIC_STACK=TRUE"
+    "-DEMBEDJSON_STATIC_STACK_SIZE=4"
+    "-DEMBEDJSON_STATIC_STACK_SIZE=64"
+    "-DEMBEDJSON_VALIDATE_UTF8=FALSE"
+    "-DEMBEDJSON_BIGNUM=TRUE"
+    "-DEMBEDJSON_ENABLE_INT128=TRUE"
+    "-DEMBEDJSON_PATH_FILTER=TRUE"
+    "-DEMBEDJSON_STREAM=TRUE"
+    "-DEMBEDJSON_TRANSCODE=TRUE"
+    "-DEMBEDJSON_UTF16_STRINGS=TRUE"
+    "-DEMBEDJSON_STRING_BUFFER_SIZE=64"
+    "$@"
+  )
+  bench_args=${EMBEDJSON_BENCH_ARGS:-"--runs 5"}
+  # Parser's code, without the bench itself
+  objects="common lexer filter parser"
+  n=${#configurations[@]}
+  source_dir=$(pwd)
+  results=$(mktemp)
+  for num in $(seq $n); do
+    i=$(($num - 1))
+    configuration=${configurations[$i]}
+    label=$(echo $configuration | sed -e 's/-DEMBEDJSON_//g' -e 's/-D//g')
+    label=${label:-default}
+    build_dir=/tmp/embedjson-build-$(uuidgen)
+    mkdir $build_dir
+    cd $build_dir
+    if cmake -DCMAKE_BUILD_TYPE=Release $configuration $source_dir \
+          > /dev/null 2> /dev/null \
+        && make -j embedjson-bench ut-parser > /dev/null 2> /dev/null \
+        && ./embedjson-bench $bench_args --json bench.json \
+          > /dev/null 2> /dev/null; then
+      code_size=$(for object in $objects; do
+          echo CMakeFiles/ut-parser.dir/$object.c.o; done \
+        | xargs size | awk 'NR > 1 {s += $1} END {print s}')
+      # One result per line, stdout is not used as EMBEDJSON_DEBUG logs there
+      mbps=$(awk -F '"' '/"corpus"/ {
+          for (i = 1; i < NF; ++i) {
+            if ($i == "mb_per_s") {
+              value = $(i + 1)
+              gsub(/[:,]/, "", value)
+              printf "%s=%s ", $4, value
+            }
+          }
+        }' bench.json)
+      echo -e "$label\t$code_size\t$mbps" >> $results
+      echo -e [$num/$n] $GREEN$label$RESET >&2
+    else
+      echo -e [$num/$n] $RED$label$RESET >&2
+    fi
+    cd $source_dir
+    rm -rf $build_dir
+  done
+  # Throughput in MB/s, its geometric mean over corpora, and code size in
+  # bytes, relative to the first configuration. Corpora that some
+  # configurations lack (e.g. ndjson-stream, which needs EMBEDJSON_STREAM)
+  # are shown after the others and are not included in the mean.
+  awk -F '\t' '
+    {
+      label[NR] = $1
+      code[NR] = $2
+      n = split($3, pairs, " ")
+      for (i = 1; i <= n; ++i) {
+        split(pairs[i], kv, "=")
+        mbps[NR, kv[1]] = kv[2]
+        if (!(kv[1] in count)) {
+          order[++norder] = kv[1]
+        }
+        ++count[kv[1]]
+      }
+    }
+    END {
+      for (i = 1; i <= norder; ++i) {
+        if (count[order[i]] == NR) {
+          names[++ncommon] = order[i]
+        }
+      }
+      ncorpora = ncommon
+      for (i = 1; i <= norder; ++i) {
+        if (count[order[i]] != NR) {
+          names[++ncorpora] = order[i]
+        }
+      }
+      printf "%-32s %8s %7s", "configuration", "code", "change"
+      for (i = 1; i <= ncorpora; ++i) {
+        printf " %13s", names[i]
+      }
+      printf " %8s %7s\n", "mean", "change"
+      for (r = 1; r <= NR; ++r) {
+        log_sum = 0
+        for (i = 1; i <= ncommon; ++i) {
+          log_sum += log(mbps[r, names[i]])
+        }
+        mean = exp(log_sum / ncommon)
+        if (r == 1) {
+          base_code = code[r]
+          base_mean = mean
+        }
+        printf "%-32s %8d %+6.1f%%", label[r], code[r],
+          100 * (code[r] / base_code - 1)
+        for (i = 1; i <= ncorpora; ++i) {
+          if ((r, names[i]) in mbps) {
+            printf " %13.2f", mbps[r, names[i]]
+          } else {
+            printf " %13s", "-"
+          }
+        }
+        printf " %8.2f %+6.1f%%\n", mean, 100 * (mean / base_mean - 1)
+      }
+    }' $results
+  rm -f $results
+  exit 0
+fi
+
 for CMAKE_BUILD_TYPE in Release Debug; do
 for EMBEDJSON_DEBUG in TRUE FALSE; do
 for EMBEDJSON_DYNAMIC_STACK in TRUE FALSE; do
 for EMBEDJSON_VALIDATE_UTF8 in TRUE FALSE; do
 for EMBEDJSON_BIGNUM in TRUE FALSE; do
+for EMBEDJSON_PATH_FILTER in TRUE FALSE; do
+for EMBEDJSON_STREAM in TRUE FALSE; do
   options="
     -DCMAKE_BUILD_TYPE=$CMAKE_BUILD_TYPE \
     -DEMBEDJSON_DEBUG=$EMBEDJSON_DEBUG \
     -DEMBEDJSON_DYNAMIC_STACK=$EMBEDJSON_DYNAMIC_STACK \
     -DEMBEDJSON_VALIDATE_UTF8=$EMBEDJSON_VALIDATE_UTF8 \
     -DEMBEDJSON_BIGNUM=$EMBEDJSON_BIGNUM \
+    -DEMBEDJSON_PATH_FILTER=$EMBEDJSON_PATH_FILTER \
+    -DEMBEDJSON_STREAM=$EMBEDJSON_STREAM \
     "
   configurations+=("$options")
 done
@@ -25,6 +155,8 @@ done
 done
 done
 done
+done
+done
 
 n=${#configurations[@]}
 source_dir=$(pwd)
@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+
+embedjson_lint="$1"
+cases_dir="$2"
+
+# Gzip files and streams are decompressed on the fly, and give the same
+# results as plain input
+dir=$(mktemp -d)
+trap "rm -rf $dir" EXIT
+for i in $cases_dir/*; do
+  gzip -c "$i/in.json" > $dir/in.json.gz
+
+  echo -n "Run test $i, gzip file ... "
+  if [ "$($embedjson_lint --verbose $dir/in.json.gz)" \
+      == "$(cat $i/out.txt)" ]; then
+    echo OK
+  else
+    echo FAIL
+    exit 1
+  fi
+
+  echo -n "Run test $i, gzip stream ... "
+  if [ "$($embedjson_lint --verbose < $dir/in.json.gz)" \
+      == "$(cat $i/out.txt)" ]; then
+    echo OK
+  else
+    echo FAIL
+    exit 1
+  fi
+done
+
+echo -n "Run test gzip file in multi-file mode ... "
+echo '[1,2,3]' | gzip -c > $dir/array.json.gz
+if [ "$($embedjson_lint -j 2 $dir/array.json.gz | head -1)" \
+    == "$dir/array.json.gz: ok" ]; then
+  echo OK
+else
+  echo FAIL
+  exit 1
+fi
+
+echo -n "Run test truncated gzip file ... "
+head -c 20 $dir/array.json.gz > $dir/truncated.json.gz
+if $embedjson_lint $dir/truncated.json.gz 2>&1 \
+    | grep -q EMBEDJSON_BAD_COMPRESSION; then
+  echo OK
+else
+  echo FAIL
+  exit 1
+fi
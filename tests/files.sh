@@ -0,0 +1,110 @@
+#!/usr/bin/env bash
+
+embedjson_lint="$1"
+
+# Multi-file mode: inputs are validated concurrently, results are printed
+# in input order, followed by a summary and a throughput line
+dir=$(mktemp -d)
+trap "rm -rf $dir" EXIT
+cd $dir
+mkdir -p tree/sub tree/empty
+echo '[1,2]' > tree/a.json
+echo '{"a":}' > tree/sub/b.json
+echo '{}' > tree/sub/c.json
+echo '{}' > tree/d.txt
+echo 'true' > e.json
+for i in $(seq -w 0 39); do
+  if [ $((10#$i % 7)) == 3 ]; then
+    echo '[1,,2]' > many-$i.json
+  else
+    echo "{\"id\":$((10#$i))}" > many-$i.json
+  fi
+done
+echo e.json > list
+echo tree/a.json >> list
+echo >> list
+echo missing.json >> list
+
+# Runs embedjson-lint with the given arguments, and compares its output
+# without the throughput line and error descriptions, and its exit code,
+# with the expected ones
+check() {
+  local name="$1" expected_rc="$2" expected="$3"
+  shift 3
+  echo -n "Run test $name ... "
+  local output
+  output=$($embedjson_lint "$@" 2>&1)
+  local rc=$?
+  output=$(echo "$output" | grep -v ' MB/s, ' \
+    | sed -e "s/\(near symbol '.'\): .*/\1/")
+  if [ $rc == $expected_rc ] && [ "$output" == "$expected" ]; then
+    echo OK
+  else
+    echo FAIL
+    echo "Exit code $rc, expected $expected_rc"
+    echo "Expected output:"
+    echo "$expected"
+    echo "Got output:"
+    echo "$output"
+    exit 1
+  fi
+}
+
+error="error parsing json near symbol '}'"
+
+check "directory" 1 "tree/a.json: ok
+tree/sub/b.json: $error
+tree/sub/c.json: ok
+3 files: 2 valid, 1 invalid, 0 unreadable" tree
+
+check "directory with --include" 0 "tree/d.txt: ok
+1 files: 1 valid, 0 invalid, 0 unreadable" --include '*.txt' tree
+
+check "files in argument order" 0 "e.json: ok
+tree/sub/c.json: ok
+tree/a.json: ok
+3 files: 3 valid, 0 invalid, 0 unreadable" e.json tree/sub/c.json tree/a.json
+
+check "missing file" 1 "tree/a.json: ok
+missing.json: can not read: No such file or directory
+e.json: ok
+3 files: 2 valid, 0 invalid, 1 unreadable" tree/a.json missing.json e.json
+
+check "glob" 1 "tree/a.json: ok
+tree/sub/b.json: $error
+tree/sub/c.json: ok
+3 files: 2 valid, 1 invalid, 0 unreadable" 'tree/*.json' 'tree/s*'
+
+check "single glob" 0 "tree/d.txt: ok
+1 files: 1 valid, 0 invalid, 0 unreadable" 'tree/*.txt'
+
+check "--files-from" 1 "e.json: ok
+tree/a.json: ok
+missing.json: can not read: No such file or directory
+tree/sub/c.json: ok
+4 files: 3 valid, 0 invalid, 1 unreadable" --files-from list tree/sub/c.json
+
+check "--files-from stdin" 0 "tree/sub/c.json: ok
+1 files: 1 valid, 0 invalid, 0 unreadable" --files-from - < <(echo tree/sub/c.json)
+
+# Results of files validated on several threads are printed in input order
+expected=""
+for i in $(seq -w 0 39); do
+  if [ $((10#$i % 7)) == 3 ]; then
+    expected+="many-$i.json: error parsing json near symbol ','
+"
+  else
+    expected+="many-$i.json: ok
+"
+  fi
+done
+for jobs in 1 3 8; do
+  check "-j $jobs" 1 "${expected}40 files: 34 valid, 6 invalid, 0 unreadable" \
+    -j $jobs 'many-*.json'
+done
+
+check "single file with -j" 0 "e.json: ok
+1 files: 1 valid, 0 invalid, 0 unreadable" -j 2 e.json
+
+check "empty directory" 0 "0 files: 0 valid, 0 invalid, 0 unreadable" \
+  tree/empty
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+
+embedjson_gen="$1"
+embedjson_lint="$2"
+
+# Corpora of every kind are valid JSON (big numbers are not, as
+# embedjson-lint is built without EMBEDJSON_BIGNUM)
+while read -r args; do
+  echo -n "Run generator $args ... "
+  if $embedjson_gen --size 1M $args | $embedjson_lint; then
+    echo OK
+  else
+    echo FAIL
+    exit 1
+  fi
+done <<EOT
+--seed 1
+--seed 2 --whitespace pretty --depth 0:8 --keys 0:16
+--seed 3 --whitespace random --depth 64:100 --keys 1:2
+--seed 4 --string-length 0:4096 --escapes 20 --non-ascii 30
+--seed 5 --non-ascii 100 --numbers 0:1:0
+--seed 6 --escapes 100 --numbers 1:0:0 --depth 0
+--seed 7 --scalars 1:2:3 --depth 2:3 --whitespace random
+--seed 10 --containers 0:1 --keys 16:64 --depth 1:3
+--seed 11 --containers 1:0 --scalars 0:1:0 --numbers 0:1:0
+EOT
+
+# Newline-delimited records are checked as elements of an array, since
+# embedjson-lint is built without EMBEDJSON_STREAM
+while read -r args; do
+  echo -n "Run generator --ndjson $args ... "
+  if $embedjson_gen --size 1M --ndjson $args \
+      | sed -e '1s/^/[/' -e '$!s/$/,/' -e '$s/$/]/' | $embedjson_lint; then
+    echo OK
+  else
+    echo FAIL
+    exit 1
+  fi
+done <<EOT
+--seed 8
+--seed 9 --depth 0:16 --keys 0:16 --escapes 5 --non-ascii 5
+EOT
+
+echo -n "Run generator twice with the same seed ... "
+if [ "$($embedjson_gen --seed 7 --non-ascii 10 | cksum)" \
+    == "$($embedjson_gen --seed 7 --non-ascii 10 | cksum)" ]; then
+  echo OK
+else
+  echo FAIL
+  exit 1
+fi
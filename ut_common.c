@@ -26,6 +26,16 @@ int embedjson_error(struct embedjson_parser* parser,
   return 0;
 }
 
+#if EMBEDJSON_STREAM
+int embedjson_stream_error(struct embedjson_parser* parser,
+    const char* position)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(position);
+  return 0;
+}
+#endif /* EMBEDJSON_STREAM */
+
 static void fail(const char* fmt, ...)
 {
   va_list args;
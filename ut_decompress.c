@@ -0,0 +1,149 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+/* pipe, mkstemp and POSIX threads */
+#define _POSIX_C_SOURCE 200809L
+
+#include "decompress.h"
+#include "ut_fd.h"
+
+#if EMBEDJSON_ZLIB
+#include <zlib.h>
+#endif /* EMBEDJSON_ZLIB */
+
+/* Number of members of a multi-member gzip file */
+#define NMEMBERS 3
+
+#if EMBEDJSON_ZLIB
+static char* gzipped = NULL;
+static size_t gzipped_size = 0;
+#endif /* EMBEDJSON_ZLIB */
+
+static int push_fd(embedjson_parser* parser, int fd,
+    embedjson_size_t block_size, int flags)
+{
+  return embedjson_push_compressed(parser, fd, block_size, flags);
+}
+
+#if EMBEDJSON_ZLIB
+/*
+ * Compresses the input into NMEMBERS concatenated gzip members
+ */
+static void generate_gzipped()
+{
+  gzipped = malloc(input_size + 1024);
+  size_t member_size = input_size / NMEMBERS + 1;
+  for (size_t pos = 0; pos < input_size; pos += member_size) {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, 6, Z_DEFLATED, 16 + MAX_WBITS, 8,
+          Z_DEFAULT_STRATEGY) != Z_OK) {
+      fail("Failed to initialize zlib");
+    }
+    z.next_in = (unsigned char*) input + pos;
+    z.avail_in = (uInt) (input_size - pos < member_size
+      ? input_size - pos : member_size);
+    z.next_out = (unsigned char*) gzipped + gzipped_size;
+    z.avail_out = (uInt) (input_size + 1024 - gzipped_size);
+    if (deflate(&z, Z_FINISH) != Z_STREAM_END) {
+      fail("Failed to compress input");
+    }
+    gzipped_size += z.total_out;
+    deflateEnd(&z);
+  }
+}
+#endif /* EMBEDJSON_ZLIB */
+
+static void test_file(const char* data, size_t size,
+    embedjson_size_t block_size, int flags, int expected_err)
+{
+  int fd = open_file(O_RDWR | O_TRUNC, 0);
+  if (write(fd, data, size) != (ssize_t) size || lseek(fd, 0, SEEK_SET)) {
+    fail("Failed to write temporary file: %s", strerror(errno));
+  }
+  parse_fd(fd, block_size, flags, expected_err);
+  close(fd);
+}
+
+int main()
+{
+  static const embedjson_size_t block_sizes[] = {0, 1000, 13};
+  static const int flags[] = {0, EMBEDJSON_DECOMPRESS_THREAD};
+  size_t ntests = SIZEOF(flags)
+    * (SIZEOF(block_sizes) * (2 + 2 * EMBEDJSON_ZLIB) + 2 + EMBEDJSON_ZLIB) + 1;
+  size_t ntest = 0;
+  generate_input("", "ut-decompress");
+#if EMBEDJSON_ZLIB
+  generate_gzipped();
+#endif /* EMBEDJSON_ZLIB */
+  for (size_t i = 0; i < SIZEOF(flags); ++i) {
+    const char* mode = flags[i] ? "thread" : "sequential";
+    for (size_t j = 0; j < SIZEOF(block_sizes); ++j) {
+      printf("[%d/%d] Run test \"%s, plain file, %llu bytes per block\" ... ",
+          (int) ++ntest, (int) ntests, mode, (ull) block_sizes[j]);
+      test_file(input, input_size, block_sizes[j], flags[i], 0);
+      printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+      printf("[%d/%d] Run test \"%s, plain pipe, %llu bytes per block\" ... ",
+          (int) ++ntest, (int) ntests, mode, (ull) block_sizes[j]);
+      test_pipe(input, input_size, block_sizes[j], flags[i]);
+      printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+#if EMBEDJSON_ZLIB
+      printf("[%d/%d] Run test \"%s, gzip file, %llu bytes per block\" ... ",
+          (int) ++ntest, (int) ntests, mode, (ull) block_sizes[j]);
+      test_file(gzipped, gzipped_size, block_sizes[j], flags[i], 0);
+      printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+      printf("[%d/%d] Run test \"%s, gzip pipe, %llu bytes per block\" ... ",
+          (int) ++ntest, (int) ntests, mode, (ull) block_sizes[j]);
+      test_pipe(gzipped, gzipped_size, block_sizes[j], flags[i]);
+      printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+#endif /* EMBEDJSON_ZLIB */
+    }
+
+    printf("[%d/%d] Run test \"%s, stop on a blocked pipe\" ... ",
+        (int) ++ntest, (int) ntests, mode);
+    stop_at = NVALUES;
+    test_pipe(input, input_size, 100, flags[i]);
+    stop_at = 0;
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+#if EMBEDJSON_ZLIB
+    printf("[%d/%d] Run test \"%s, truncated gzip\" ... ", (int) ++ntest,
+        (int) ntests, mode);
+    test_file(gzipped, gzipped_size / 2, 0, flags[i],
+        EMBEDJSON_BAD_COMPRESSION);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+    printf("[%d/%d] Run test \"%s, corrupt gzip\" ... ", (int) ++ntest,
+        (int) ntests, mode);
+    /* CRC32 of the last member does not match */
+    gzipped[gzipped_size - 8] ^= 1;
+    test_file(gzipped, gzipped_size, 0, flags[i], EMBEDJSON_BAD_COMPRESSION);
+    gzipped[gzipped_size - 8] ^= 1;
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+#else
+    printf("[%d/%d] Run test \"%s, gzip is not supported\" ... ",
+        (int) ++ntest, (int) ntests, mode);
+    test_file("\x1f\x8b\x08\x00", 4, 0, flags[i], EMBEDJSON_BAD_COMPRESSION);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+#endif /* EMBEDJSON_ZLIB */
+  }
+
+  printf("[%d/%d] Run test \"read error\" ... ", (int) ++ntest,
+      (int) ntests);
+  test_read_error();
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+  unlink(filename);
+  free(input);
+#if EMBEDJSON_ZLIB
+  free(gzipped);
+#endif /* EMBEDJSON_ZLIB */
+  return 0;
+}
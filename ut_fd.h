@@ -0,0 +1,327 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+/*
+ * Test harness shared by ut_reader.c and ut_decompress.c: parsing callbacks
+ * that sum integer values, the input they are checked against, and
+ * tests that feed it through a file, a pipe, or a failing descriptor.
+ *
+ * The including file defines a feature test macro for pipe, mkstemp and
+ * POSIX threads, and push_fd, which parses a file descriptor with the
+ * function under test.
+ */
+
+#pragma once
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "parser.h"
+
+#define SIZEOF(x) sizeof((x)) / sizeof((x)[0])
+
+#define ANSI_COLOR_RED "\x1b[31m"
+#define ANSI_COLOR_GREEN "\x1b[32m"
+#define ANSI_COLOR_RESET "\x1b[0m"
+
+#define NVALUES 50000
+
+typedef unsigned long long ull;
+
+static char* input = NULL;
+static size_t input_size = 0;
+static long long expected_sum = 0;
+static long long sum = 0;
+static size_t nvalues = 0;
+/* embedjson_int returns an error when nvalues reaches stop_at */
+static size_t stop_at = 0;
+static char filename[64];
+
+static int push_fd(embedjson_parser* parser, int fd,
+    embedjson_size_t buffer_size, int flags);
+
+static void fail(const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  printf(ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET "\n\n");
+  vprintf(fmt, args);
+  printf("\n");
+  va_end(args);
+  if (*filename) {
+    unlink(filename);
+  }
+  exit(1);
+}
+
+int embedjson_error(embedjson_parser* parser, const char* position)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(position);
+  return 1;
+}
+
+int embedjson_null(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_bool(embedjson_parser* parser, char value)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(value);
+  return 0;
+}
+
+int embedjson_int(embedjson_parser* parser, embedjson_int_t value)
+{
+  EMBEDJSON_UNUSED(parser);
+  sum += value;
+  return ++nvalues == stop_at ? 42 : 0;
+}
+
+int embedjson_double(embedjson_parser* parser, double value)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(value);
+  return 0;
+}
+
+int embedjson_string_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+#if EMBEDJSON_UTF16_STRINGS
+int embedjson_string_chunk16(embedjson_parser* parser,
+    const embedjson_char16_t* data, embedjson_size_t size)
+#else
+int embedjson_string_chunk(embedjson_parser* parser, const char* data,
+    embedjson_size_t size)
+#endif /* EMBEDJSON_UTF16_STRINGS */
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_UNUSED(size);
+  return 0;
+}
+
+int embedjson_string_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_object_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_object_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_array_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_array_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+#if EMBEDJSON_BIGNUM
+int embedjson_bignum_begin(embedjson_parser* parser,
+    embedjson_int_t initial_value)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(initial_value);
+  return 0;
+}
+
+int embedjson_bignum_chunk(embedjson_parser* parser,
+    const char* data, embedjson_size_t size)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_UNUSED(size);
+  return 0;
+}
+
+int embedjson_bignum_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+#endif /* EMBEDJSON_BIGNUM */
+
+#if EMBEDJSON_STREAM
+int embedjson_document_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_document_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+#endif /* EMBEDJSON_STREAM */
+
+#if EMBEDJSON_DYNAMIC_STACK
+int embedjson_stack_overflow(embedjson_parser* parser)
+{
+  char* new_stack = realloc(parser->stack, 2 * parser->stack_capacity + 1);
+  if (!new_stack) {
+    return -1;
+  }
+  parser->stack = new_stack;
+  parser->stack_capacity = 2 * parser->stack_capacity + 1;
+  return 0;
+}
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+
+/*
+ * Generates prefix followed by an array of NVALUES integers with strings
+ * between them, and writes it to a temporary file named after name
+ */
+static void generate_input(const char* prefix, const char* name)
+{
+  size_t capacity = 32 * NVALUES;
+  input = malloc(capacity);
+  input_size = sprintf(input, "%s[", prefix);
+  for (int i = 0; i < NVALUES; ++i) {
+    input_size += sprintf(input + input_size, "%s%d,\"s\\n%d\"",
+        i ? ",\n" : "", i * 7 - 1000, i);
+    expected_sum += i * 7 - 1000;
+  }
+  input_size += sprintf(input + input_size, "]");
+  snprintf(filename, sizeof(filename), "%s.XXXXXX", name);
+  int fd = mkstemp(filename);
+  if (fd < 0 || write(fd, input, input_size) != (ssize_t) input_size) {
+    fail("Failed to write temporary file: %s", strerror(errno));
+  }
+  close(fd);
+}
+
+static void parse_fd(int fd, embedjson_size_t buffer_size, int flags,
+    int expected_err)
+{
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  sum = 0;
+  nvalues = 0;
+  int err = push_fd(&parser, fd, buffer_size, flags);
+  if (!err) {
+    err = embedjson_finalize(&parser);
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  if (err != expected_err) {
+    fail("Expected error %d, got %d (%s)", expected_err, err,
+        strerror(errno));
+  }
+  if (!err && (sum != expected_sum || nvalues != NVALUES)) {
+    fail("Expected sum %lld of %d values, got %lld of %llu", expected_sum,
+        NVALUES, sum, (ull) nvalues);
+  }
+}
+
+/*
+ * Opens the temporary file and moves its position to offset
+ */
+static int open_file(int flags, off_t offset)
+{
+  int fd = open(filename, flags);
+  if (fd < 0 || lseek(fd, offset, SEEK_SET) != offset) {
+    fail("Failed to open temporary file: %s", strerror(errno));
+  }
+  return fd;
+}
+
+typedef struct {
+  int fd;
+  const char* data;
+  size_t size;
+  /* The descriptor is kept open after all data is written */
+  int keep_open;
+} pipe_writer;
+
+static void* writer_main(void* arg)
+{
+  pipe_writer* w = arg;
+  const char* data = w->data;
+  size_t size = w->size;
+  while (size) {
+    /* Small writes make the reader see partial buffers */
+    ssize_t n = write(w->fd, data, size < 1000 ? size : 1000);
+    if (n <= 0) {
+      break;
+    }
+    data += n;
+    size -= n;
+  }
+  if (!w->keep_open) {
+    close(w->fd);
+  }
+  return NULL;
+}
+
+/*
+ * Parses data written to a pipe. If stop_at is set, the last byte is not
+ * written and the pipe is kept open, so a read submitted before the last
+ * value is parsed never completes.
+ */
+static void test_pipe(const char* data, size_t size,
+    embedjson_size_t buffer_size, int flags)
+{
+  int fds[2];
+  if (pipe(fds)) {
+    fail("Failed to create a pipe: %s", strerror(errno));
+  }
+  pipe_writer w = {fds[1], data, size, stop_at != 0};
+  if (stop_at) {
+    --w.size;
+  }
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, writer_main, &w)) {
+    fail("Failed to start the writer thread");
+  }
+  parse_fd(fds[0], buffer_size, flags, stop_at ? 42 : 0);
+  pthread_join(thread, NULL);
+  if (stop_at) {
+    close(fds[1]);
+  }
+  close(fds[0]);
+}
+
+static void test_read_error()
+{
+  int fd = open(".", O_RDONLY);
+  if (fd < 0) {
+    fail("Failed to open the current directory: %s", strerror(errno));
+  }
+  parse_fd(fd, 0, 0, EMBEDJSON_READ_ERROR);
+  if (errno != EISDIR) {
+    fail("Expected EISDIR, got %s", strerror(errno));
+  }
+  close(fd);
+}
@@ -216,6 +216,16 @@ int embedjson_error(struct embedjson_parser* parser, const char* position)
   );
 }
 
+#if EMBEDJSON_STREAM
+int embedjson_stream_error(struct embedjson_parser* parser,
+    const char* position)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(position);
+  return 0;
+}
+#endif /* EMBEDJSON_STREAM */
+
 int embedjson_token(embedjson_lexer* lexer, embedjson_tok token,
     const char* position)
 {
@@ -488,32 +498,23 @@ static token_info test_08_tokens[] = {
   {
     .type = EMBEDJSON_TOKEN_STRING_CHUNK,
     .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "п", .size = 2}}
+    .value = {.str = {.data = "\xed\x82\xbf", .size = 3}}
   },
   {
     .type = EMBEDJSON_TOKEN_STRING_CHUNK,
     .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "р", .size = 2}}
+    .value = {.str = {.data = "\xed\x86\x80" "\xed\x82\xb8" "\xed\x82\xb2",
+      .size = 9}}
   },
   {
     .type = EMBEDJSON_TOKEN_STRING_CHUNK,
     .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "и", .size = 2}}
+    .value = {.str = {.data = "\xed\x82\xb5", .size = 3}}
   },
   {
     .type = EMBEDJSON_TOKEN_STRING_CHUNK,
     .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "в", .size = 2}}
-  },
-  {
-    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
-    .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "е", .size = 2}}
-  },
-  {
-    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
-    .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "т", .size = 2}}
+    .value = {.str = {.data = "\xed\x86\x82", .size = 3}}
   },
   {.type = EMBEDJSON_TOKEN_STRING_END}
 };
@@ -845,12 +846,7 @@ static token_info test_28_tokens[] = {
   {
     .type = EMBEDJSON_TOKEN_STRING_CHUNK,
     .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "\xd8\x00", .size = 2}}
-  },
-  {
-    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
-    .value_type = TOKEN_VALUE_TYPE_STR,
-    .value = {.str = {.data = "\xd8\x00", .size = 2}}
+    .value = {.str = {.data = "\xed\xa0\x80\xed\xa0\x80", .size = 6}}
   },
   {.type = EMBEDJSON_TOKEN_ERROR},
 };
@@ -1092,6 +1088,244 @@ static token_info test_43_tokens[] = {
   {.type = EMBEDJSON_TOKEN_BIGNUM_END},
 };
 
+/**
+ * test 44
+ *
+ * UTF-16LE with byte order mark, code units and a surrogate pair split
+ * between chunks: ["é😀"]
+ */
+static char test_44_json[] = "\xff\xfe[\0\"\0\xe9\0\x3d\xd8\0\xde\"\0]\0";
+static data_chunk test_44_data_chunks[] = {
+  {.data = test_44_json, .size = 3},
+  {.data = test_44_json + 3, .size = 6},
+  {.data = test_44_json + 9, .size = sizeof(test_44_json) - 10}
+};
+static token_info test_44_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_OPEN_BRACKET},
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "\xc3\xa9", .size = 2}}
+  },
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "\xf0\x9f\x98\x80", .size = 4}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END},
+  {.type = EMBEDJSON_TOKEN_CLOSE_BRACKET},
+};
+
+/**
+ * test 45
+ *
+ * UTF-32BE without byte order mark: {"€":12}
+ */
+static char test_45_json[] = "\0\0\0{\0\0\0\"\0\0\x20\xac\0\0\0\"\0\0\0:"
+  "\0\0\0" "1\0\0\0" "2\0\0\0}";
+static data_chunk test_45_data_chunks[] = {
+  {.data = test_45_json, .size = sizeof(test_45_json) - 1}
+};
+static token_info test_45_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_OPEN_CURLY_BRACKET},
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "\xe2\x82\xac", .size = 3}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END},
+  {.type = EMBEDJSON_TOKEN_COLON},
+  {
+    .type = EMBEDJSON_TOKEN_NUMBER,
+    .value_type = TOKEN_VALUE_TYPE_INTEGER,
+    .value = {.integer = 12}
+  },
+  {.type = EMBEDJSON_TOKEN_CLOSE_CURLY_BRACKET},
+};
+
+/**
+ * test 46
+ *
+ * UTF-16BE without byte order mark, first bytes pushed one by one:
+ * "abcdefghij"
+ */
+static char test_46_json[] = "\0\"\0a\0b\0c\0d\0e\0f\0g\0h\0i\0j\0\"";
+static data_chunk test_46_data_chunks[] = {
+  {.data = test_46_json, .size = 1},
+  {.data = test_46_json + 1, .size = 1},
+  {.data = test_46_json + 2, .size = sizeof(test_46_json) - 3}
+};
+static token_info test_46_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "abcdefghij", .size = 10}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END},
+};
+
+/**
+ * test 47
+ *
+ * UTF-16LE unpaired low surrogate
+ */
+static char test_47_json[] = " \0\0\xdc";
+static data_chunk test_47_data_chunks[] = {
+  {.data = test_47_json, .size = sizeof(test_47_json) - 1}
+};
+static token_info test_47_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_ERROR},
+};
+
+/**
+ * test 48
+ *
+ * UTF-16LE input truncated in the middle of a code unit
+ */
+static char test_48_json[] = "1\0" "2";
+static data_chunk test_48_data_chunks[] = {
+  {.data = test_48_json, .size = sizeof(test_48_json) - 1}
+};
+static token_info test_48_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_ERROR},
+};
+
+/**
+ * test 49
+ *
+ * UTF-8 byte order mark split between chunks
+ */
+static char test_49_json[] = "\xef\xbb\xbf[7]";
+static data_chunk test_49_data_chunks[] = {
+  {.data = test_49_json, .size = 1},
+  {.data = test_49_json + 1, .size = sizeof(test_49_json) - 2}
+};
+static token_info test_49_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_OPEN_BRACKET},
+  {
+    .type = EMBEDJSON_TOKEN_NUMBER,
+    .value_type = TOKEN_VALUE_TYPE_INTEGER,
+    .value = {.integer = 7}
+  },
+  {.type = EMBEDJSON_TOKEN_CLOSE_BRACKET},
+};
+
+/**
+ * test 50
+ *
+ * Surrogate pair split between chunks, followed by unpaired surrogate
+ */
+static char test_50_json[] = "\"\\ud83d\\u" "de00\\u00e9x\\uD83D\"";
+static data_chunk test_50_data_chunks[] = {
+  {.data = test_50_json, .size = 9},
+  {.data = test_50_json + 9, .size = sizeof(test_50_json) - 10}
+};
+static token_info test_50_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "\xf0\x9f\x98\x80\xc3\xa9", .size = 6}}
+  },
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "x", .size = 1}}
+  },
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "\xed\xa0\xbd", .size = 3}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END}
+};
+
+/*
+ * test 51
+ *
+ * Runs of spaces, string bytes and digits longer than a word, split
+ * between chunks
+ */
+static char test_51_json[] = "[\n            \"a string longer than a word\",\n"
+  "            12345678901234567, -0.1234567890123,\n"
+  "            true, false, null, \"split in the middle of a run\"]";
+static data_chunk test_51_data_chunks[] = {
+  {.data = test_51_json, .size = 30},
+  {.data = test_51_json + 30, .size = 40},
+  {.data = test_51_json + 70, .size = 72},
+  {.data = test_51_json + 142, .size = sizeof(test_51_json) - 143}
+};
+static token_info test_51_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_OPEN_BRACKET},
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "a string longer", .size = 15}}
+  },
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = " than a word", .size = 12}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END},
+  {.type = EMBEDJSON_TOKEN_COMMA},
+  {
+    .type = EMBEDJSON_TOKEN_NUMBER,
+    .value_type = TOKEN_VALUE_TYPE_INTEGER,
+    .value = {.integer = 12345678901234567ll}
+  },
+  {.type = EMBEDJSON_TOKEN_COMMA},
+  {
+    .type = EMBEDJSON_TOKEN_NUMBER,
+    .value_type = TOKEN_VALUE_TYPE_FP,
+    .value = {.fp = -(1234567890123 * 1e-13)}
+  },
+  {.type = EMBEDJSON_TOKEN_COMMA},
+  {.type = EMBEDJSON_TOKEN_TRUE},
+  {.type = EMBEDJSON_TOKEN_COMMA},
+  {.type = EMBEDJSON_TOKEN_FALSE},
+  {.type = EMBEDJSON_TOKEN_COMMA},
+  {.type = EMBEDJSON_TOKEN_NULL},
+  {.type = EMBEDJSON_TOKEN_COMMA},
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "split in the mid", .size = 16}}
+  },
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "dle of a run", .size = 12}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END},
+  {.type = EMBEDJSON_TOKEN_CLOSE_BRACKET}
+};
+
+/*
+ * test 52
+ *
+ * Four-byte UTF-8 sequences with the second byte in \xa0..\xaf range,
+ * U+20000 and U+2FFFF
+ */
+static char test_52_json[] = "\"\xf0\xa0\x80\x80\xf0\xaf\xbf\xbf\"";
+static data_chunk test_52_data_chunks[] = {
+  {.data = test_52_json, .size = sizeof(test_52_json) - 1}
+};
+static token_info test_52_tokens[] = {
+  {.type = EMBEDJSON_TOKEN_STRING_BEGIN},
+  {
+    .type = EMBEDJSON_TOKEN_STRING_CHUNK,
+    .value_type = TOKEN_VALUE_TYPE_STR,
+    .value = {.str = {.data = "\xf0\xa0\x80\x80\xf0\xaf\xbf\xbf", .size = 8}}
+  },
+  {.type = EMBEDJSON_TOKEN_STRING_END}
+};
+
 
 #define TEST_CASE(n, description) \
 { \
@@ -1131,6 +1365,20 @@ static token_info test_43_tokens[] = {
 }
 #endif
 
+#if EMBEDJSON_TRANSCODE
+#define TEST_CASE_IF_TRANSCODE(n, description) TEST_CASE(n, description)
+#else
+#define TEST_CASE_IF_TRANSCODE(n, description) \
+{ \
+  .enabled = 0, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ntokens = SIZEOF((test_##n##_tokens)), \
+  .tokens = (test_##n##_tokens) \
+}
+#endif
+
 static test_case all_tests[] = {
   TEST_CASE(01, "empty object"),
   TEST_CASE(02, "string split into two chunks"),
@@ -1176,12 +1424,70 @@ static test_case all_tests[] = {
   TEST_CASE(41, "JSONTestSuite.n_object_non_string_key_but_huge_number_instead"),
   TEST_CASE_IF_BIGNUM(42, "valid big integer"),
   TEST_CASE_IF_BIGNUM(43, "just big integer"),
-};
+  TEST_CASE_IF_TRANSCODE(44, "UTF-16LE with BOM split between chunks"),
+  TEST_CASE_IF_TRANSCODE(45, "UTF-32BE without BOM"),
+  TEST_CASE_IF_TRANSCODE(46, "UTF-16BE pushed byte by byte"),
+  TEST_CASE_IF_TRANSCODE(47, "UTF-16LE unpaired surrogate"),
+  TEST_CASE_IF_TRANSCODE(48, "UTF-16LE truncated code unit"),
+  TEST_CASE_IF_TRANSCODE(49, "UTF-8 BOM split between chunks"),
+  TEST_CASE(50, "escaped surrogate pair split between chunks"),
+  TEST_CASE(51, "runs of spaces, string bytes and digits split between chunks"),
+  TEST_CASE(52, "four-byte utf-8 sequences of the second plane"),
+};
+
+/* How data chunks are pushed by run_test */
+enum {
+  PUSH,
+  PUSH_PADDED,
+  PARSE_COMPLETE
+};
+
+/*
+ * Runs test itest. With PUSH_PADDED, each chunk is copied into a buffer
+ * followed by EMBEDJSON_PADDING bytes that look like the continuation
+ * of a token, and pushed with embedjson_lexer_push_padded.
+ * With PARSE_COMPLETE, the only chunk is passed to
+ * embedjson_lexer_parse_complete.
+ */
+static void run_test(int mode)
+{
+  static const char garbage[] = "rue\"\\ 0123456789alse ull";
+  char buffer[256 + EMBEDJSON_PADDING];
+  size_t j;
+  itoken = itest->tokens;
+  embedjson_lexer lexer;
+  memset(&lexer, 0, sizeof(lexer));
+  for (j = 0; j < itest->nchunks; ++j) {
+    idata_chunk = itest->data_chunks + j;
+    if (mode == PUSH) {
+      embedjson_lexer_push(&lexer, idata_chunk->data, idata_chunk->size);
+      continue;
+    }
+    if (mode == PARSE_COMPLETE) {
+      embedjson_lexer_parse_complete(&lexer, idata_chunk->data,
+          idata_chunk->size);
+      continue;
+    }
+    if (idata_chunk->size > sizeof(buffer) - EMBEDJSON_PADDING) {
+      fail("EOF", "Too large chunk for the padded buffer");
+    }
+    for (size_t k = 0; k < sizeof(buffer); ++k) {
+      buffer[k] = garbage[k % (sizeof(garbage) - 1)];
+    }
+    memcpy(buffer, idata_chunk->data, idata_chunk->size);
+    embedjson_lexer_push_padded(&lexer, buffer, idata_chunk->size);
+  }
+  embedjson_lexer_finalize(&lexer);
+  if (itoken != itest->tokens + itest->ntokens) {
+    fail("EOF", "Not enough tokens. Expected %llu, got %llu",
+        (ull) itest->ntokens, (ull) (itoken - itest->tokens));
+  }
+}
 
 int main()
 {
   size_t ntests = SIZEOF(all_tests);
-  size_t i, j;
+  size_t i;
   int counter_width = 1 + (int) floor(log10(ntests));
   for (i = 0; i < ntests; ++i) {
     itest = all_tests + i;
@@ -1191,17 +1497,11 @@ int main()
       printf(ANSI_COLOR_YELLOW "SKIPPED" ANSI_COLOR_RESET "\n");
       continue;
     }
-    itoken = itest->tokens;
-    embedjson_lexer lexer;
-    memset(&lexer, 0, sizeof(lexer));
-    for (j = 0; j < itest->nchunks; ++j) {
-      idata_chunk = itest->data_chunks + j;
-      embedjson_lexer_push(&lexer, idata_chunk->data, idata_chunk->size);
-    }
-    embedjson_lexer_finalize(&lexer);
-    if (itoken != itest->tokens + itest->ntokens) {
-      fail("EOF", "Not enough tokens. Expected %llu, got %llu",
-          (ull) itest->ntokens, (ull) (itoken - itest->tokens));
+    run_test(PUSH);
+    run_test(PUSH_PADDED);
+    /* String chunks are split at the boundaries of data chunks */
+    if (itest->nchunks == 1) {
+      run_test(PARSE_COMPLETE);
     }
     printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
   }
@@ -0,0 +1,556 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include "parallel.h"
+
+#define SIZEOF(x) sizeof((x)) / sizeof((x)[0])
+
+#define ANSI_COLOR_RED "\x1b[31m"
+#define ANSI_COLOR_GREEN "\x1b[32m"
+#define ANSI_COLOR_RESET "\x1b[0m"
+
+#define NRECORDS 5000
+#define MAX_THREADS 8
+
+/* Every MALFORMED-th record is malformed */
+#define MALFORMED 100
+
+typedef unsigned long long ull;
+
+/* Per-worker state, see embedjson_parser.userdata */
+typedef struct {
+  long long sum;
+  const char* error;
+} worker_state;
+
+typedef struct {
+  long long sum;
+  int err;
+  const char* error;
+} record_result;
+
+static char* input = NULL;
+static size_t input_size = 0;
+static const char* last_record = NULL;
+static size_t nresults = 0;
+static long long stop_at = -1;
+/* Check records generated by generate_input / generate_array_input */
+static int verify = 1;
+static size_t nerrors = 0;
+/* Position of the last error delivered with embedjson_record_result */
+static const char* error_position = NULL;
+
+static void fail(const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  printf(ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET "\n\n");
+  vprintf(fmt, args);
+  printf("\n");
+  va_end(args);
+  exit(1);
+}
+
+int embedjson_error(embedjson_parser* parser, const char* position)
+{
+  if (parser->userdata) {
+    ((worker_state*) parser->userdata)->error = position;
+  }
+  return 1;
+}
+
+int embedjson_null(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_bool(embedjson_parser* parser, char value)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(value);
+  return 0;
+}
+
+int embedjson_int(embedjson_parser* parser, embedjson_int_t value)
+{
+  ((worker_state*) parser->userdata)->sum += value;
+  return 0;
+}
+
+int embedjson_double(embedjson_parser* parser, double value)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(value);
+  return 0;
+}
+
+int embedjson_string_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+#if EMBEDJSON_UTF16_STRINGS
+int embedjson_string_chunk16(embedjson_parser* parser,
+    const embedjson_char16_t* data, embedjson_size_t size)
+#else
+int embedjson_string_chunk(embedjson_parser* parser, const char* data,
+    embedjson_size_t size)
+#endif /* EMBEDJSON_UTF16_STRINGS */
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_UNUSED(size);
+  return 0;
+}
+
+int embedjson_string_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_object_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_object_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_array_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_array_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+#if EMBEDJSON_BIGNUM
+int embedjson_bignum_begin(embedjson_parser* parser,
+    embedjson_int_t initial_value)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(initial_value);
+  return 0;
+}
+
+int embedjson_bignum_chunk(embedjson_parser* parser,
+    const char* data, embedjson_size_t size)
+{
+  EMBEDJSON_UNUSED(parser);
+  EMBEDJSON_UNUSED(data);
+  EMBEDJSON_UNUSED(size);
+  return 0;
+}
+
+int embedjson_bignum_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+#endif /* EMBEDJSON_BIGNUM */
+
+#if EMBEDJSON_STREAM
+int embedjson_document_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+
+int embedjson_document_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return 0;
+}
+#endif /* EMBEDJSON_STREAM */
+
+#if EMBEDJSON_DYNAMIC_STACK
+int embedjson_stack_overflow(embedjson_parser* parser)
+{
+  char* new_stack = realloc(parser->stack, 2 * parser->stack_capacity + 1);
+  if (!new_stack) {
+    return -1;
+  }
+  parser->stack = new_stack;
+  parser->stack_capacity = 2 * parser->stack_capacity + 1;
+  return 0;
+}
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+
+void* embedjson_record_end(embedjson_parser* parser, const char* record,
+    embedjson_size_t size, int err)
+{
+  EMBEDJSON_UNUSED(record);
+  EMBEDJSON_UNUSED(size);
+  worker_state* state = (worker_state*) parser->userdata;
+  record_result* result = malloc(sizeof(record_result));
+  if (!result) {
+    fail("Out of memory");
+  }
+  result->sum = state->sum;
+  result->err = err;
+  result->error = state->error;
+  state->sum = 0;
+  state->error = NULL;
+  return result;
+}
+
+int embedjson_record_result(const char* record, embedjson_size_t size,
+    void* result)
+{
+  record_result r = *(record_result*) result;
+  free(result);
+  if (!verify) {
+    nresults++;
+    nerrors += !!r.err;
+    error_position = r.err ? r.error : error_position;
+    return 0;
+  }
+  if (record <= last_record) {
+    fail("Record at offset %llu is delivered out of order",
+        (ull) (record - input));
+  }
+  last_record = record;
+  long long id = strtoll(record + 6, NULL, 10);
+  if (id != (long long) nresults++) {
+    fail("Expected record %llu, got %lld", (ull) nresults - 1, id);
+  }
+  if (record[size - 1] != '}' && record[size - 1] != '\r') {
+    fail("Record %lld is truncated", id);
+  }
+  if (!r.err != !!(id % MALFORMED)) {
+    fail("Record %lld: unexpected result %d", id, r.err);
+  }
+  if (!r.err && r.sum != 2 * id + 1) {
+    fail("Record %lld: sum of values is %lld, expected %lld", id, r.sum,
+        2 * id + 1);
+  }
+  return id == stop_at ? 42 : 0;
+}
+
+/*
+ * Generates records {"id":N,"v":[N,1]} with some blank lines,
+ * CRLF line endings and malformed records
+ */
+static void generate_input()
+{
+  input = malloc(NRECORDS * 64);
+  if (!input) {
+    fail("Out of memory");
+  }
+  char* p = input;
+  for (int i = 0; i < NRECORDS; ++i) {
+    if (!(i % 37)) {
+      p += sprintf(p, " \t\n\n");
+    }
+    p += sprintf(p, "{\"id\":%d,\"v\":[%d,1%s%s\n", i, i,
+        i % MALFORMED ? "]}" : "}", i % 3 ? "" : "\r");
+  }
+  input_size = p - input;
+}
+
+/*
+ * Generates a top-level array of records {"id":N,"s":"...","v":[N,1]},
+ * where strings contain commas, brackets, and escaped quotes to make
+ * speculation on string boundaries fail
+ */
+static void generate_array_input()
+{
+  static const char* strings[] = {
+    "a,b", "]},{\\\"id\\\":[", "\\\\", "\\\\\\\",", "\\\"", ""
+  };
+  input = malloc(NRECORDS * 64);
+  if (!input) {
+    fail("Out of memory");
+  }
+  char* p = input;
+  p += sprintf(p, " [\n");
+  for (int i = 0; i < NRECORDS; ++i) {
+    p += sprintf(p, "%s{\"id\":%d,\"s\":\"%s\",\"v\":[%d,1%s}", i ? "," : "",
+        i, strings[i % SIZEOF(strings)], i, i % MALFORMED ? "]" : " 1]");
+    p += sprintf(p, i % 3 ? "\n" : "\r\n");
+  }
+  p += sprintf(p, "]\n");
+  input_size = p - input;
+}
+
+static void test_ndjson(unsigned nthreads, embedjson_size_t batch_size,
+    size_t nexpected, int expected_err)
+{
+  worker_state states[MAX_THREADS];
+  void* userdata[MAX_THREADS];
+  memset(states, 0, sizeof(states));
+  for (unsigned i = 0; i < MAX_THREADS; ++i) {
+    userdata[i] = states + i;
+  }
+  last_record = NULL;
+  nresults = 0;
+  int err = embedjson_parallel_ndjson(input, input_size, nthreads,
+      batch_size, userdata);
+  if (err != expected_err) {
+    fail("embedjson_parallel_ndjson returned %d, expected %d", err,
+        expected_err);
+  }
+  if (nresults != nexpected) {
+    fail("Got %llu results, expected %llu", (ull) nresults, (ull) nexpected);
+  }
+}
+
+static void test_array(unsigned nthreads, embedjson_size_t batch_size,
+    size_t nexpected, int expected_err)
+{
+  worker_state states[MAX_THREADS];
+  void* userdata[MAX_THREADS];
+  memset(states, 0, sizeof(states));
+  for (unsigned i = 0; i < MAX_THREADS; ++i) {
+    userdata[i] = states + i;
+  }
+  last_record = NULL;
+  nresults = 0;
+  int err = embedjson_parallel_array(input, input_size, nthreads,
+      batch_size, userdata);
+  if (err != expected_err) {
+    fail("embedjson_parallel_array returned %d, expected %d", err,
+        expected_err);
+  }
+  if (nresults != nexpected) {
+    fail("Got %llu results, expected %llu", (ull) nresults, (ull) nexpected);
+  }
+}
+
+static void test_array_edge_cases()
+{
+  static const struct {
+    const char* json;
+    size_t nresults;
+    size_t nerrors;
+  } cases[] = {
+    {"[ ]", 0, 0},
+    {" [1,,2] ", 3, 1},
+    {"[1,2,]", 3, 1},
+    {"[1 2]", 1, 1},
+    {"[[1,2],{\"a\":[3]},\"x,]\\\"\"]", 3, 0},
+    {"{\"a\":[1,2]}", 1, 0},
+    {"[1,2", 1, 1},
+    {"[1],[2]", 1, 1},
+    /* Empty stream is valid in stream mode */
+    {"", 1, !EMBEDJSON_STREAM}
+  };
+  worker_state states[MAX_THREADS];
+  void* userdata[MAX_THREADS];
+  memset(states, 0, sizeof(states));
+  for (unsigned i = 0; i < MAX_THREADS; ++i) {
+    userdata[i] = states + i;
+  }
+  verify = 0;
+  for (size_t i = 0; i < SIZEOF(cases); ++i) {
+    nresults = 0;
+    nerrors = 0;
+    int err = embedjson_parallel_array(cases[i].json, strlen(cases[i].json),
+        3, 2, userdata);
+    if (err || nresults != cases[i].nresults
+        || nerrors != cases[i].nerrors) {
+      fail("%s: returned %d, got %llu results and %llu errors", cases[i].json,
+          err, (ull) nresults, (ull) nerrors);
+    }
+  }
+  verify = 1;
+}
+
+/*
+ * Wraps records of generate_array_input into a larger document,
+ * and fixes malformed records
+ */
+static void generate_document()
+{
+  generate_array_input();
+  char* document = malloc(input_size + 64);
+  if (!document) {
+    fail("Out of memory");
+  }
+  int n = sprintf(document, "{\"a\":{\"b\":");
+  memcpy(document + n, input, input_size);
+  input_size += n;
+  input_size += sprintf(document + input_size,
+      ",\"c\":[1,{\"d\":\"x,\\\"]\"}]},\"e\":[]}");
+  free(input);
+  input = document;
+  for (char* p = input; (p = strstr(p, "1 1]")); ) {
+    p[1] = ',';
+  }
+}
+
+/*
+ * Returns embedjson_push / embedjson_finalize error for the input parsed
+ * sequentially, and stores the error position
+ */
+static int validate_sequentially(const char** position)
+{
+  worker_state state;
+  memset(&state, 0, sizeof(state));
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  parser.userdata = &state;
+  int err = embedjson_push(&parser, input, input_size);
+  if (!err) {
+    err = embedjson_finalize(&parser);
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  *position = state.error;
+  return err;
+}
+
+static void test_validate(unsigned nthreads, embedjson_size_t batch_size)
+{
+  static const char replacements[] = "}]\",x\\:";
+  worker_state states[MAX_THREADS];
+  void* userdata[MAX_THREADS];
+  for (unsigned i = 0; i < MAX_THREADS; ++i) {
+    userdata[i] = states + i;
+  }
+  verify = 0;
+  /* Valid document first, then documents with a single byte replaced */
+  for (size_t i = 0; i < 2 * SIZEOF(replacements); ++i) {
+    size_t offset = input_size * i / (2 * SIZEOF(replacements) + 1);
+    char original = input[offset];
+    if (i) {
+      input[offset] = replacements[i % (SIZEOF(replacements) - 1)];
+    }
+    const char* expected_position = NULL;
+    int expected = validate_sequentially(&expected_position);
+    if (!i && expected) {
+      fail("Generated document is invalid at offset %llu",
+          (ull) (expected_position - input));
+    }
+    memset(states, 0, sizeof(states));
+    nresults = 0;
+    error_position = NULL;
+    int err = embedjson_parallel_validate(input, input_size, nthreads,
+        batch_size, userdata);
+    if (err != expected || error_position != expected_position) {
+      fail("Byte at offset %llu replaced with '%c': returned %d at %lld, "
+          "expected %d at %lld", (ull) offset, input[offset], err,
+          error_position ? (long long) (error_position - input) : -1ll,
+          expected, expected_position
+          ? (long long) (expected_position - input) : -1ll);
+    }
+    input[offset] = original;
+  }
+  verify = 1;
+}
+
+static void test_empty_input()
+{
+  int err = embedjson_parallel_ndjson(input, 0, 4, 0, NULL);
+  if (err || nresults) {
+    fail("Unexpected result for empty input: %d", err);
+  }
+}
+
+static void test_wide_input()
+{
+  static const char utf16le[] = "{\0}\0\n\0{\0}\0";
+  static const char utf32be[] = "\0\0\0[\0\0\0]";
+  nresults = 0;
+  int err = embedjson_parallel_ndjson(utf16le, sizeof(utf16le) - 1, 4, 0,
+      NULL);
+  if (err != EMBEDJSON_BAD_ENCODING || nresults) {
+    fail("Unexpected result for UTF-16 NDJSON: %d", err);
+  }
+  err = embedjson_parallel_array(utf32be, sizeof(utf32be) - 1, 4, 0, NULL);
+  if (err != EMBEDJSON_BAD_ENCODING || nresults) {
+    fail("Unexpected result for UTF-32 array: %d", err);
+  }
+}
+
+int main()
+{
+  static const struct {
+    unsigned nthreads;
+    embedjson_size_t batch_size;
+  } configs[] = {
+    {1, 0}, {4, 0}, {4, 1}, {3, 64}, {MAX_THREADS, 1000}
+  };
+  size_t ntests = 3 * SIZEOF(configs) + 5;
+  size_t ntest = 0;
+  generate_input();
+  for (size_t i = 0; i < SIZEOF(configs); ++i) {
+    printf("[%d/%d] Run test \"%u threads, %llu bytes per batch\" ... ",
+        (int) ++ntest, (int) ntests, configs[i].nthreads,
+        (ull) configs[i].batch_size);
+    test_ndjson(configs[i].nthreads, configs[i].batch_size, NRECORDS, 0);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+  }
+
+  printf("[%d/%d] Run test \"stop delivery\" ... ", (int) ++ntest,
+      (int) ntests);
+  stop_at = 1234;
+  test_ndjson(4, 100, stop_at + 1, 42);
+  stop_at = -1;
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+  printf("[%d/%d] Run test \"empty input\" ... ", (int) ++ntest,
+      (int) ntests);
+  nresults = 0;
+  test_empty_input();
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+  printf("[%d/%d] Run test \"UTF-16 and UTF-32 input\" ... ", (int) ++ntest,
+      (int) ntests);
+  test_wide_input();
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+  free(input);
+
+  generate_array_input();
+  for (size_t i = 0; i < SIZEOF(configs); ++i) {
+    printf("[%d/%d] Run test \"array, %u threads, %llu bytes per batch\" ... ",
+        (int) ++ntest, (int) ntests, configs[i].nthreads,
+        (ull) configs[i].batch_size);
+    test_array(configs[i].nthreads, configs[i].batch_size, NRECORDS, 0);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+  }
+
+  printf("[%d/%d] Run test \"array, stop delivery\" ... ", (int) ++ntest,
+      (int) ntests);
+  stop_at = 1234;
+  test_array(4, 100, stop_at + 1, 42);
+  stop_at = -1;
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+  printf("[%d/%d] Run test \"array, edge cases\" ... ", (int) ++ntest,
+      (int) ntests);
+  test_array_edge_cases();
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+  free(input);
+
+  generate_document();
+  for (size_t i = 0; i < SIZEOF(configs); ++i) {
+    printf("[%d/%d] Run test \"validate, %u threads, %llu bytes per batch\" "
+        "... ", (int) ++ntest, (int) ntests, configs[i].nthreads,
+        (ull) configs[i].batch_size);
+    test_validate(configs[i].nthreads, configs[i].batch_size);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+  }
+  free(input);
+  return 0;
+}
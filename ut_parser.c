@@ -17,6 +17,7 @@
 
 #define ANSI_COLOR_RED "\x1b[31m"
 #define ANSI_COLOR_GREEN "\x1b[32m"
+#define ANSI_COLOR_YELLOW "\x1b[33m"
 #define ANSI_COLOR_RESET "\x1b[0m"
 
 typedef unsigned long long ull;
@@ -38,9 +39,21 @@ typedef enum call_type {
   CALL_BIGNUM_CHUNK,
   CALL_BIGNUM_END,
 #endif /* EMBEDJSON_BIGNUM */
+  CALL_DOCUMENT_BEGIN,
+  CALL_DOCUMENT_END,
   CALL_ERROR
 } call_type;
 
+/*
+ * Flag to combine with the expected call type to make the callback
+ * return EMBEDJSON_SKIP
+ */
+#define CALL_SKIP 0x100
+/* Return EMBEDJSON_PAUSE from the callback */
+#define CALL_PAUSE 0x200
+/* Return zero from embedjson_error to continue with the next document */
+#define CALL_CONTINUE 0x400
+
 const char* call_type_to_str(call_type ct)
 {
   switch (ct) {
@@ -60,6 +73,8 @@ const char* call_type_to_str(call_type ct)
     case CALL_BIGNUM_CHUNK: return "CALL_BIGNUM_CHUNK";
     case CALL_BIGNUM_END: return "CALL_BIGNUM_END";
 #endif /* EMBEDJSON_BIGNUM */
+    case CALL_DOCUMENT_BEGIN: return "CALL_DOCUMENT_BEGIN";
+    case CALL_DOCUMENT_END: return "CALL_DOCUMENT_END";
     case CALL_ERROR: return "CALL_ERROR";
     default: return "CALL_UNKNOWN";
   };
@@ -71,16 +86,42 @@ typedef struct data_chunk {
 } data_chunk;
 
 typedef struct {
+  int enabled;
   const char* name;
   size_t nchunks;
   data_chunk* data_chunks;
   size_t ncalls;
-  call_type* calls;
+  int* calls;
+  /* NULL-terminated list of JSON paths to filter parsing events */
+  const char** paths;
+  /* embedjson_parser.filter_stop value */
+  int filter_stop;
+  /* max_events argument for embedjson_push_ex */
+  size_t max_events;
+  /* Expected number of times embedjson_push_ex returns EMBEDJSON_PAUSE */
+  size_t npauses;
+  /*
+   * Expected calls of embedjson_parse_complete, which stops at the first
+   * pause, or NULL if the test has no single-chunk equivalent
+   */
+  size_t ncomplete_calls;
+  int* complete_calls;
+  /* Expect embedjson_document_begin/end calls */
+  int stream;
+  /* Expected UTF-16 code units of all string values */
+  size_t nutf16;
+  const unsigned short* utf16;
+  /* Expected UTF-8 text of all string values */
+  size_t nutf8;
+  const char* utf8;
 } test_case;
 
 static test_case* itest = NULL;
 static data_chunk* idata_chunk = NULL;
-static call_type* icall = NULL;
+static int* icall = NULL;
+static int* icall_end = NULL;
+static const unsigned short* iutf16 = NULL;
+static const char* iutf8 = NULL;
 
 static void fail(const char* fmt, ...)
 {
@@ -103,15 +144,22 @@ static void fail(const char* fmt, ...)
 
 static int on_call(call_type call)
 {
-  if (icall == itest->calls + itest->ncalls) {
+  if (icall == icall_end) {
     fail("Unexpected call %s (%d)", call_type_to_str(call), call);
   }
-  if (call != *icall) {
+  call_type expected = *icall & ~(CALL_SKIP | CALL_PAUSE | CALL_CONTINUE);
+  if (call != expected) {
     fail("Call type mismatch. Expected %s (%d), got %s (%d)",
-        call_type_to_str(*icall), *icall, call_type_to_str(call), call);
+        call_type_to_str(expected), expected, call_type_to_str(call), call);
+  }
+  int flags = *icall++;
+  if (flags & CALL_PAUSE) {
+    return EMBEDJSON_PAUSE;
+  }
+  if (flags & CALL_SKIP) {
+    return EMBEDJSON_SKIP;
   }
-  icall = icall + 1;
-  return call == CALL_ERROR ? MAGIC : 0;
+  return call == CALL_ERROR && !(flags & CALL_CONTINUE) ? MAGIC : 0;
 }
 
 int embedjson_error(embedjson_parser* parser, const char* position)
@@ -154,14 +202,39 @@ int embedjson_string_begin(embedjson_parser* parser)
   return on_call(CALL_STRING_BEGIN);
 }
 
+#if EMBEDJSON_UTF16_STRINGS
+int embedjson_string_chunk16(embedjson_parser* parser,
+    const embedjson_char16_t* data, embedjson_size_t size)
+{
+  EMBEDJSON_UNUSED(parser);
+  if (size && (data[size - 1] & 0xfc00) == 0xd800) {
+    fail("Surrogate pair is split between string chunks");
+  }
+  if (itest->utf16) {
+    size_t offset = iutf16 - itest->utf16;
+    if (size > itest->nutf16 - offset
+        || memcmp(iutf16, data, size * sizeof(*data))) {
+      fail("String chunk mismatch at code unit %llu", (ull) offset);
+    }
+    iutf16 += size;
+  }
+  return on_call(CALL_STRING_CHUNK);
+}
+#else
 int embedjson_string_chunk(embedjson_parser* parser, const char* data,
     embedjson_size_t size)
 {
   EMBEDJSON_UNUSED(parser);
-  EMBEDJSON_UNUSED(data);
-  EMBEDJSON_UNUSED(size);
+  if (itest->utf8) {
+    size_t offset = iutf8 - itest->utf8;
+    if (size > itest->nutf8 - offset || memcmp(iutf8, data, size)) {
+      fail("String chunk mismatch at byte %llu", (ull) offset);
+    }
+    iutf8 += size;
+  }
   return on_call(CALL_STRING_CHUNK);
 }
+#endif /* EMBEDJSON_UTF16_STRINGS */
 
 int embedjson_string_end(embedjson_parser* parser)
 {
@@ -218,6 +291,20 @@ int embedjson_bignum_end(embedjson_parser* parser)
 }
 #endif /* EMBEDJSON_BIGNUM */
 
+#if EMBEDJSON_STREAM
+int embedjson_document_begin(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return itest->stream ? on_call(CALL_DOCUMENT_BEGIN) : 0;
+}
+
+int embedjson_document_end(embedjson_parser* parser)
+{
+  EMBEDJSON_UNUSED(parser);
+  return itest->stream ? on_call(CALL_DOCUMENT_END) : 0;
+}
+#endif /* EMBEDJSON_STREAM */
+
 #if EMBEDJSON_DYNAMIC_STACK
 int embedjson_stack_overflow(embedjson_parser* parser)
 {
@@ -236,7 +323,7 @@ static char test_01_json[] = "{}";
 static data_chunk test_01_data_chunks[] = {
   {.data = test_01_json, .size = SIZEOF(test_01_json) - 1}
 };
-static call_type test_01_calls[] = {
+static int test_01_calls[] = {
   CALL_BEGIN_OBJECT,
   CALL_END_OBJECT
 };
@@ -246,7 +333,7 @@ static char test_02_json[] = "[{}, null]";
 static data_chunk test_02_data_chunks[] = {
   {.data = test_02_json, .size = SIZEOF(test_02_json) - 1}
 };
-static call_type test_02_calls[] = {
+static int test_02_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_BEGIN_OBJECT,
   CALL_END_OBJECT,
@@ -259,7 +346,7 @@ static char test_03_json[] = "{\"a\":{\"b\":true, \"c\":[1, 2]}, \"d\":null}";
 static data_chunk test_03_data_chunks[] = {
   {.data = test_03_json, .size = SIZEOF(test_03_json) - 1}
 };
-static call_type test_03_calls[] = {
+static int test_03_calls[] = {
   CALL_BEGIN_OBJECT,
   CALL_STRING_BEGIN,
   CALL_STRING_CHUNK,
@@ -289,7 +376,7 @@ static char test_04_json[] = "[]";
 static data_chunk test_04_data_chunks[] = {
   {.data = test_04_json, .size = SIZEOF(test_04_json) - 1}
 };
-static call_type test_04_calls[] = {
+static int test_04_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_END_ARRAY
 };
@@ -299,7 +386,7 @@ static char test_05_json[] = "[{}, [], {\"a\":[{ }]}]";
 static data_chunk test_05_data_chunks[] = {
   {.data = test_05_json, .size = SIZEOF(test_05_json) - 1}
 };
-static call_type test_05_calls[] = {
+static int test_05_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_BEGIN_OBJECT,
   CALL_END_OBJECT,
@@ -324,7 +411,7 @@ static data_chunk test_06_data_chunks[] = {
   {.data = test_06_json + 3, .size = 12},
   {.data = test_06_json + 15, SIZEOF(test_06_json) - 16}
 };
-static call_type test_06_calls[] = {
+static int test_06_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_DOUBLE,
   CALL_DOUBLE,
@@ -337,7 +424,7 @@ static char test_07_json[] = "[\"\",]";
 static data_chunk test_07_data_chunks[] = {
   {.data = test_07_json, .size = SIZEOF(test_07_json) - 1},
 };
-static call_type test_07_calls[] = {
+static int test_07_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_STRING_BEGIN,
   CALL_STRING_END,
@@ -349,7 +436,7 @@ static char test_08_json[] = "[-]";
 static data_chunk test_08_data_chunks[] = {
   {.data = test_08_json, .size = SIZEOF(test_08_json) - 1},
 };
-static call_type test_08_calls[] = {
+static int test_08_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -359,7 +446,7 @@ static char test_09_json[] = "[*]";
 static data_chunk test_09_data_chunks[] = {
   {.data = test_09_json, .size = SIZEOF(test_09_json) - 1},
 };
-static call_type test_09_calls[] = {
+static int test_09_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -369,7 +456,7 @@ static char test_10_json[] = "[.123]";
 static data_chunk test_10_data_chunks[] = {
   {.data = test_10_json, .size = SIZEOF(test_10_json) - 1},
 };
-static call_type test_10_calls[] = {
+static int test_10_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -379,7 +466,7 @@ static char test_11_json[] = "[012]";
 static data_chunk test_11_data_chunks[] = {
   {.data = test_11_json, .size = SIZEOF(test_11_json) - 1},
 };
-static call_type test_11_calls[] = {
+static int test_11_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -389,7 +476,7 @@ static char test_12_json[] = "[1]x";
 static data_chunk test_12_data_chunks[] = {
   {.data = test_12_json, .size = SIZEOF(test_12_json) - 1},
 };
-static call_type test_12_calls[] = {
+static int test_12_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_INT,
   CALL_END_ARRAY,
@@ -401,7 +488,7 @@ static char test_13_json[] = "2@";
 static data_chunk test_13_data_chunks[] = {
   {.data = test_13_json, .size = SIZEOF(test_13_json) - 1},
 };
-static call_type test_13_calls[] = {
+static int test_13_calls[] = {
   CALL_INT,
   CALL_ERROR,
 };
@@ -411,7 +498,7 @@ static char test_14_json[] = "{\"a\":[]}";
 static data_chunk test_14_data_chunks[] = {
   {.data = test_14_json, .size = SIZEOF(test_14_json) - 1},
 };
-static call_type test_14_calls[] = {
+static int test_14_calls[] = {
   CALL_BEGIN_OBJECT,
   CALL_STRING_BEGIN,
   CALL_STRING_CHUNK,
@@ -426,7 +513,7 @@ static char test_15_json[] = "[+1]";
 static data_chunk test_15_data_chunks[] = {
   {.data = test_15_json, .size = SIZEOF(test_15_json) - 1},
 };
-static call_type test_15_calls[] = {
+static int test_15_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -436,7 +523,7 @@ static char test_16_json[] = "[-2.]";
 static data_chunk test_16_data_chunks[] = {
   {.data = test_16_json, .size = SIZEOF(test_16_json) - 1},
 };
-static call_type test_16_calls[] = {
+static int test_16_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -446,7 +533,7 @@ static char test_17_json[] = "[0.3e+]";
 static data_chunk test_17_data_chunks[] = {
   {.data = test_17_json, .size = SIZEOF(test_17_json) - 1},
 };
-static call_type test_17_calls[] = {
+static int test_17_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -456,7 +543,7 @@ static char test_18_json[] = "[0.e1]";
 static data_chunk test_18_data_chunks[] = {
   {.data = test_18_json, .size = SIZEOF(test_18_json) - 1},
 };
-static call_type test_18_calls[] = {
+static int test_18_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -466,7 +553,7 @@ static char test_19_json[] = "[1.0e+]";
 static data_chunk test_19_data_chunks[] = {
   {.data = test_19_json, .size = SIZEOF(test_19_json) - 1},
 };
-static call_type test_19_calls[] = {
+static int test_19_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -476,7 +563,7 @@ static char test_20_json[] = "[1.0e-]";
 static data_chunk test_20_data_chunks[] = {
   {.data = test_20_json, .size = SIZEOF(test_20_json) - 1},
 };
-static call_type test_20_calls[] = {
+static int test_20_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -486,7 +573,7 @@ static char test_21_json[] = "[2.e+3]";
 static data_chunk test_21_data_chunks[] = {
   {.data = test_21_json, .size = SIZEOF(test_21_json) - 1},
 };
-static call_type test_21_calls[] = {
+static int test_21_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -496,7 +583,7 @@ static char test_22_json[] = "[2.e-3]";
 static data_chunk test_22_data_chunks[] = {
   {.data = test_22_json, .size = SIZEOF(test_22_json) - 1},
 };
-static call_type test_22_calls[] = {
+static int test_22_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -506,7 +593,7 @@ static char test_23_json[] = "[2.e3]";
 static data_chunk test_23_data_chunks[] = {
   {.data = test_23_json, .size = SIZEOF(test_23_json) - 1},
 };
-static call_type test_23_calls[] = {
+static int test_23_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -516,7 +603,7 @@ static char test_24_json[] = "[9.e+]";
 static data_chunk test_24_data_chunks[] = {
   {.data = test_24_json, .size = SIZEOF(test_24_json) - 1},
 };
-static call_type test_24_calls[] = {
+static int test_24_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -526,7 +613,7 @@ static char test_25_json[] = "[1.]";
 static data_chunk test_25_data_chunks[] = {
   {.data = test_25_json, .size = SIZEOF(test_25_json) - 1},
 };
-static call_type test_25_calls[] = {
+static int test_25_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_ERROR,
 };
@@ -536,7 +623,7 @@ static char test_26_json[] = "[123e65]";
 static data_chunk test_26_data_chunks[] = {
   {.data = test_26_json, .size = SIZEOF(test_26_json) - 1},
 };
-static call_type test_26_calls[] = {
+static int test_26_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_DOUBLE,
   CALL_END_ARRAY,
@@ -547,7 +634,7 @@ static char test_27_json[] = "[1E+2]";
 static data_chunk test_27_data_chunks[] = {
   {.data = test_27_json, .size = SIZEOF(test_27_json) - 1},
 };
-static call_type test_27_calls[] = {
+static int test_27_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_DOUBLE,
   CALL_END_ARRAY,
@@ -558,7 +645,7 @@ static char test_28_json[] = "[1E-2]";
 static data_chunk test_28_data_chunks[] = {
   {.data = test_28_json, .size = SIZEOF(test_28_json) - 1},
 };
-static call_type test_28_calls[] = {
+static int test_28_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_DOUBLE,
   CALL_END_ARRAY,
@@ -569,7 +656,7 @@ static char test_29_json[] = "[1e-2]";
 static data_chunk test_29_data_chunks[] = {
   {.data = test_29_json, .size = SIZEOF(test_29_json) - 1},
 };
-static call_type test_29_calls[] = {
+static int test_29_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_DOUBLE,
   CALL_END_ARRAY,
@@ -580,14 +667,647 @@ static char test_30_json[] = "[1e+2]";
 static data_chunk test_30_data_chunks[] = {
   {.data = test_30_json, .size = SIZEOF(test_30_json) - 1},
 };
-static call_type test_30_calls[] = {
+static int test_30_calls[] = {
   CALL_BEGIN_ARRAY,
   CALL_DOUBLE,
   CALL_END_ARRAY,
 };
 
+/* test 31 */
+static char test_31_json[] = "{\"a\":{\"b\":[1, \"}]\\\"\"]}, \"c\":2}";
+static data_chunk test_31_data_chunks[] = {
+  {.data = test_31_json, .size = SIZEOF(test_31_json) - 1},
+};
+static int test_31_calls[] = {
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END | CALL_SKIP,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_INT,
+  CALL_END_OBJECT,
+};
+
+/* test 32 */
+static char test_32_json[] = "{\"a\": -1.5e3 , \"b\":\"x\",\"c\":null}";
+static data_chunk test_32_data_chunks[] = {
+  {.data = test_32_json, .size = SIZEOF(test_32_json) - 1},
+};
+static int test_32_calls[] = {
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END | CALL_SKIP,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END | CALL_SKIP,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_NULL,
+  CALL_END_OBJECT,
+};
+
+/* test 33 */
+static char test_33_json[] = "[[1, [2, {}]], {\"a\":[]}, 3]";
+static data_chunk test_33_data_chunks[] = {
+  {.data = test_33_json, .size = 4},
+  {.data = test_33_json + 4, .size = 8},
+  {.data = test_33_json + 12, .size = SIZEOF(test_33_json) - 13},
+};
+static int test_33_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_BEGIN_ARRAY | CALL_SKIP,
+  CALL_BEGIN_OBJECT | CALL_SKIP,
+  CALL_INT,
+  CALL_END_ARRAY,
+};
+
+/* test 34 */
+static char test_34_json[] = "{\"a\":[1, 2]} ";
+static data_chunk test_34_data_chunks[] = {
+  {.data = test_34_json, .size = SIZEOF(test_34_json) - 1},
+};
+static int test_34_calls[] = {
+  CALL_BEGIN_OBJECT | CALL_SKIP,
+};
+
+/* test 35 */
+static char test_35_json[] = "[{\"a\":[1, 2]}";
+static data_chunk test_35_data_chunks[] = {
+  {.data = test_35_json, .size = SIZEOF(test_35_json) - 1},
+};
+static int test_35_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_BEGIN_OBJECT | CALL_SKIP,
+  CALL_ERROR,
+};
+
+/* test 36 */
+static char test_36_json[] = "{\"a\":true}x";
+static data_chunk test_36_data_chunks[] = {
+  {.data = test_36_json, .size = SIZEOF(test_36_json) - 1},
+};
+static int test_36_calls[] = {
+  CALL_BEGIN_OBJECT | CALL_SKIP,
+  CALL_ERROR,
+};
+
+/* test 37 */
+static char test_37_json[] = "{\"a\":[],\"b\":1}";
+static data_chunk test_37_data_chunks[] = {
+  {.data = test_37_json, .size = SIZEOF(test_37_json) - 1},
+};
+static int test_37_calls[] = {
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_BEGIN_ARRAY,
+  CALL_END_ARRAY,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_INT,
+  CALL_END_OBJECT,
+};
+
+/* test 38 */
+static char test_38_json[] = "{\"user\":{\"name\":\"x\",\"id\":7,\"tags\":[1]},"
+  "\"id\":3,\"items\":[{\"price\":1.5,\"q\":2},{\"price\":2}, 0]}";
+static data_chunk test_38_data_chunks[] = {
+  {.data = test_38_json, .size = SIZEOF(test_38_json) - 1},
+};
+static int test_38_calls[] = {
+  CALL_INT,
+  CALL_DOUBLE,
+  CALL_INT,
+};
+static const char* test_38_paths[] = {"$.user.id", "$.items[*].price", NULL};
+
+/* test 39 */
+static char test_39_json[] = "[1, {\"a\":[true]}, \"s\", null]";
+static data_chunk test_39_data_chunks[] = {
+  {.data = test_39_json, .size = SIZEOF(test_39_json) - 1},
+};
+static int test_39_calls[] = {
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_BEGIN_ARRAY,
+  CALL_BOOL,
+  CALL_END_ARRAY,
+  CALL_END_OBJECT,
+};
+static const char* test_39_paths[] = {"$[1]", NULL};
+
+/* test 40 */
+static char test_40_json[] = "{\"ab\":1,\"a\":\"xyz\"}";
+static data_chunk test_40_data_chunks[] = {
+  {.data = test_40_json, .size = 3},
+  {.data = test_40_json + 3, .size = 6},
+  {.data = test_40_json + 9, .size = 5},
+  {.data = test_40_json + 14, .size = SIZEOF(test_40_json) - 15},
+};
+static int test_40_calls[] = {
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+};
+static const char* test_40_paths[] = {"$.a", NULL};
+
+/* test 41 */
+static char test_41_json[] = "{\"a b\":{\"c\":null,\"d\":false},\"e\":{\"c\":1}}";
+static data_chunk test_41_data_chunks[] = {
+  {.data = test_41_json, .size = SIZEOF(test_41_json) - 1},
+};
+static int test_41_calls[] = {
+  CALL_NULL,
+  CALL_INT,
+};
+static const char* test_41_paths[] = {"$['a b'].c", "$.*.c", NULL};
+
+/* test 42 */
+static char test_42_json[] = "[[0, 1], [2, 3]]";
+static data_chunk test_42_data_chunks[] = {
+  {.data = test_42_json, .size = SIZEOF(test_42_json) - 1},
+};
+static int test_42_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_END_ARRAY,
+};
+static const char* test_42_paths[] = {"$", NULL};
+
+/* test 43 */
+static char test_43_json[] = "{\"x\":1 \"y\":2}";
+static data_chunk test_43_data_chunks[] = {
+  {.data = test_43_json, .size = SIZEOF(test_43_json) - 1},
+};
+static int test_43_calls[] = {
+  CALL_ERROR,
+};
+static const char* test_43_paths[] = {"$.y", NULL};
+
+/* test 44 */
+static char test_44_json[] = "{\"meta\":{\"id\":5},\"type\":\"t\",\"payload\":[1,";
+static data_chunk test_44_data_chunks[] = {
+  {.data = test_44_json, .size = 20},
+  {.data = test_44_json + 20, .size = SIZEOF(test_44_json) - 21},
+};
+static int test_44_calls[] = {
+  CALL_INT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+#if EMBEDJSON_STREAM
+  /* The rest of the document is skipped up to its end, which is missing */
+  CALL_ERROR,
+#endif /* EMBEDJSON_STREAM */
+};
+static const char* test_44_paths[] = {"$.type", "$.meta.id", NULL};
+
+/* test 45 */
+static char test_45_json[] = "{\"id\":1,\"rest\":{\"id\":[2,{\"a\":\"b\"}]}}";
+static data_chunk test_45_data_chunks[] = {
+  {.data = test_45_json, .size = SIZEOF(test_45_json) - 1},
+};
+static int test_45_calls[] = {
+  CALL_INT,
+};
+static const char* test_45_paths[] = {"$.id", NULL};
+
+/* test 46 */
+static char test_46_json[] = "{\"id\":1,\"rest\":{\"a\":tru}}";
+static data_chunk test_46_data_chunks[] = {
+  {.data = test_46_json, .size = SIZEOF(test_46_json) - 1},
+};
+static int test_46_calls[] = {
+  CALL_INT,
+  CALL_ERROR,
+};
+static const char* test_46_paths[] = {"$.id", NULL};
+
+/* test 47 */
+static char test_47_json[] = "[{\"id\":1},{\"id\":2}]";
+static data_chunk test_47_data_chunks[] = {
+  {.data = test_47_json, .size = SIZEOF(test_47_json) - 1},
+};
+static int test_47_calls[] = {
+  CALL_INT,
+  CALL_INT,
+};
+static const char* test_47_paths[] = {"$[*].id", NULL};
+
+/* test 48 */
+static char test_48_json[] = "{\"a\":[1,\"xy\\nz\",2.5],\"b\":null}";
+static data_chunk test_48_data_chunks[] = {
+  {.data = test_48_json, .size = SIZEOF(test_48_json) - 1},
+};
+static int test_48_calls[] = {
+  CALL_BEGIN_OBJECT | CALL_PAUSE,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_BEGIN_ARRAY,
+  CALL_INT | CALL_PAUSE,
+  CALL_STRING_BEGIN,
+#if EMBEDJSON_STRING_BUFFER_SIZE
+  /* "xy", "\n" and "z" are coalesced into a single chunk */
+  CALL_STRING_CHUNK | CALL_PAUSE,
+#else
+  CALL_STRING_CHUNK | CALL_PAUSE,
+  CALL_STRING_CHUNK,
+  CALL_STRING_CHUNK,
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
+  CALL_STRING_END,
+  CALL_DOUBLE | CALL_PAUSE,
+  CALL_END_ARRAY,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_NULL,
+  CALL_END_OBJECT | CALL_PAUSE,
+};
+
+/* test 49 */
+static char test_49_json[] = "[1, true, \"s\"]";
+static data_chunk test_49_data_chunks[] = {
+  {.data = test_49_json, .size = 6},
+  {.data = test_49_json + 6, .size = SIZEOF(test_49_json) - 7},
+};
+static int test_49_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_BOOL,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_END_ARRAY,
+};
+
+/* test 50 */
+static char test_50_json[] = "{\"a\":1}\n[true] \"s\"\x1e" "3 null\n42";
+static data_chunk test_50_data_chunks[] = {
+  {.data = test_50_json, .size = 10},
+  {.data = test_50_json + 10, .size = SIZEOF(test_50_json) - 11},
+};
+static int test_50_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_INT,
+  CALL_END_OBJECT,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_BOOL,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_NULL,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END,
+};
+
+/* test 51 */
+static char test_51_json[] = "{\"a\":1,} garbage more\n{\"b\":[1 2]}\n[3]";
+static data_chunk test_51_data_chunks[] = {
+  {.data = test_51_json, .size = 16},
+  {.data = test_51_json + 16, .size = SIZEOF(test_51_json) - 17},
+};
+static int test_51_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_INT,
+  CALL_ERROR | CALL_CONTINUE,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_ERROR | CALL_CONTINUE,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+};
+
+/* test 52 */
+static char test_52_json[] = "[1]\n[x]\n[2]";
+static data_chunk test_52_data_chunks[] = {
+  {.data = test_52_json, .size = SIZEOF(test_52_json) - 1},
+};
+static int test_52_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_ERROR,
+};
+
+/* test 53 */
+static char test_53_json[] = "1 2 3";
+static data_chunk test_53_data_chunks[] = {
+  {.data = test_53_json, .size = SIZEOF(test_53_json) - 1},
+};
+static int test_53_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END | CALL_PAUSE,
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END | CALL_PAUSE,
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END,
+};
+
+/* test 54 */
+static char test_54_json[] = "[1]\n\n[2";
+static data_chunk test_54_data_chunks[] = {
+  {.data = test_54_json, .size = SIZEOF(test_54_json) - 1},
+};
+static int test_54_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_ERROR | CALL_CONTINUE,
+};
+
+/* test 55 */
+static char test_55_json[] = "[\0" "1\0,\0\"\0\xe9\0\x3d\xd8\0\xde\"\0]\0";
+static data_chunk test_55_data_chunks[] = {
+  {.data = test_55_json, .size = 5},
+  {.data = test_55_json + 5, .size = 6},
+  {.data = test_55_json + 11, .size = SIZEOF(test_55_json) - 12},
+};
+static int test_55_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_END_ARRAY,
+};
+
+/* test 56 */
+static char test_56_json[] = "[\"a\\u00e9\\ud83d\\ude00\", \"\xd0\xb6\xf0\x9f\x98\x80x\"]";
+static data_chunk test_56_data_chunks[] = {
+  {.data = test_56_json, .size = 16},
+  {.data = test_56_json + 16, .size = 11},
+  {.data = test_56_json + 27, .size = 3},
+  {.data = test_56_json + 30, .size = SIZEOF(test_56_json) - 31},
+};
+static int test_56_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_STRING_BEGIN,
+#if !EMBEDJSON_STRING_BUFFER_SIZE
+  /* Otherwise "a" and "\u00e9" are coalesced into a single chunk */
+  CALL_STRING_CHUNK,
+#endif /* EMBEDJSON_STRING_BUFFER_SIZE */
+  CALL_STRING_CHUNK,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_END_ARRAY,
+};
+static unsigned short test_56_utf16[] = {
+  'a', 0xe9, 0xd83d, 0xde00, 0x436, 0xd83d, 0xde00, 'x',
+};
+
+/* test 57 */
+static char test_57_json[] = "[\"a\\nb\\tc\", \"\\\"d\\u00" "e9x\"]";
+static data_chunk test_57_data_chunks[] = {
+  {.data = test_57_json, .size = 20},
+  {.data = test_57_json + 20, .size = SIZEOF(test_57_json) - 21},
+};
+static int test_57_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_END_ARRAY,
+};
+static char test_57_utf8[] = "a\nb\tc" "\"d" "\xc3\xa9x";
+
+/* test 58 */
+static char test_58_json[] = "[\0" "1\0]\0\n\0[\0x\0]\0\n\0[\0" "2\0]\0\n\0[\0"
+  "3\0]\0\n\0";
+static data_chunk test_58_data_chunks[] = {
+  {.data = test_58_json, .size = SIZEOF(test_58_json) - 1},
+};
+static int test_58_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_ERROR | CALL_CONTINUE,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+};
+
+/* test 59 */
+static char test_59_json[] = "\0\0\0[\0\0\0" "1\0\0\0]\0\0\0\n\0\0\0[\0\0\0x"
+  "\0\0\0,\0\0\0 \0\0\0" "4\0\0\0]\0\0\0\n\0\0\0[\0\0\0" "2\0\0\0]";
+static data_chunk test_59_data_chunks[] = {
+  {.data = test_59_json, .size = 18},
+  {.data = test_59_json + 18, .size = 4},
+  {.data = test_59_json + 22, .size = 8},
+  {.data = test_59_json + 30, .size = SIZEOF(test_59_json) - 31},
+};
+static int test_59_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_ERROR | CALL_CONTINUE,
+  CALL_DOCUMENT_BEGIN,
+  CALL_BEGIN_ARRAY,
+  CALL_INT,
+  CALL_END_ARRAY,
+  CALL_DOCUMENT_END,
+};
+
+/* test 60 */
+static char test_60_json[] = "{\"a\":}";
+static data_chunk test_60_data_chunks[] = {
+  {.data = test_60_json, .size = SIZEOF(test_60_json) - 1},
+};
+static int test_60_calls[] = {
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END | CALL_SKIP,
+  CALL_ERROR,
+};
+
+/* test 61 */
+static char test_61_json[] = "{\"a\":{\"b\":[1,]}}";
+static data_chunk test_61_data_chunks[] = {
+  {.data = test_61_json, .size = 8},
+  {.data = test_61_json + 8, .size = SIZEOF(test_61_json) - 9},
+};
+static int test_61_calls[] = {
+  CALL_BEGIN_OBJECT,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END | CALL_SKIP,
+  CALL_ERROR,
+};
+
+/* test 62 */
+static char test_62_json[] = "[1,]";
+static data_chunk test_62_data_chunks[] = {
+  {.data = test_62_json, .size = SIZEOF(test_62_json) - 1},
+};
+static int test_62_calls[] = {
+  CALL_INT,
+  CALL_ERROR,
+};
+static const char* test_62_paths[] = {"$[0]", NULL};
+
+/* test 63 */
+static char test_63_json[] = "[1,,2]";
+static data_chunk test_63_data_chunks[] = {
+  {.data = test_63_json, .size = SIZEOF(test_63_json) - 1},
+};
+static int test_63_calls[] = {
+  CALL_INT,
+  CALL_ERROR,
+};
+static const char* test_63_paths[] = {"$[0]", NULL};
+
+/* test 64 */
+static char test_64_json[] = "{\"a\":}";
+static data_chunk test_64_data_chunks[] = {
+  {.data = test_64_json, .size = SIZEOF(test_64_json) - 1},
+};
+static int test_64_calls[] = {
+  CALL_ERROR,
+};
+static const char* test_64_paths[] = {"$.b", NULL};
+
+/* test 65 */
+static char test_65_json[] = "{\"b\":[1,]}";
+static data_chunk test_65_data_chunks[] = {
+  {.data = test_65_json, .size = SIZEOF(test_65_json) - 1},
+};
+static int test_65_calls[] = {
+  CALL_ERROR,
+};
+static const char* test_65_paths[] = {"$.a", NULL};
+
+/* test 66 */
+static char test_66_json[] = "{\"id\":1,\"rest\":{\"id\":[2,{\"a\":\"b\"}]}}\n"
+  "{\"rest\":[3],\"id\":4,\"more\":[{}]}\n{\"id\":5}\n";
+static data_chunk test_66_data_chunks[] = {
+  {.data = test_66_json, .size = 16},
+  {.data = test_66_json + 16, .size = SIZEOF(test_66_json) - 17},
+};
+static int test_66_calls[] = {
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END,
+  CALL_DOCUMENT_BEGIN,
+  CALL_INT,
+  CALL_DOCUMENT_END,
+};
+static const char* test_66_paths[] = {"$.id", NULL};
+
+/* test 67 */
+static char test_67_json[] = "[\"" "0123456789012345678901234567890123456789"
+  "\\n" "012345678901234567890123456789\"]";
+static data_chunk test_67_data_chunks[] = {
+  {.data = test_67_json, .size = SIZEOF(test_67_json) - 1},
+};
+static int test_67_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK | CALL_PAUSE,
+  CALL_STRING_CHUNK,
+  CALL_STRING_END,
+  CALL_END_ARRAY,
+};
+/* Buffered part of the string is reported before parsing stops */
+static int test_67_complete_calls[] = {
+  CALL_BEGIN_ARRAY,
+  CALL_STRING_BEGIN,
+  CALL_STRING_CHUNK | CALL_PAUSE,
+  CALL_STRING_CHUNK,
+#if EMBEDJSON_STREAM
+  /* Data is pushed, and the closing quote is processed completely */
+  CALL_STRING_END,
+#endif /* EMBEDJSON_STREAM */
+};
+static char test_67_utf8[] = "0123456789012345678901234567890123456789"
+  "\n" "012345678901234567890123456789";
+
 #define TEST_CASE(n, description) \
 { \
+  .enabled = 1, \
   .name = (description), \
   .nchunks = SIZEOF((test_##n##_data_chunks)), \
   .data_chunks = (test_##n##_data_chunks), \
@@ -595,6 +1315,135 @@ static call_type test_30_calls[] = {
   .calls = (test_##n##_calls)\
 }
 
+#define TEST_CASE_WITH_FILTER(n, description) \
+{ \
+  .enabled = EMBEDJSON_PATH_FILTER, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .paths = (test_##n##_paths) \
+}
+
+#define TEST_CASE_WITH_FILTER_STOP(n, description, stop) \
+{ \
+  .enabled = EMBEDJSON_PATH_FILTER, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .paths = (test_##n##_paths), \
+  .filter_stop = (stop) \
+}
+
+#define TEST_CASE_WITH_STREAM_FILTER_STOP(n, description, stop) \
+{ \
+  .enabled = EMBEDJSON_STREAM && EMBEDJSON_PATH_FILTER, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .paths = (test_##n##_paths), \
+  .filter_stop = (stop), \
+  .stream = 1 \
+}
+
+#define TEST_CASE_WITH_PAUSE(n, description, max, pauses) \
+{ \
+  .enabled = 1, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .max_events = (max), \
+  .npauses = (pauses) \
+}
+
+#define TEST_CASE_WITH_STREAM(n, description, pauses) \
+{ \
+  .enabled = EMBEDJSON_STREAM, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .npauses = (pauses), \
+  .stream = 1 \
+}
+
+#define TEST_CASE_WITH_STREAM_TRANSCODE(n, description) \
+{ \
+  .enabled = EMBEDJSON_STREAM && EMBEDJSON_TRANSCODE, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .stream = 1 \
+}
+
+#define TEST_CASE_WITH_TRANSCODE(n, description, max, pauses) \
+{ \
+  .enabled = EMBEDJSON_TRANSCODE, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .max_events = (max), \
+  .npauses = (pauses) \
+}
+
+#define TEST_CASE_WITH_UTF16(n, description) \
+{ \
+  .enabled = EMBEDJSON_UTF16_STRINGS, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .nutf16 = SIZEOF((test_##n##_utf16)), \
+  .utf16 = (test_##n##_utf16) \
+}
+
+#define TEST_CASE_WITH_STRING_BUFFER(n, description) \
+{ \
+  .enabled = EMBEDJSON_STRING_BUFFER_SIZE >= 16 && !EMBEDJSON_UTF16_STRINGS, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .nutf8 = SIZEOF((test_##n##_utf8)) - 1, \
+  .utf8 = (test_##n##_utf8) \
+}
+
+/* A string long enough to overflow the string buffer of 64 bytes */
+#define TEST_CASE_WITH_STRING_BUFFER_PAUSE(n, description, pauses) \
+{ \
+  .enabled = EMBEDJSON_STRING_BUFFER_SIZE > 40 \
+    && EMBEDJSON_STRING_BUFFER_SIZE <= 70 && !EMBEDJSON_UTF16_STRINGS, \
+  .name = (description), \
+  .nchunks = SIZEOF((test_##n##_data_chunks)), \
+  .data_chunks = (test_##n##_data_chunks), \
+  .ncalls = SIZEOF((test_##n##_calls)), \
+  .calls = (test_##n##_calls), \
+  .npauses = (pauses), \
+  .ncomplete_calls = SIZEOF((test_##n##_complete_calls)), \
+  .complete_calls = (test_##n##_complete_calls), \
+  .nutf8 = SIZEOF((test_##n##_utf8)) - 1, \
+  .utf8 = (test_##n##_utf8) \
+}
+
+#if !EMBEDJSON_PATH_FILTER
+#define EMBEDJSON_FILTER_STOP_VALIDATE 0
+#define EMBEDJSON_FILTER_STOP_TRUST 0
+#endif /* EMBEDJSON_PATH_FILTER */
+
 static test_case all_tests[] = {
   TEST_CASE(01, "empty object"),
   TEST_CASE(02, "array with nested object"),
@@ -626,44 +1475,302 @@ static test_case all_tests[] = {
   TEST_CASE(28, "JSONTestSuite.y_number_real_capital_e_pos_exp"),
   TEST_CASE(29, "JSONTestSuite.y_number_real_neg_exp"),
   TEST_CASE(30, "JSONTestSuite.y_number_real_pos_exponent"),
+  TEST_CASE(31, "skip object value"),
+  TEST_CASE(32, "skip primitive values"),
+  TEST_CASE(33, "skip nested array and object split into chunks"),
+  TEST_CASE(34, "skip top-level object"),
+  TEST_CASE(35, "skip unterminated object"),
+  TEST_CASE(36, "garbage after skipped object"),
+  TEST_CASE(37, "empty array followed by object key"),
+  TEST_CASE_WITH_FILTER(38, "filter keys and array wildcard"),
+  TEST_CASE_WITH_FILTER(39, "filter array index"),
+  TEST_CASE_WITH_FILTER(40, "filter keys split into chunks"),
+  TEST_CASE_WITH_FILTER(41, "filter quoted key and key wildcard"),
+  TEST_CASE_WITH_FILTER(42, "filter root"),
+  TEST_CASE_WITH_FILTER(43, "filter does not hide syntax errors"),
+  TEST_CASE_WITH_FILTER_STOP(44, "stop when all paths are found",
+      EMBEDJSON_FILTER_STOP_TRUST),
+  TEST_CASE_WITH_FILTER_STOP(45, "validate the rest when all paths are found",
+      EMBEDJSON_FILTER_STOP_VALIDATE),
+  TEST_CASE_WITH_FILTER_STOP(46, "error after all paths are found",
+      EMBEDJSON_FILTER_STOP_VALIDATE),
+  TEST_CASE_WITH_FILTER_STOP(47, "do not stop on wildcard paths",
+      EMBEDJSON_FILTER_STOP_TRUST),
+  TEST_CASE_WITH_PAUSE(48, "pause from callbacks", 0, 5),
+  TEST_CASE_WITH_PAUSE(49, "pause after each event", 1, 8),
+  TEST_CASE_WITH_STREAM(50, "stream of concatenated documents", 0),
+  TEST_CASE_WITH_STREAM(51, "skip malformed documents up to the next line", 0),
+  TEST_CASE_WITH_STREAM(52, "error callback aborts the stream", 0),
+  TEST_CASE_WITH_STREAM(53, "pause after each document", 2),
+  TEST_CASE_WITH_STREAM(54, "incomplete last document", 0),
+  TEST_CASE_WITH_TRANSCODE(55, "pause after each event in UTF-16LE input", 1,
+      8),
+  TEST_CASE_WITH_UTF16(56, "UTF-16 strings with split surrogate pairs"),
+  TEST_CASE_WITH_STRING_BUFFER(57, "coalesce escape-heavy strings"),
+  TEST_CASE_WITH_STREAM_TRANSCODE(58,
+      "skip malformed documents in UTF-16LE input"),
+  TEST_CASE_WITH_STREAM_TRANSCODE(59,
+      "skip malformed documents in UTF-32BE input split into chunks"),
+  TEST_CASE(60, "skip missing object value"),
+  TEST_CASE(61, "skip nested array with trailing comma"),
+  TEST_CASE_WITH_FILTER(62, "filter does not hide a trailing comma"),
+  TEST_CASE_WITH_FILTER(63, "filter does not hide a missing array element"),
+  TEST_CASE_WITH_FILTER(64, "filter does not hide a missing object value"),
+  TEST_CASE_WITH_FILTER(65, "filter does not hide errors in skipped values"),
+  TEST_CASE_WITH_STREAM_FILTER_STOP(66, "stop in each document of a stream",
+      EMBEDJSON_FILTER_STOP_TRUST),
+  TEST_CASE_WITH_STRING_BUFFER_PAUSE(67, "pause with a partly buffered string",
+      1),
+};
+
+/*
+ * Replaces parser with a fresh one, restored from the checkpoint
+ */
+static void checkpoint_restore(embedjson_parser* parser)
+{
+  char checkpoint[1024];
+  char copy[sizeof(checkpoint)];
+  embedjson_size_t size = embedjson_checkpoint_size(parser);
+  embedjson_size_t written;
+  if (size > sizeof(checkpoint)) {
+    fail("Too large checkpoint: %llu bytes", (ull) size);
+  }
+  if (embedjson_checkpoint(parser, checkpoint, size - 1, &written)
+      != EMBEDJSON_CHECKPOINT_OVERFLOW) {
+    fail("embedjson_checkpoint should fail for a small buffer");
+  }
+  if (embedjson_checkpoint(parser, checkpoint, sizeof(checkpoint), &written)) {
+    fail("embedjson_checkpoint failed");
+  }
+  if (written != size) {
+    fail("embedjson_checkpoint wrote %llu bytes, expected %llu",
+        (ull) written, (ull) size);
+  }
+  embedjson_parser restored;
+  memset(&restored, 0, sizeof(restored));
+#if EMBEDJSON_PATH_FILTER
+  restored.filter = parser->filter;
+#endif /* EMBEDJSON_PATH_FILTER */
+  if (embedjson_restore(&restored, checkpoint, written - 1)
+      != EMBEDJSON_BAD_CHECKPOINT) {
+    fail("embedjson_restore should fail for a truncated checkpoint");
+  }
+  if (embedjson_restore(&restored, checkpoint, written)) {
+    fail("embedjson_restore failed");
+  }
+  if (embedjson_checkpoint(&restored, copy, sizeof(copy), &written)
+      || written != size || memcmp(checkpoint, copy, size)) {
+    fail("Restored parser differs from the original one");
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser->stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+  *parser = restored;
+}
+
+/* How data chunks are pushed by run_test */
+enum {
+  PUSH,
+  PUSH_EX,
+  PUSHV,
+  PUSH_PADDED,
+  PARSE_COMPLETE
 };
 
+/*
+ * Pushes all data chunks of itest with a single embedjson_pushv call
+ */
+static int pushv_chunks(embedjson_parser* parser)
+{
+  embedjson_iovec iov[16];
+  if (itest->nchunks > SIZEOF(iov)) {
+    fail("Too many data chunks for embedjson_pushv");
+  }
+  for (size_t j = 0; j < itest->nchunks; ++j) {
+    iov[j].iov_base = itest->data_chunks[j].data;
+    iov[j].iov_len = itest->data_chunks[j].size;
+  }
+  idata_chunk = itest->data_chunks;
+  int err = embedjson_pushv(parser, iov, itest->nchunks);
+  if (err && err != MAGIC && err != EMBEDJSON_DONE) {
+    fail("embedjson_pushv returned unknown error (%d)", err);
+  }
+  return err;
+}
+
+/*
+ * Pushes a data chunk with embedjson_push_padded, from a copy followed
+ * by EMBEDJSON_PADDING bytes of garbage
+ */
+static int push_padded(embedjson_parser* parser, const char* data,
+    embedjson_size_t size)
+{
+  char buffer[512 + EMBEDJSON_PADDING];
+  if (size > sizeof(buffer) - EMBEDJSON_PADDING) {
+    fail("Too large data chunk for embedjson_push_padded");
+  }
+  memset(buffer, '7', sizeof(buffer));
+  memcpy(buffer, data, size);
+  return embedjson_push_padded(parser, buffer, size);
+}
+
+/*
+ * Runs test itest, optionally replacing the parser with the one
+ * restored from the checkpoint after each push call. Data chunks are
+ * pushed one by one with embedjson_push_ex, embedjson_push
+ * or embedjson_push_padded, or all at once with embedjson_pushv,
+ * or the only chunk is parsed with embedjson_parse_complete.
+ */
+static void run_test(int restore, int mode)
+{
+  size_t j;
+  int err = 0;
+  size_t npauses = 0;
+  embedjson_size_t consumed;
+  embedjson_parser parser;
+  memset(&parser, 0, sizeof(parser));
+  int* calls = itest->calls;
+  size_t ncalls = itest->ncalls;
+  if (mode == PARSE_COMPLETE && itest->npauses) {
+    calls = itest->complete_calls;
+    ncalls = itest->ncomplete_calls;
+  }
+  icall = calls;
+  icall_end = calls + ncalls;
+  iutf16 = itest->utf16;
+  iutf8 = itest->utf8;
+#if EMBEDJSON_PATH_FILTER
+  embedjson_filter filter;
+  memset(&filter, 0, sizeof(filter));
+  if (itest->paths) {
+    for (const char** path = itest->paths; *path; ++path) {
+      if (embedjson_filter_add(&filter, *path, strlen(*path))) {
+        fail("embedjson_filter_add failed for path \"%s\"", *path);
+      }
+    }
+    parser.filter = &filter;
+    parser.filter_stop = itest->filter_stop;
+  }
+#endif /* EMBEDJSON_PATH_FILTER */
+  if (mode == PUSHV) {
+    err = pushv_chunks(&parser);
+    if (!err && restore) {
+      checkpoint_restore(&parser);
+    }
+  } else if (mode == PARSE_COMPLETE) {
+    idata_chunk = itest->data_chunks;
+    err = embedjson_parse_complete(&parser, idata_chunk->data,
+        idata_chunk->size);
+    if (itest->npauses && err != EMBEDJSON_PAUSE) {
+      fail("embedjson_parse_complete should stop at the first pause");
+    }
+    if (err && err != MAGIC && err != EMBEDJSON_DONE && !itest->npauses) {
+      fail("embedjson_parse_complete returned unknown error (%d)", err);
+    }
+  }
+  for (j = 0; j < itest->nchunks && mode != PUSHV && mode != PARSE_COMPLETE;
+      ++j) {
+    idata_chunk = itest->data_chunks + j;
+    const char* data = idata_chunk->data;
+    embedjson_size_t size = idata_chunk->size;
+    if (mode == PUSH || mode == PUSH_PADDED) {
+      err = mode == PUSH ? embedjson_push(&parser, data, size)
+        : push_padded(&parser, data, size);
+      if (err == MAGIC || err == EMBEDJSON_DONE) {
+        break;
+      } else if (err) {
+        fail("embedjson_push returned unknown error (%d)", err);
+      }
+      if (restore) {
+        checkpoint_restore(&parser);
+      }
+      continue;
+    }
+    while ((err = embedjson_push_ex(&parser, data, size, itest->max_events,
+            &consumed)) == EMBEDJSON_PAUSE) {
+      if (consumed > size) {
+        fail("embedjson_push_ex consumed %llu bytes of %llu",
+            (ull) consumed, (ull) size);
+      }
+      data += consumed;
+      size -= consumed;
+      npauses++;
+      if (restore) {
+        checkpoint_restore(&parser);
+      }
+    }
+    if (err == MAGIC || err == EMBEDJSON_DONE) {
+      break;
+    } else if (err) {
+      fail("embedjson_push returned unknown error (%d)", err);
+    }
+    if (restore) {
+      checkpoint_restore(&parser);
+    }
+  }
+  if (!err && mode != PARSE_COMPLETE) {
+    err = embedjson_finalize(&parser);
+    if (err && err != MAGIC) {
+      fail("embedjson_finalize returned unknown error (%d)", err);
+    }
+  }
+  if (icall != icall_end) {
+    fail("Not enough callback calls. Expected %llu, got %llu",
+        (ull) ncalls, (ull) (icall - calls));
+  }
+  if (iutf16 != itest->utf16 + itest->nutf16) {
+    fail("Not enough string code units. Expected %llu, got %llu",
+        (ull) itest->nutf16, (ull) (iutf16 - itest->utf16));
+  }
+  /* Parsing stops in the middle of a string at the first pause */
+  if (iutf8 != itest->utf8 + itest->nutf8
+      && !(mode == PARSE_COMPLETE && itest->npauses)) {
+    fail("Not enough string bytes. Expected %llu, got %llu",
+        (ull) itest->nutf8, (ull) (iutf8 - itest->utf8));
+  }
+  if (npauses != itest->npauses && mode != PARSE_COMPLETE) {
+    fail("Parsing paused %llu times, expected %llu",
+        (ull) npauses, (ull) itest->npauses);
+  }
+#if EMBEDJSON_DYNAMIC_STACK
+  free(parser.stack);
+#endif /* EMBEDJSON_DYNAMIC_STACK */
+}
+
 int main()
 {
   size_t ntests = SIZEOF(all_tests);
-  size_t i, j;
+  size_t i;
   int counter_width = 1 + (int) floor(log10(ntests));
-  int err;
   for (i = 0; i < ntests; ++i) {
     itest = all_tests + i;
-    icall = itest->calls;
-    embedjson_parser parser;
-    memset(&parser, 0, sizeof(parser));
     printf("[%*d/%d] Run test \"%s\" ... ", counter_width, (int) i + 1,
         (int) ntests, itest->name);
-    for (j = 0; j < itest->nchunks; ++j) {
-      idata_chunk = itest->data_chunks + j;
-      err = embedjson_push(&parser, idata_chunk->data, idata_chunk->size);
-      if (err == MAGIC) {
-        break;
-      } else if (err) {
-        fail("embedjson_push returned unknown error (%d)", err);
-      }
+    if (!itest->enabled) {
+      printf(ANSI_COLOR_YELLOW "SKIPPED" ANSI_COLOR_RESET "\n");
+      continue;
     }
-    if (!err) {
-      err = embedjson_finalize(&parser);
-      if (err == MAGIC) {
-        break;
-      } else if (err) {
-        fail("embedjson_finalize returned unknown error (%d)", err);
-      }
+    run_test(0, PUSH_EX);
+    run_test(1, PUSH_EX);
+    /* Pausing is supported by embedjson_push_ex only */
+    if (!itest->max_events && !itest->npauses) {
+      run_test(0, PUSH);
+      run_test(1, PUSH);
+      run_test(0, PUSH_PADDED);
+      run_test(1, PUSH_PADDED);
+    }
+    /* The string buffer is flushed at the end of the call, not segment */
+    if (!itest->max_events && !itest->npauses
+        && (!EMBEDJSON_STRING_BUFFER_SIZE || itest->nchunks == 1)) {
+      run_test(0, PUSHV);
+      run_test(1, PUSHV);
     }
-    if (icall != itest->calls + itest->ncalls) {
-      fail("Not enough callback calls. Expected %llu, got %llu",
-          (ull) itest->ncalls, (ull) (icall - itest->calls));
+    /* String chunks are split at the boundaries of data chunks */
+    if (!itest->max_events && itest->nchunks == 1
+        && (!itest->npauses || itest->complete_calls)) {
+      run_test(0, PARSE_COMPLETE);
     }
     printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
   }
   return 0;
 }
-
@@ -0,0 +1,115 @@
+/**
+ * @copyright
+ * Copyright (c) 2021 Stanislav Ivochkin
+ *
+ * Licensed under the MIT License (see LICENSE)
+ */
+
+/* O_DIRECT, pipe and POSIX threads */
+#define _GNU_SOURCE
+
+#include "reader.h"
+#include "ut_fd.h"
+
+/* Length of the "garbage" prefix skipped with lseek */
+#define PREFIX_SIZE 3
+
+static int push_fd(embedjson_parser* parser, int fd,
+    embedjson_size_t buffer_size, int flags)
+{
+  return embedjson_push_fd(parser, fd, buffer_size, flags);
+}
+
+static void test_file(embedjson_size_t buffer_size, int flags)
+{
+  int fd = open_file(O_RDONLY, PREFIX_SIZE);
+  parse_fd(fd, buffer_size, flags, 0);
+  if (lseek(fd, 0, SEEK_CUR) != PREFIX_SIZE) {
+    fail("File position is changed");
+  }
+  close(fd);
+}
+
+static void test_stop_on_file(int flags)
+{
+  int fd = open_file(O_RDONLY, PREFIX_SIZE);
+  parse_fd(fd, 100, flags, 42);
+  close(fd);
+}
+
+static void write_prefix(const char* prefix)
+{
+  int fd = open(filename, O_WRONLY);
+  if (fd < 0 || pwrite(fd, prefix, PREFIX_SIZE, 0) != PREFIX_SIZE) {
+    fail("Failed to write temporary file: %s", strerror(errno));
+  }
+  close(fd);
+}
+
+static void test_direct(int flags)
+{
+  /* Direct reads start at an aligned offset, so the prefix is skipped */
+  write_prefix("   ");
+  int fd = open(filename, O_RDONLY | O_DIRECT);
+  if (fd < 0 && errno == EINVAL) {
+    /* Not supported by the file system, e.g. tmpfs */
+    fd = open(filename, O_RDONLY);
+  }
+  if (fd < 0) {
+    fail("Failed to open temporary file: %s", strerror(errno));
+  }
+  parse_fd(fd, 1000, flags | EMBEDJSON_READ_DIRECT, 0);
+  close(fd);
+  write_prefix("###");
+}
+
+int main()
+{
+  static const embedjson_size_t buffer_sizes[] = {0, 1000, 4096, 13};
+  static const int flags[] = {0, EMBEDJSON_READ_NO_URING};
+  size_t ntests = SIZEOF(flags) * (2 * SIZEOF(buffer_sizes) + 3) + 1;
+  size_t ntest = 0;
+  generate_input("###", "ut-reader");
+  for (size_t i = 0; i < SIZEOF(flags); ++i) {
+    const char* mode = flags[i] ? "pread" : "io_uring";
+    for (size_t j = 0; j < SIZEOF(buffer_sizes); ++j) {
+      printf("[%d/%d] Run test \"%s, file, %llu bytes per buffer\" ... ",
+          (int) ++ntest, (int) ntests, mode, (ull) buffer_sizes[j]);
+      test_file(buffer_sizes[j], flags[i]);
+      printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+      printf("[%d/%d] Run test \"%s, pipe, %llu bytes per buffer\" ... ",
+          (int) ++ntest, (int) ntests, mode, (ull) buffer_sizes[j]);
+      test_pipe(input + PREFIX_SIZE, input_size - PREFIX_SIZE,
+          buffer_sizes[j], flags[i]);
+      printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+    }
+
+    printf("[%d/%d] Run test \"%s, stop on a file\" ... ", (int) ++ntest,
+        (int) ntests, mode);
+    stop_at = NVALUES / 2;
+    test_stop_on_file(flags[i]);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+    printf("[%d/%d] Run test \"%s, stop on a blocked pipe\" ... ",
+        (int) ++ntest, (int) ntests, mode);
+    stop_at = NVALUES;
+    test_pipe(input + PREFIX_SIZE, input_size - PREFIX_SIZE, 100, flags[i]);
+    stop_at = 0;
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+    printf("[%d/%d] Run test \"%s, direct\" ... ", (int) ++ntest,
+        (int) ntests, mode);
+    test_direct(flags[i]);
+    printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+  }
+
+  printf("[%d/%d] Run test \"read error\" ... ", (int) ++ntest,
+      (int) ntests);
+  test_read_error();
+  printf(ANSI_COLOR_GREEN "OK" ANSI_COLOR_RESET "\n");
+
+  unlink(filename);
+  free(input);
+  return 0;
+}